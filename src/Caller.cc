@@ -0,0 +1,936 @@
+#include "Caller.hh"
+
+/****************************************************************************
+** Caller.cc
+**
+** Reentrant interface to the variant caller: a call is configured by a
+** Config, reads the tumor/normal BAMs of the config and returns the
+** variants of a list of regions in memory
+**
+*****************************************************************************/
+
+/************************** COPYRIGHT ***************************************
+**
+** New York Genome Center
+**
+** SOFTWARE COPYRIGHT NOTICE AGREEMENT
+** This software and its documentation are copyright (2016) by the New York
+** Genome Center. All rights are reserved. This software is supplied without
+** any warranty or guaranteed support whatsoever. The New York Genome Center
+** cannot be responsible for its use, misuse, or functionality.
+**
+** Version: 1.0.0
+** Author: Giuseppe Narzisi
+**
+*************************** /COPYRIGHT **************************************/
+
+#include <sstream>
+#include <algorithm>
+#include <unordered_set>
+#include <cstring>
+#include <time.h>
+#include "api/BamReader.h"
+#include "htslib/faidx.h"
+#include "FET.hh"
+#include "Checkpoint.hh"
+#include "sha256.hh"
+
+namespace lancet {
+
+// Config
+// defaults of the command line
+//////////////////////////////////////////////////////////////
+Config::Config()
+{
+	NUM_THREADS = 1;
+	RESUME = false;
+	SHARD = 0;
+	NUM_SHARDS = 0;
+	GENOME = false;
+
+	XA_FILTER = false;
+	PRIMARY_ALIGNMENT_ONLY = false;
+	ACTIVE_REGIONS = true;
+	verbose = false;
+	VERBOSE = false;
+	KMER_RECOVERY = false;
+	PRINT_ALL = false;
+	PRINT_DOT_READS = true;
+	MIN_QV_TRIM = 10;
+	MIN_QV_CALL = 17;
+	QV_RANGE = '!';
+	MIN_MAP_QUAL = 15;
+	MAX_DELTA_AS_XS = 5;
+	WINDOW_SIZE = 600;
+	PADDING = 250;
+
+	minK = 11;
+	maxK = 101;
+	MAX_TIP_LEN = minK;
+	MIN_THREAD_READS = 1;
+	COV_THRESHOLD = 5;
+	MIN_COV_RATIO = 0.01;
+	LOW_COV_THRESHOLD = 1;
+	MAX_AVG_COV = 10000;
+	NODE_STRLEN = 100;
+	DFS_LIMIT = 1000000;
+	MAX_INDEL_LEN = 500;
+	MAX_MISMATCH = 2;
+	WINDOW_TIME_BUDGET = 0;
+	WINDOW_RETRY = false;
+
+	MAX_UNIT_LEN = 4;
+	MIN_REPORT_UNITS = 3;
+	MIN_REPORT_LEN = 7;
+	DIST_FROM_STR = 1;
+
+	filters.minPhredFisherSTR = 25;
+	filters.minPhredFisher = 5;
+	filters.minCovNormal = 10;
+	filters.maxCovNormal = 1000000;
+	filters.minCovTumor = 4;
+	filters.maxCovTumor = 1000000;
+	filters.minVafTumor = 0.04;
+	filters.maxVafNormal = 0;
+	filters.minAltCntTumor = 3;
+	filters.maxAltCntNormal = 0;
+	filters.minStrandBias = 1;
+}
+
+// print
+// print the configuration (one parameter per line)
+//////////////////////////////////////////////////////////////
+void Config::print(ostream & out) const
+{
+	out << "tumor-BAM: "        << TUMOR << endl;
+	out << "normal-BAM: "       << NORMAL << endl;
+	out << "reference: "        << REFFILE << endl;
+	out << "genome: "           << bvalue(GENOME) << endl;
+	out << "contigs: "          << CONTIGS << endl;
+	out << "exclude-contigs: "  << EXCLUDE_CONTIGS << endl;
+
+	out << "min-K: "            << minK << endl;
+	out << "max-K: "            << maxK << endl;
+	out << "tip-len: "          << MAX_TIP_LEN << endl;
+
+	out << "cov-thr: "          << COV_THRESHOLD << endl;
+	ios::fmtflags flags = out.flags(); // the ratio is printed with up to 5 significant digits
+	streamsize precision = out.precision(5);
+	out.unsetf(ios::floatfield);
+	out << "cov-ratio: "        << MIN_COV_RATIO << endl;
+	out.flags(flags);
+	out.precision(precision);
+	out << "low-cov: "          << LOW_COV_THRESHOLD << endl;
+	out << "window-size: "      << WINDOW_SIZE << endl;
+	out << "padding: "          << PADDING << endl;
+	out << "max-avg-cov: "      << MAX_AVG_COV << endl;
+	out << "min-map-qual: "     << MIN_MAP_QUAL << endl;
+	out << "max-as-xs-diff: "   << MAX_DELTA_AS_XS << endl;
+	out << "min-base-qual: "    << MIN_QV_CALL << endl;
+	out << "trim-lowqual: "     << MIN_QV_TRIM << endl;
+	out << "quality-range: "    << QV_RANGE << endl;
+	out << "node-str-len: "     << NODE_STRLEN << endl;
+	out << "dfs-limit: "        << DFS_LIMIT << endl;
+	out << "max-indel-len: "    << MAX_INDEL_LEN << endl;
+	out << "max-mismatch: "     << MAX_MISMATCH << endl;
+	out << "window-time-budget: " << WINDOW_TIME_BUDGET << endl;
+	out << "window-retry: "     << bvalue(WINDOW_RETRY) << endl;
+	out << "num-threads: "      << NUM_THREADS << endl;
+	out << "checkpoint: "       << CHECKPOINT_FILE << endl;
+	out << "shard: "            << SHARD << "/" << NUM_SHARDS << endl;
+	out << "window-stats: "     << WINDOW_STATS_FILE << endl;
+
+	// str parameters
+	out << "max-unit-length: "   << MAX_UNIT_LEN << endl;
+	out << "min-report-unit: "   << MIN_REPORT_UNITS << endl;
+	out << "min-report-len: "    << MIN_REPORT_LEN << endl;
+	out << "dist-from-str: "     << DIST_FROM_STR << endl;
+
+	//filters
+	out << "min-phred-fisher: "     << filters.minPhredFisher << endl;
+	out << "min-phred-fisher-str: " << filters.minPhredFisherSTR << endl;
+	out << "min-strand-bias: "      << filters.minStrandBias << endl;
+	out << "min-alt-count-tumor: "  << filters.minAltCntTumor << endl;
+	out << "max-alt-count-normal: " << filters.maxAltCntNormal << endl;
+	out << "min-vaf-tumor: "        << filters.minVafTumor << endl;
+	out << "max-vaf-normal: "       << filters.maxVafNormal << endl;
+	out << "min-coverage-tumor: "   << filters.minCovTumor << endl;
+	out << "max-coverage-tumor: "   << filters.maxCovTumor << endl;
+	out << "min-coverage-normal: "  << filters.minCovNormal << endl;
+	out << "max-coverage-normal: "  << filters.maxCovNormal << endl;
+
+	out << "primary-alignment-only: " << bvalue(PRIMARY_ALIGNMENT_ONLY) << endl;
+	out << "XA-tag-filter: "    << bvalue(XA_FILTER) << endl;
+	out << "active-regions: "   << bvalue(ACTIVE_REGIONS) << endl;
+	out << "kmer-recovery: "    << bvalue(KMER_RECOVERY) << endl;
+	out << "print-graphs: "     << bvalue(PRINT_ALL) << endl;
+	out << "verbose: "          << bvalue(verbose) << endl;
+	out << "more-verbose: "     << bvalue(VERBOSE) << endl;
+}
+
+// signature
+// signature of the configuration and of the regions that determine the
+// variants of a call (options that only affect logging or performance
+// are left out)
+//////////////////////////////////////////////////////////////
+string Config::signature(const vector<string> & regions) const
+{
+	static const char * ignored[] = { "num-threads:", "checkpoint:", "shard:", "window-stats:", "print-graphs:", "verbose:", "more-verbose:", NULL };
+
+	stringstream config;
+	print(config);
+
+	string line;
+	string text;
+	while (getline(config, line)) {
+		bool skip = false;
+		for (int i = 0; ignored[i] != NULL; ++i) {
+			if (line.compare(0, strlen(ignored[i]), ignored[i]) == 0) { skip = true; break; }
+		}
+		if (!skip) { text += line + "\n"; }
+	}
+	if (!GENOME) {
+		for (unsigned int r = 0; r < regions.size(); ++r) { text += "region: " + regions[r] + "\n"; }
+	}
+
+	return sha256(text);
+}
+
+// set
+// set the parameter of a command line option (long name without the 
+// dashes); only the assembly and filter parameters are supported. Returns
+// false if the option or its value are not valid.
+//////////////////////////////////////////////////////////////
+bool Config::set(const string & option, const string & value)
+{
+	char * end = NULL;
+	double x = strtod(value.c_str(), &end);
+	if (value.empty() || (*end != '\0')) { return false; }
+
+	int * ivalue = NULL;
+	double * dvalue = NULL;
+
+	if (option == "min-k")                     { ivalue = &minK; }
+	else if (option == "max-k")                { ivalue = &maxK; }
+	else if (option == "tip-len")              { ivalue = &MAX_TIP_LEN; }
+	else if (option == "cov-thr")              { ivalue = &COV_THRESHOLD; }
+	else if (option == "cov-ratio")            { dvalue = &MIN_COV_RATIO; }
+	else if (option == "low-cov")              { ivalue = &LOW_COV_THRESHOLD; }
+	else if (option == "trim-lowqual")         { ivalue = &MIN_QV_TRIM; }
+	else if (option == "min-base-qual")        { ivalue = &MIN_QV_CALL; }
+	else if (option == "dfs-limit")            { ivalue = &DFS_LIMIT; }
+	else if (option == "max-indel-len")        { ivalue = &MAX_INDEL_LEN; }
+	else if (option == "max-mismatch")         { ivalue = &MAX_MISMATCH; }
+	else if (option == "max-unit-length")      { ivalue = &MAX_UNIT_LEN; }
+	else if (option == "min-report-unit")      { ivalue = &MIN_REPORT_UNITS; }
+	else if (option == "min-report-len")       { ivalue = &MIN_REPORT_LEN; }
+	else if (option == "dist-from-str")        { ivalue = &DIST_FROM_STR; }
+	else if (option == "min-phred-fisher-str") { dvalue = &filters.minPhredFisherSTR; }
+	else if (option == "min-phred-fisher")     { dvalue = &filters.minPhredFisher; }
+	else if (option == "min-strand-bias")      { ivalue = &filters.minStrandBias; }
+	else if (option == "min-alt-count-tumor")  { ivalue = &filters.minAltCntTumor; }
+	else if (option == "max-alt-count-normal") { ivalue = &filters.maxAltCntNormal; }
+	else if (option == "min-vaf-tumor")        { dvalue = &filters.minVafTumor; }
+	else if (option == "max-vaf-normal")       { dvalue = &filters.maxVafNormal; }
+	else if (option == "min-coverage-tumor")   { ivalue = &filters.minCovTumor; }
+	else if (option == "max-coverage-tumor")   { ivalue = &filters.maxCovTumor; }
+	else if (option == "min-coverage-normal")  { ivalue = &filters.minCovNormal; }
+	else if (option == "max-coverage-normal")  { ivalue = &filters.maxCovNormal; }
+	else { return false; }
+
+	if (dvalue != NULL) { *dvalue = x; return true; }
+	if (x != floor(x)) { return false; }
+	*ivalue = (int)x;
+	return true;
+}
+
+// Caller
+//////////////////////////////////////////////////////////////
+Caller::Caller(const Config & config) : config_m(config), num_windows_m(0), num_skip_m(0)
+{
+	opened_m = false;
+}
+
+// ~Caller
+//////////////////////////////////////////////////////////////
+Caller::~Caller()
+{
+	for (unsigned int s = 0; s < sweepDB_m.size(); ++s) { delete sweepDB_m[s]; }
+}
+
+// open
+// read the contigs and the sample names from the BAM headers; the active
+// region module is turned off if the alignments have no MD tag
+//////////////////////////////////////////////////////////////
+int Caller::open()
+{
+	if (opened_m) { return 0; }
+
+	BamReader readerT;
+	// attempt to open the BamReader
+	if ( !readerT.Open(config_m.TUMOR) ) {
+		cerr << "Could not open tumor BAM file." << endl;
+		return -1;
+	}
+
+	BamReader readerN;
+	// attempt to open the BamReader
+	if ( !readerN.Open(config_m.NORMAL) ) {
+		cerr << "Could not open normal BAM file." << endl;
+		return -1;
+	}
+
+	bool found = (checkPresenceOfMDtag(readerT) || checkPresenceOfMDtag(readerN));
+	if(!found && config_m.ACTIVE_REGIONS) {
+		cerr << endl << "--------WARNING--------" << endl;
+		cerr << "The MD tag is required to select the active regions, but is missing from the alignments in the BAM(s) file(s)." << endl;
+		cerr << "To avoid unpredictable behavior, the active region module has been automatically turned off (--active-region-off)" << endl;
+		cerr << "-----------------------" << endl << endl;
+
+		config_m.ACTIVE_REGIONS = 0;
+	}
+
+	references_m = readerT.GetReferenceData(); // Extract all reference sequence entries.
+
+	SamHeader headerT = readerT.GetHeader();
+	SamHeader headerN = readerN.GetHeader();
+	Microassembler assembler;
+	sample_name_tumor_m = assembler.retriveSampleName(headerT);
+	sample_name_normal_m = assembler.retriveSampleName(headerN);
+
+	readerT.Close();
+	readerN.Close();
+
+	variantDB_m.setContigs(references_m);
+	variantDB_m.setCommandLine(config_m.COMMAND_LINE);
+
+	opened_m = true;
+	return 0;
+}
+
+// configureAssembler
+// copy the configuration parameters to an assembler
+//////////////////////////////////////////////////////////////
+void Caller::configureAssembler(const Config & config, Microassembler * assembler, Filters * filters)
+{
+	assembler->XA_FILTER = config.XA_FILTER;
+	assembler->PRIMARY_ALIGNMENT_ONLY = config.PRIMARY_ALIGNMENT_ONLY;
+	assembler->ACTIVE_REGION_MODULE = config.ACTIVE_REGIONS;
+	assembler->KMER_RECOVERY = config.KMER_RECOVERY;
+	assembler->verbose = config.verbose;
+	assembler->VERBOSE = config.VERBOSE;
+	assembler->PRINT_DOT_READS = config.PRINT_DOT_READS;
+	assembler->PRINT_ALL = config.PRINT_ALL;
+	assembler->MIN_QV_CALL = config.MIN_QV_CALL;
+	assembler->MIN_QV_TRIM = config.MIN_QV_TRIM;
+	assembler->QV_RANGE = config.QV_RANGE;
+	assembler->MIN_QUAL_TRIM = config.MIN_QV_TRIM + config.QV_RANGE;
+	assembler->MIN_QUAL_CALL = config.MIN_QV_CALL + config.QV_RANGE;
+	assembler->MIN_MAP_QUAL = config.MIN_MAP_QUAL;
+	assembler->MAX_DELTA_AS_XS = config.MAX_DELTA_AS_XS;
+	assembler->TUMOR = config.TUMOR;
+	assembler->NORMAL = config.NORMAL;
+	assembler->RG_FILE = config.RG_FILE;
+	assembler->REFFILE = config.REFFILE;
+	assembler->minK = config.minK;
+	assembler->maxK = config.maxK;
+	assembler->MAX_TIP_LEN = config.MAX_TIP_LEN;
+	assembler->MIN_THREAD_READS = config.MIN_THREAD_READS;
+	assembler->COV_THRESHOLD = config.COV_THRESHOLD;
+	assembler->MIN_COV_RATIO = config.MIN_COV_RATIO;
+	assembler->LOW_COV_THRESHOLD = config.LOW_COV_THRESHOLD;
+	assembler->MAX_AVG_COV = config.MAX_AVG_COV;
+	assembler->NODE_STRLEN = config.NODE_STRLEN;
+	assembler->DFS_LIMIT = config.DFS_LIMIT;
+	assembler->MAX_INDEL_LEN = config.MAX_INDEL_LEN;
+	assembler->MAX_MISMATCH = config.MAX_MISMATCH;
+	assembler->WINDOW_TIME_BUDGET = config.WINDOW_TIME_BUDGET;
+	assembler->WINDOW_RETRY = config.WINDOW_RETRY;
+	assembler->MAX_UNIT_LEN = config.MAX_UNIT_LEN;
+	assembler->MIN_REPORT_UNITS = config.MIN_REPORT_UNITS;
+	assembler->MIN_REPORT_LEN = config.MIN_REPORT_LEN;
+	assembler->DIST_FROM_STR = config.DIST_FROM_STR;
+	assembler->setFilters(filters);
+}
+
+// execute
+// worker thread of a call
+//////////////////////////////////////////////////////////////
+static void* execute(void* ptr) {
+
+    Microassembler* ma = (Microassembler*)ptr;
+
+	int rc = ma->processReads();
+
+	// let the workers still running use this thread for their components
+	ma->releaseSpareThreads(1);
+
+	return (rc == 0) ? NULL : ptr; // non-NULL if the inputs could not be opened
+}
+
+// call
+// find the variants of the regions (or of the genome in genome mode)
+//////////////////////////////////////////////////////////////
+int Caller::call(const vector<string> & regions)
+{
+	return run(regions, false);
+}
+
+// sweep
+// find the variants of the regions with each configuration of a parameter
+// sweep (in sweepDB_m). The reads of a window are extracted once for all
+// the configurations, so the parameters of the reads, of the windows and
+// of the run are the ones of the caller configuration; the assembly and
+// filter parameters are the ones of each configuration.
+//////////////////////////////////////////////////////////////
+int Caller::sweep(const vector<string> & regions, const vector<Config> & configs)
+{
+	if (open() != 0) { return -1; }
+
+	if (configs.empty()) {
+		cerr << "ERROR: no configuration to sweep" << endl;
+		return -1;
+	}
+	if ( (config_m.CHECKPOINT_FILE != "") || (config_m.NUM_SHARDS > 0) ) {
+		cerr << "ERROR: a parameter sweep can not be checkpointed or sharded" << endl;
+		return -1;
+	}
+	if (config_m.WINDOW_STATS_FILE != "") {
+		cerr << "ERROR: the window statistics of a parameter sweep are not supported" << endl;
+		return -1;
+	}
+	if (config_m.WINDOW_TIME_BUDGET > 0) {
+		cerr << "ERROR: a parameter sweep can not have a window time budget" << endl;
+		return -1;
+	}
+
+	for (unsigned int s = 0; s < sweepDB_m.size(); ++s) { delete sweepDB_m[s]; }
+	sweepDB_m.clear();
+	sweep_m = configs;
+
+	for (unsigned int s = 0; s < sweep_m.size(); ++s) {
+		Config & c = sweep_m[s];
+		c.TUMOR = config_m.TUMOR;
+		c.NORMAL = config_m.NORMAL;
+		c.REFFILE = config_m.REFFILE;
+		c.RG_FILE = config_m.RG_FILE;
+		c.XA_FILTER = config_m.XA_FILTER;
+		c.PRIMARY_ALIGNMENT_ONLY = config_m.PRIMARY_ALIGNMENT_ONLY;
+		c.ACTIVE_REGIONS = config_m.ACTIVE_REGIONS;
+		c.QV_RANGE = config_m.QV_RANGE;
+		c.MIN_MAP_QUAL = config_m.MIN_MAP_QUAL;
+		c.MAX_DELTA_AS_XS = config_m.MAX_DELTA_AS_XS;
+		c.MAX_AVG_COV = config_m.MAX_AVG_COV;
+		c.WINDOW_SIZE = config_m.WINDOW_SIZE;
+		c.PADDING = config_m.PADDING;
+		c.verbose = config_m.verbose;
+		c.VERBOSE = config_m.VERBOSE;
+
+		VariantDB_t * db = new VariantDB_t();
+		db->setContigs(references_m);
+		db->setCommandLine(config_m.COMMAND_LINE);
+		sweepDB_m.push_back(db);
+	}
+
+	return run(regions, true);
+}
+
+// run
+// analyze the windows of the regions with the caller configuration or
+// with the configurations of the sweep
+//////////////////////////////////////////////////////////////
+int Caller::run(const vector<string> & regions, bool sweep)
+{
+	if (open() != 0) { return -1; }
+
+	int num_threads = config_m.NUM_THREADS;
+
+	// precompute log-factorials for the fisher exact tests
+	int maxcov = config_m.filters.maxCovTumor + config_m.filters.maxCovNormal;
+	for (unsigned int s = 0; sweep && (s < sweep_m.size()); ++s) {
+		maxcov = max(maxcov, sweep_m[s].filters.maxCovTumor + sweep_m[s].filters.maxCovNormal);
+	}
+	FET_t::initLogFactorials(maxcov);
+
+	// whole-genome, sharded and multi-threaded runs take the windows from a
+	// shared queue (longest-first with more threads), the other runs
+	// analyze the reference table of their single thread
+	bool scheduled = config_m.GENOME || (config_m.NUM_SHARDS > 0) || (num_threads > 1);
+	WindowQueue_t queue;
+	vector< map<string, Ref_t *> > reftables(num_threads, map<string, Ref_t *>()); // table of references to analyze
+	if (!loadWindows(regions, queue, reftables, scheduled)) { return -1; }
+
+	if ( (config_m.NUM_SHARDS > 0) || (num_threads > 1) ) {
+		CostModel_t costmodel; // estimated cost of the windows
+		if (!costmodel.open(config_m.REFFILE, config_m.TUMOR, config_m.NORMAL, references_m, config_m.minK, config_m.maxK)) { return -1; }
+		if (!costmodel.costs(queue, num_threads)) { return -1; }
+	}
+
+	if (config_m.NUM_SHARDS > 0) {
+		shardWindows(queue);
+	}
+
+	if (scheduled) {
+		queue.schedule(num_threads);
+	}
+
+	cerr << num_windows_m << " total windows to process" << endl << endl;
+
+	Checkpoint_t checkpoint; // journal of the completed windows
+	if (config_m.CHECKPOINT_FILE != "") {
+		if (!checkpoint.open(config_m.CHECKPOINT_FILE, config_m.signature(regions), config_m.RESUME, variantDB_m, &config_m.filters)) { return -1; }
+	}
+
+	WindowStatsLog_t statslog; // statistics of the windows
+	if (config_m.WINDOW_STATS_FILE != "") {
+		if (!statslog.open(config_m.WINDOW_STATS_FILE)) { return -1; }
+	}
+
+	SpareThreads_t spare; // threads of this call released by the workers
+
+	vector<pthread_t> threads(num_threads);
+	vector<Microassembler*> assemblers(num_threads, (Microassembler *)NULL);
+	int rc;
+	int i;
+	int started = 0; // threads created
+	int status = 0;
+
+	for( i=0; i < num_threads; ++i ) {
+		if (scheduled) { cerr << "starting thread " << (i+1) << " on the shared queue of " << queue.size() << " windows" << endl; }
+		else { cerr << "starting thread " << (i+1) << " on " << reftables[i].size() << " windows" << endl; }
+
+		assemblers[i] = new Microassembler();
+		configureAssembler(config_m, assemblers[i], &config_m.filters);
+
+		assemblers[i]->reftable = &reftables[i];
+		assemblers[i]->vDB = &variantDB_m;
+		assemblers[i]->setID(i+1);
+		assemblers[i]->spare = &spare;
+		if (config_m.CHECKPOINT_FILE != "") { assemblers[i]->checkpoint = &checkpoint; }
+		if (config_m.WINDOW_STATS_FILE != "") { assemblers[i]->statslog = &statslog; }
+		if (scheduled) { assemblers[i]->queue = &queue; }
+
+		// the assemblers of the sweep share the reads extracted by the thread
+		for (unsigned int s = 0; sweep && (s < sweep_m.size()); ++s) {
+			Microassembler * ma = new Microassembler();
+			configureAssembler(sweep_m[s], ma, &sweep_m[s].filters);
+			ma->vDB = sweepDB_m[s];
+			ma->setID(i+1);
+			ma->spare = &spare;
+			assemblers[i]->sweep_m.push_back(ma);
+		}
+
+		rc = pthread_create(&threads[i], NULL, execute, (void * )assemblers[i]);
+
+		if (rc){
+			cerr << "Error:unable to create thread," << rc << endl;
+			status = -1;
+			break; // wait for the threads already started
+		}
+		++started;
+	}
+
+	// wait for the threads
+	for( i=0; i < started; ++i ){
+		void * failed = NULL;
+		rc = pthread_join(threads[i], &failed);
+		if (rc){
+			cerr << "Error:unable to join," << rc << endl;
+			status = -1;
+			continue;
+		}
+		if (failed != NULL) { status = -1; }
+		cerr << "Main: completed thread id :" << (i+1) << endl;
+	}
+
+	bool journaled = checkpoint.close(); // write the last completed windows
+	if (!statslog.close()) { status = -1; }
+
+	int tot_svn_only = 0;
+	int tot_indel_only = 0;
+	int tot_softclip_only = 0;
+	int tot_indel_or_softclip = 0;
+	int tot_snv_or_indel = 0;
+	int tot_snv_or_softclip = 0;
+	int tot_snv_or_indel_or_softclip = 0;
+	//collect per-thread statistics (variants are already in the shared DB)
+	num_skip_m = 0;
+	vector<int> sweep_skip(sweep_m.size(), 0);
+	for( i=0; i < num_threads; ++i ) {
+
+		if (assemblers[i] == NULL) { continue; } // thread creation failed before
+
+		num_skip_m += assemblers[i]->num_skip;
+		tot_svn_only += assemblers[i]->num_snv_only_regions;
+		tot_indel_only += assemblers[i]->num_indel_only_regions;
+		tot_softclip_only += assemblers[i]->num_softclip_only_regions;
+		tot_indel_or_softclip += assemblers[i]->num_indel_or_softclip_regions;
+		tot_snv_or_indel += assemblers[i]->num_snv_or_indel_regions;
+		tot_snv_or_softclip += assemblers[i]->num_snv_or_softclip_regions;
+		tot_snv_or_indel_or_softclip += assemblers[i]->num_snv_or_indel_or_softclip_regions;
+
+		for (unsigned int s = 0; s < assemblers[i]->sweep_m.size(); ++s) {
+			sweep_skip[s] += assemblers[i]->sweep_m[s]->num_skip;
+			delete assemblers[i]->sweep_m[s];
+		}
+		delete assemblers[i];
+	}
+
+	if (!journaled) { 
+		cerr << "ERROR: the checkpoint file " << config_m.CHECKPOINT_FILE << " is incomplete" << endl; 
+		status = -1;
+	}
+	if (status != 0) { return status; }
+
+	if (sweep) {
+		for (unsigned int s = 0; s < sweep_m.size(); ++s) {
+			cerr << "Configuration " << (s+1) << ": " << sweep_skip[s] << " skipped windows, " << sweepDB_m[s]->size() << " variants" << endl;
+		}
+		return 0;
+	}
+
+	cerr << "Total # of skipped windows: " << num_skip_m << " (" << (100*(double)num_skip_m/double(num_windows_m)) << "\%)" << endl;
+	cerr << "- # of windows with SNVs only: " << tot_svn_only << endl;
+	cerr << "- # of windows with indels only: " << tot_indel_only << endl;
+	cerr << "- # of windows with softclips only: " << tot_softclip_only << endl;
+	cerr << "- # of windows with indels or softclips: " << tot_indel_or_softclip << endl;
+	cerr << "- # of windows with SNVs or indels: " << tot_snv_or_indel << endl;
+	cerr << "- # of windows with SNVs or softclips: " << tot_snv_or_softclip << endl;
+	cerr << "- # of windows with SNVs or indels or softclips: " << tot_snv_or_indel_or_softclip << endl;
+
+	return 0;
+}
+
+// merge
+// merge the variants of the checkpoints of the shards of a call of the
+// regions. Windows are merged in genome order (contig in header order, 
+// then window start), so the fields VariantDB_t::addVar keeps from the 
+// first copy of a duplicate variant do not depend on the window names.
+//////////////////////////////////////////////////////////////
+int Caller::merge(const vector<string> & regions, const vector<string> & files)
+{
+	if (open() != 0) { return -1; }
+
+	WindowQueue_t windows;
+	vector< map<string, Ref_t *> > reftables(1, map<string, Ref_t *>());
+	if (!loadWindows(regions, windows, reftables, true)) { return -1; }
+
+	string signature = config_m.signature(regions);
+
+	map<string, vector<Variant_t> > completed;
+	set<string> expired;
+	for (unsigned int f = 0; f < files.size(); ++f) {
+		Checkpoint_t checkpoint;
+		if (!checkpoint.loadWindows(files[f], signature, &config_m.filters, completed, expired)) { return -1; }
+	}
+
+	// windows stopped by the time budget are skipped, as in a single run
+	int skipped = 0;
+	for (set<string>::iterator it = expired.begin(); it != expired.end(); ++it) {
+		if (completed.insert(make_pair(*it, vector<Variant_t>())).second) { ++skipped; }
+	}
+	if (skipped > 0) { cerr << "WARNING: " << skipped << " windows were skipped over the time budget (resume their shards to analyze them again)" << endl; }
+
+	// every window of the run must have been completed by one of the shards
+	vector<WindowSpan_t> spans(windows.windows_m);
+	sort(spans.begin(), spans.end()); // genome order
+	vector<vector<Variant_t> *> vars(spans.size(), (vector<Variant_t> *)NULL);
+	int missing = 0;
+	for (unsigned int i = 0; i < spans.size(); ++i) {
+		string name = windows.name(spans[i]);
+		map<string, vector<Variant_t> >::iterator it_w = completed.find(name);
+		if (it_w != completed.end()) { vars[i] = &(it_w->second); continue; }
+		if (missing == 0) { cerr << "ERROR: window " << name << " was not completed by any shard" << endl; }
+		++missing;
+	}
+	if (missing > 0) {
+		cerr << "ERROR: " << missing << " windows missing from the checkpoint files" << endl;
+		return -1;
+	}
+
+	for (unsigned int w = 0; w < vars.size(); ++w) {
+		for (unsigned int i = 0; i < vars[w]->size(); ++i) { variantDB_m.addVar((*vars[w])[i]); }
+	}
+	cerr << "Merged " << spans.size() << " windows from " << files.size() << " checkpoint files" << endl;
+
+	return 0;
+}
+
+// getVariants
+// variants of the call in VCF order (the ones printed in the VCF)
+//////////////////////////////////////////////////////////////
+void Caller::getVariants(vector<Variant_t> & variants)
+{
+	variantDB_m.getVariants(variants);
+}
+
+// printVCF
+//////////////////////////////////////////////////////////////
+void Caller::printVCF(ostream & out, const string & version)
+{
+	time_t rawtime;
+	time (&rawtime);
+	char* DATE = ctime (&rawtime);
+
+	variantDB_m.printHeader(out, version, config_m.REFFILE, DATE, config_m.filters, sample_name_normal_m, sample_name_tumor_m);
+	variantDB_m.printVariants(out);
+}
+
+// printSweepVCF
+// print the variants of the configuration s of the last sweep
+//////////////////////////////////////////////////////////////
+void Caller::printSweepVCF(ostream & out, unsigned int s, const string & version)
+{
+	time_t rawtime;
+	time (&rawtime);
+	char* DATE = ctime (&rawtime);
+
+	sweepDB_m[s]->printHeader(out, version, config_m.REFFILE, DATE, sweep_m[s].filters, sample_name_normal_m, sample_name_tumor_m);
+	sweepDB_m[s]->printVariants(out);
+}
+
+// writeEvidence
+// save the variants of the call with their raw counts (see Evidence_t)
+//////////////////////////////////////////////////////////////
+bool Caller::writeEvidence(const string & filename, const string & version)
+{
+	Evidence_t evidence;
+	evidence.version_m = version;
+	evidence.reference_m = config_m.REFFILE;
+	evidence.command_line_m = config_m.COMMAND_LINE;
+	evidence.sample_name_normal_m = sample_name_normal_m;
+	evidence.sample_name_tumor_m = sample_name_tumor_m;
+	evidence.filters_m = config_m.filters;
+	evidence.active_regions_m = config_m.ACTIVE_REGIONS;
+	getVariants(evidence.variants_m);
+
+	return evidence.write(filename);
+}
+
+// loadWindows
+// windows of the regions (or of the genome) in the reference tables of the
+// threads or, if scheduled, in the shared queue. Returns false if a contig
+// of the genome mode is not in the BAM header.
+//////////////////////////////////////////////////////////////
+bool Caller::loadWindows(const vector<string> & regions, WindowQueue_t & windows, vector< map<string, Ref_t *> > & reftables, bool scheduled)
+{
+	num_windows_m = 0;
+
+	if (!config_m.GENOME) {
+		int t = 0;
+		for (unsigned int r = 0; r < regions.size(); ++r) {
+			t = loadRefs(regions[r], reftables, t);
+		}
+	}
+
+	if (scheduled) {
+		windows.setContigs(references_m);
+		if (config_m.GENOME) { return loadGenome(windows); }
+		else { windows.addWindows(reftables); }
+	}
+	return true;
+}
+
+// loadRefs
+// windows of a region (chr or chr:start-end) with their sequence, spread
+// round-robin over the reference tables starting from the given one
+//////////////////////////////////////////////////////////////
+int Caller::loadRefs(const string & region, vector< map<string, Ref_t *> > & reftable, int thread)
+{
+	string ss;
+	string hdr = region;
+	string CHR;
+	string START;
+	string END;
+	int num_threads = reftable.size();
+
+	// extrat coordinates for header
+	size_t x     = hdr.find_first_of(':');
+
+	if ( (x == string::npos) && (hdr.length()>0) ) { // no ":" symbol found -> assume single chromosome name format
+		CHR   = hdr.substr(0,x);
+		START = "1";
+		std::vector<RefData>::iterator it;
+	    for (it = references_m.begin() ; it != references_m.end(); ++it) {
+			if (it->RefName == CHR) {
+			    std::ostringstream oss;
+			    oss << it->RefLength;
+				END = oss.str();
+				break;
+			}
+	    }
+
+		// report error if the chromosome label is not found in BAM header.
+		if (it == references_m.end()) {
+			cerr << "ERROR: chromosome label " << CHR << " not found in BAM header!" << endl;
+		}
+
+	}
+	else {
+		size_t y = hdr.find_first_of('-', x);
+		CHR  	 = hdr.substr(0,x);
+		START	 = hdr.substr(x+1, y-x-1);
+		END   	 = hdr.substr(y+1, string::npos);
+
+		int SP = stoi(START) - config_m.PADDING;
+		int EP = stoi(END) + config_m.PADDING;
+
+		if(SP<1) {SP=1;} // start position cannnot be less than 1
+		// check chromosome size
+		std::vector<RefData>::iterator it;
+	    for (it = references_m.begin() ; it != references_m.end(); ++it) {
+			if (it->RefName == CHR) {
+				if(EP > it->RefLength) { EP = it->RefLength; }
+				break;
+			}
+		}
+		// save updated coordinates
+		START = itos(SP);
+		END = itos(EP);
+	}
+	string REG = CHR+":"+START+"-"+END;
+
+	// open fasta index
+    faidx_t *fai = fai_load(config_m.REFFILE.c_str());
+    if ( !fai ) { cerr << "Could not load fai index of " << config_m.REFFILE << endl; }
+
+	// extrat sequence
+    int seq_len;
+    char *seq = fai_fetch(fai, REG.c_str(), &seq_len);
+    if ( seq_len < 0 ) { cerr << "Failed to fetch sequence in " << REG << endl; }
+
+	// convert char* to string
+	string s(seq, seq + seq_len);
+	free(seq);
+
+	// convert to upper case and change IUPAC ambiguos codes in reference to Ns
+	for (unsigned int i = 0; i < s.length(); ++i) {
+		s[i] = toupper(s[i]);
+		if(isAmbiguos(s[i])) { s[i]='N'; }
+	}
+
+	// split into overalpping windows if sequence is too long
+	int end = s.length();
+	int offset = 0;
+	int delta = 100;
+
+	int T = thread; // thread counter
+	for (; offset < end; offset+=delta) {
+
+		// adjust end if
+		int LEN = config_m.WINDOW_SIZE;
+		if( (offset + config_m.WINDOW_SIZE) >= (int)s.length() ) {
+			LEN = s.length() - offset - 1;
+			end = offset;
+		}
+
+		ss = s.substr(offset,LEN);
+
+		// make new reference entry
+		Ref_t * ref = new Ref_t(config_m.minK);
+
+		ref->refchr   = CHR;
+		ref->refstart = atoi(START.c_str()) + offset;
+		ref->refend   = ref->refstart + LEN;
+
+		hdr = ref->refchr;
+		hdr += ":";
+		hdr += itos(ref->refstart);
+		hdr += "-";
+		hdr += itos(ref->refend);
+
+		if(config_m.verbose) { cerr << "hdr:\t" << hdr << endl; }
+
+		ref->setHdr(hdr);
+		ref->setSeq(ss);
+		ref->setRawSeq(ss);
+
+		ref->hdr = hdr;
+
+		reftable[T].insert(make_pair(hdr, ref));
+		++num_windows_m;
+
+		// move to next reftable
+		++T;
+		if( (num_windows_m%num_threads) == 0) { T=0; }
+	}
+
+	fai_destroy(fai);
+
+	return T;
+}
+
+// loadGenome
+// windows of all the contigs of the BAM header (or of the listed ones,
+// minus the excluded ones), split as loadRefs splits a whole contig.
+// Returns false if a listed contig is not in the BAM header.
+//////////////////////////////////////////////////////////////
+bool Caller::loadGenome(WindowQueue_t & windows)
+{
+	unordered_set<string> included;
+	unordered_set<string> excluded;
+	string name;
+
+	istringstream iss(config_m.CONTIGS);
+	while (getline(iss, name, ',')) { if (!name.empty()) { included.insert(name); } }
+	istringstream ess(config_m.EXCLUDE_CONTIGS);
+	while (getline(ess, name, ',')) { if (!name.empty()) { excluded.insert(name); } }
+
+	unordered_set<string> found;
+	for (unsigned int i = 0; i < references_m.size(); ++i) {
+		const string & chr = references_m[i].RefName;
+		if ( !included.empty() && (included.find(chr) == included.end()) ) { continue; }
+		if (excluded.find(chr) != excluded.end()) { continue; }
+		found.insert(chr);
+
+		num_windows_m += windows.addRegion(chr, 1, references_m[i].RefLength, config_m.WINDOW_SIZE);
+	}
+
+	unordered_set<string>::iterator it;
+	for (it = included.begin(); it != included.end(); ++it) {
+		if (found.find(*it) == found.end() && excluded.find(*it) == excluded.end()) {
+			cerr << "ERROR: contig " << *it << " not found in BAM header!" << endl;
+			return false;
+		}
+	}
+
+	cerr << "Genome mode: " << found.size() << " contigs" << endl;
+	return true;
+}
+
+// shardWindows
+// partition the windows (in genome order) into NUM_SHARDS contiguous
+// shards of about the same total estimated cost and keep only the windows
+// of SHARD (1-based). The costs of the windows must have been estimated
+// already. The partition only depends on the windows, not on the number
+// of threads.
+//////////////////////////////////////////////////////////////
+void Caller::shardWindows(WindowQueue_t & windows)
+{
+	int shard = config_m.SHARD;
+	int num_shards = config_m.NUM_SHARDS;
+
+	vector<WindowSpan_t> & all = windows.windows_m;
+	sort(all.begin(), all.end());
+
+	long total = 0;
+	for (unsigned int i = 0; i < all.size(); ++i) { total += all[i].cost; }
+
+	// a window belongs to the shard containing the midpoint of its cost interval
+	vector<WindowSpan_t> kept;
+	long done = 0;
+	for (unsigned int i = 0; i < all.size(); ++i) {
+		int s = (total == 0) ? 0 : (int)(((2*done + all[i].cost) * num_shards) / (2*total));
+		if (s >= num_shards) { s = num_shards-1; }
+		done += all[i].cost;
+
+		if (s == shard-1) { kept.push_back(all[i]); }
+	}
+
+	cerr << "Shard " << shard << "/" << num_shards << ": " << kept.size() << " of " << all.size() << " windows" << endl;
+
+	all.swap(kept);
+	num_windows_m = all.size();
+}
+
+}
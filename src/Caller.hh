@@ -0,0 +1,159 @@
+#ifndef CALLER_HH
+#define CALLER_HH 1
+
+/****************************************************************************
+** Caller.hh
+**
+** Reentrant interface to the variant caller: a call is configured by a
+** Config, reads the tumor/normal BAMs of the config and returns the
+** variants of a list of regions in memory
+**
+*****************************************************************************/
+
+/************************** COPYRIGHT ***************************************
+**
+** New York Genome Center
+**
+** SOFTWARE COPYRIGHT NOTICE AGREEMENT
+** This software and its documentation are copyright (2016) by the New York
+** Genome Center. All rights are reserved. This software is supplied without
+** any warranty or guaranteed support whatsoever. The New York Genome Center
+** cannot be responsible for its use, misuse, or functionality.
+**
+** Version: 1.0.0
+** Author: Giuseppe Narzisi
+**
+*************************** /COPYRIGHT **************************************/
+
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+#include "api/BamAux.h"
+#include "Variant.hh"
+#include "VariantDB.hh"
+#include "Microassembler.hh"
+#include "Scheduler.hh"
+#include "Evidence.hh"
+
+using namespace std;
+using namespace BamTools;
+
+namespace lancet {
+
+// Configuration of a call. The defaults are the ones of the command line;
+// the names of the parameters are the ones of the Microassembler.
+struct Config
+{
+	// input files
+	string TUMOR;
+	string NORMAL;
+	string REFFILE;
+	string RG_FILE;
+	string COMMAND_LINE; // reported in the VCF header
+
+	// organization of the run
+	int NUM_THREADS;
+	string CHECKPOINT_FILE; // journal of the completed windows (disabled if empty)
+	bool RESUME;
+	int SHARD; // shard to analyze (1-based, 0 if the run is not sharded)
+	int NUM_SHARDS;
+	bool GENOME; // all the contigs of the BAM header (the region list is ignored)
+	string CONTIGS; // contigs analyzed in genome mode (comma separated, all if empty)
+	string EXCLUDE_CONTIGS; // contigs excluded in genome mode (comma separated)
+	string WINDOW_STATS_FILE; // statistics of each window (disabled if empty)
+
+	// assembly
+	bool XA_FILTER;
+	bool PRIMARY_ALIGNMENT_ONLY;
+	bool ACTIVE_REGIONS;
+	bool verbose;
+	bool VERBOSE;
+	bool KMER_RECOVERY;
+	bool PRINT_ALL;
+	bool PRINT_DOT_READS;
+	int MIN_QV_TRIM;
+	int MIN_QV_CALL;
+	int QV_RANGE;
+	int MIN_MAP_QUAL;
+	int MAX_DELTA_AS_XS;
+	int WINDOW_SIZE;
+	int PADDING;
+	int minK;
+	int maxK;
+	int MAX_TIP_LEN;
+	unsigned int MIN_THREAD_READS;
+	int COV_THRESHOLD;
+	double MIN_COV_RATIO;
+	int LOW_COV_THRESHOLD;
+	int MAX_AVG_COV;
+	int NODE_STRLEN;
+	int DFS_LIMIT;
+	int MAX_INDEL_LEN;
+	int MAX_MISMATCH;
+	double WINDOW_TIME_BUDGET; // seconds allowed for the analysis of a window (0 = no budget)
+	bool WINDOW_RETRY; // retry the windows over budget with a coarser setting
+
+	//STR parameters
+	int MAX_UNIT_LEN;
+	int MIN_REPORT_UNITS;
+	int MIN_REPORT_LEN;
+	int DIST_FROM_STR;
+
+	Filters filters; // filter thresholds
+
+	Config();
+
+	void print(ostream & out) const;
+	string signature(const vector<string> & regions) const;
+	bool set(const string & option, const string & value);
+};
+
+// A call of the variants of a list of regions (chr or chr:start-end,
+// padded as --reg) or, in genome mode, of the whole genome. All the state
+// of a call lives in its Caller, so independent callers can run
+// concurrently in the same process; a Caller runs one call at a time.
+class Caller
+{
+public:
+
+	Config config_m; // configuration of the call
+	RefVector references_m; // contigs of the tumor BAM header
+	VariantDB_t variantDB_m; // variants found by the call
+	string sample_name_normal_m;
+	string sample_name_tumor_m;
+	int num_windows_m; // windows analyzed by the call
+	int num_skip_m; // windows skipped by the call
+	vector<Config> sweep_m; // configurations of the last parameter sweep
+	vector<VariantDB_t *> sweepDB_m; // variants found by each configuration of the sweep
+
+	Caller(const Config & config);
+	~Caller();
+
+	int call(const vector<string> & regions);
+	int sweep(const vector<string> & regions, const vector<Config> & configs);
+	int merge(const vector<string> & regions, const vector<string> & files);
+	void getVariants(vector<Variant_t> & variants);
+	void printVCF(ostream & out, const string & version);
+	void printSweepVCF(ostream & out, unsigned int s, const string & version);
+	bool writeEvidence(const string & filename, const string & version);
+
+	int open();
+	static void configureAssembler(const Config & config, Microassembler * assembler, Filters * filters);
+
+private:
+	bool opened_m; // BAM headers read
+
+	int run(const vector<string> & regions, bool sweep);
+	int loadRefs(const string & region, vector< map<string, Ref_t *> > & reftable, int thread);
+	bool loadWindows(const vector<string> & regions, WindowQueue_t & windows, vector< map<string, Ref_t *> > & reftables, bool scheduled);
+	bool loadGenome(WindowQueue_t & windows);
+	void shardWindows(WindowQueue_t & windows);
+
+	Caller(const Caller &);
+	Caller & operator=(const Caller &);
+};
+
+}
+
+#endif
@@ -0,0 +1,326 @@
+#include "Checkpoint.hh"
+
+/****************************************************************************
+** Checkpoint.cc
+**
+** Journal of the completed windows and of the variants found in them, 
+** used to resume an interrupted run
+**
+*****************************************************************************/
+
+/************************** COPYRIGHT ***************************************
+**
+** New York Genome Center
+**
+** SOFTWARE COPYRIGHT NOTICE AGREEMENT
+** This software and its documentation are copyright (2016) by the New York
+** Genome Center. All rights are reserved. This software is supplied without
+** any warranty or guaranteed support whatsoever. The New York Genome Center
+** cannot be responsible for its use, misuse, or functionality.
+**
+** Version: 1.0.0
+** Author: Giuseppe Narzisi
+**
+*************************** /COPYRIGHT **************************************/
+
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const string CHECKPOINT_HEADER = "#lancet-checkpoint\t";
+
+// open
+// open the journal: if resume is true the windows and the variants of the
+// existing journal are reloaded into db, otherwise a new journal is started.
+// Returns false if the journal can not be used.
+//////////////////////////////////////////////////////////////////////////
+bool Checkpoint_t::open(const string & filename, const string & signature, bool resume, VariantDB_t & db, Filters * fs)
+{
+	filename_m = filename;
+	signature_m = signature;
+	filters_m = fs;
+
+	long size = 0; // size of the valid part of the journal
+	if (resume) {
+		vector< pair<string, vector<Variant_t> > > records;
+		set<string> expired;
+		size = load(records, expired);
+		if (size < 0) { return false; }
+		for (unsigned int r = 0; r < records.size(); ++r) {
+			for (unsigned int i = 0; i < records[r].second.size(); ++i) { db.addVar(records[r].second[i]); }
+			done_m.insert(records[r].first);
+		}
+		cerr << "Resuming from " << filename_m << ": " << done_m.size() << " windows already completed" << endl;
+		
+		int retried = 0;
+		for (set<string>::iterator it = expired.begin(); it != expired.end(); ++it) { if (!isDone(*it)) { ++retried; } }
+		if (retried > 0) { cerr << retried << " windows over the time budget are analyzed again" << endl; }
+	}
+
+	int flags = O_WRONLY | O_CREAT;
+	if (size == 0) { flags |= O_TRUNC; }
+	fd_m = ::open(filename_m.c_str(), flags, 0644);
+	if (fd_m < 0) {
+		cerr << "ERROR: could not open checkpoint file " << filename_m << ": " << strerror(errno) << endl;
+		return false;
+	}
+	
+	if (size == 0) {
+		if (!writeAll(CHECKPOINT_HEADER + signature_m + "\n")) { close(); return false; }
+	}
+	else {
+		// drop a partially written tail and append after the last complete record
+		if ( (ftruncate(fd_m, size) != 0) || (lseek(fd_m, size, SEEK_SET) < 0) ) {
+			cerr << "ERROR: could not truncate checkpoint file " << filename_m << ": " << strerror(errno) << endl;
+			close();
+			return false;
+		}
+	}
+	fsync(fd_m);
+
+	lastflush_m = time(NULL);
+	return true;
+}
+
+// loadWindows
+// read the completed windows of the journal (without opening it for 
+// writing); windows already present in the table are left unchanged.
+// The windows stopped by the time budget are added to expired.
+// Returns false if the journal can not be read.
+//////////////////////////////////////////////////////////////////////////
+bool Checkpoint_t::loadWindows(const string & filename, const string & signature, Filters * fs, map<string, vector<Variant_t> > & windows, set<string> & expired)
+{
+	filename_m = filename;
+	signature_m = signature;
+	filters_m = fs;
+	
+	vector< pair<string, vector<Variant_t> > > records;
+	long size = load(records, expired);
+	if (size < 0) { return false; }
+	if (size == 0) {
+		cerr << "ERROR: could not read checkpoint file " << filename_m << endl;
+		return false;
+	}
+	
+	for (unsigned int r = 0; r < records.size(); ++r) {
+		windows.insert(records[r]);
+	}
+	return true;
+}
+
+// load
+// read the complete records of the journal (in journal order) and the 
+// windows over the time budget, and return the size (in bytes) of the 
+// valid part of the file (0 if there is no usable journal, -1 if the file
+// is not a journal of this configuration)
+//////////////////////////////////////////////////////////////////////////
+long Checkpoint_t::load(vector< pair<string, vector<Variant_t> > > & records, set<string> & expired)
+{
+	ifstream in(filename_m.c_str());
+	if (!in.is_open()) { return 0; }
+
+	string line;
+	if (!getline(in, line) || in.eof()) { return 0; } // missing or partial header
+	
+	if (line.compare(0, CHECKPOINT_HEADER.size(), CHECKPOINT_HEADER) != 0) {
+		cerr << "ERROR: " << filename_m << " is not a checkpoint file" << endl;
+		return -1;
+	}
+	if (line.substr(CHECKPOINT_HEADER.size()) != signature_m) {
+		cerr << "ERROR: checkpoint file " << filename_m << " was written with a different configuration" << endl;
+		return -1;
+	}
+	
+	long valid = in.tellg();
+
+	string window;
+	int expected = -1;
+	vector<Variant_t> vars;
+	
+	while (getline(in, line)) {
+		if (in.eof()) { break; } // last line is not terminated: partial record
+		
+		char type = line.empty() ? 0 : line[0];
+		bool ok = (line.size() > 2) && (line[1] == '\t');
+
+		if (ok && type == 'W' && expected < 0) {
+			size_t t = line.find('\t', 2);
+			ok = (t != string::npos);
+			if (ok) {
+				window = line.substr(2, t-2);
+				expected = atoi(line.c_str()+t+1);
+				vars.clear();
+			}
+		}
+		else if (ok && type == 'V' && expected >= 0) {
+			Variant_t v;
+			ok = readVariant(line, v);
+			if (ok) { vars.push_back(v); }
+		}
+		else if (ok && type == 'E' && expected >= 0) {
+			ok = (line.substr(2) == window) && ((int)vars.size() == expected);
+			if (ok) {
+				records.push_back(make_pair(window, vars));
+				expected = -1;
+				valid = in.tellg();
+			}
+		}
+		else if (ok && type == 'O' && expected < 0) {
+			expired.insert(line.substr(2));
+			valid = in.tellg();
+		}
+		else { ok = false; }
+
+		if (!ok) { break; } // corrupted record: ignore the rest of the journal
+	}
+
+	return valid;
+}
+
+// commitWindow
+// add the record of a completed window to the journal
+//////////////////////////////////////////////////////////////////////////
+void Checkpoint_t::commitWindow(const string & window, const vector<Variant_t> & vars)
+{
+	ostringstream rec;
+	rec << "W\t" << window << "\t" << vars.size() << "\n";
+	for (unsigned int i = 0; i < vars.size(); ++i) { writeVariant(rec, vars[i]); }
+	rec << "E\t" << window << "\n";
+
+	append(rec.str());
+}
+
+// expireWindow
+// add the record of a window stopped by its time budget to the journal
+//////////////////////////////////////////////////////////////////////////
+void Checkpoint_t::expireWindow(const string & window)
+{
+	append("O\t" + window + "\n");
+}
+
+// append
+// buffer a record, writing the pending records every CHECKPOINT_INTERVAL seconds
+//////////////////////////////////////////////////////////////////////////
+void Checkpoint_t::append(const string & rec)
+{
+	pthread_mutex_lock(&lock_m);
+	if (fd_m >= 0) { pending_m += rec; }
+	if (time(NULL) - lastflush_m >= CHECKPOINT_INTERVAL) {
+		writePending();
+		lastflush_m = time(NULL);
+	}
+	pthread_mutex_unlock(&lock_m);
+}
+
+// flush
+// write all the pending records
+//////////////////////////////////////////////////////////////////////////
+void Checkpoint_t::flush()
+{
+	pthread_mutex_lock(&lock_m);
+	writePending();
+	lastflush_m = time(NULL);
+	pthread_mutex_unlock(&lock_m);
+}
+
+// close
+// write the pending records and close the journal: returns false if a 
+// write of the journal failed
+//////////////////////////////////////////////////////////////////////////
+bool Checkpoint_t::close()
+{
+	if (fd_m >= 0) {
+		flush();
+		if (fd_m >= 0) { ::close(fd_m); }
+		fd_m = -1;
+	}
+	return !failed_m;
+}
+
+// writePending
+// write the pending records (called with the lock held); after a failed 
+// write the journal is closed and the records are dropped
+//////////////////////////////////////////////////////////////////////////
+void Checkpoint_t::writePending()
+{
+	if ( (fd_m < 0) || pending_m.empty() ) { pending_m.clear(); return; }
+	
+	if (writeAll(pending_m)) { fsync(fd_m); }
+	else {
+		failed_m = true;
+		::close(fd_m);
+		fd_m = -1;
+	}
+	pending_m.clear();
+}
+
+// writeAll
+//////////////////////////////////////////////////////////////////////////
+bool Checkpoint_t::writeAll(const string & data)
+{
+	const char * p = data.c_str();
+	size_t left = data.size();
+	while (left > 0) {
+		ssize_t n = write(fd_m, p, left);
+		if (n < 0) {
+			if (errno == EINTR) { continue; }
+			cerr << "ERROR: could not write checkpoint file " << filename_m << ": " << strerror(errno) << endl;
+			return false;
+		}
+		p += n;
+		left -= n;
+	}
+	return true;
+}
+
+// writeVariant
+//////////////////////////////////////////////////////////////////////////
+void Checkpoint_t::writeVariant(ostream & out, const Variant_t & v)
+{
+	out << "V\t" << v.chr << "\t" << v.pos << "\t" << v.type << "\t" << v.len << "\t" 
+		<< v.ref << "\t" << v.alt << "\t" << (v.str.empty() ? "." : v.str) << "\t" << v.kmer << "\t"
+		<< v.ref_cov_normal_fwd << "\t" << v.ref_cov_normal_rev << "\t" 
+		<< v.ref_cov_tumor_fwd << "\t" << v.ref_cov_tumor_rev << "\t"
+		<< v.alt_cov_normal_fwd << "\t" << v.alt_cov_normal_rev << "\t" 
+		<< v.alt_cov_tumor_fwd << "\t" << v.alt_cov_tumor_rev << "\t"
+		<< v.prev_bp_ref << "\t" << v.prev_bp_alt << "\n";
+}
+
+// readVariant
+//////////////////////////////////////////////////////////////////////////
+bool Checkpoint_t::readVariant(const string & line, Variant_t & v)
+{
+	vector<string> f;
+	istringstream iss(line);
+	string token;
+	while (getline(iss, token, '\t')) { f.push_back(token); }
+	if (f.size() != 19) { return false; }
+	if (f[3].size() != 1 || f[17].size() != 1 || f[18].size() != 1) { return false; }
+
+	v.chr  = f[1];
+	v.pos  = atoi(f[2].c_str());
+	v.type = f[3][0];
+	v.len  = atoi(f[4].c_str());
+	v.ref  = f[5];
+	v.alt  = f[6];
+	v.str  = (f[7] == ".") ? "" : f[7];
+	v.kmer = atoi(f[8].c_str());
+	v.ref_cov_normal_fwd = atoi(f[9].c_str());
+	v.ref_cov_normal_rev = atoi(f[10].c_str());
+	v.ref_cov_tumor_fwd  = atoi(f[11].c_str());
+	v.ref_cov_tumor_rev  = atoi(f[12].c_str());
+	v.alt_cov_normal_fwd = atoi(f[13].c_str());
+	v.alt_cov_normal_rev = atoi(f[14].c_str());
+	v.alt_cov_tumor_fwd  = atoi(f[15].c_str());
+	v.alt_cov_tumor_rev  = atoi(f[16].c_str());
+	v.prev_bp_ref = f[17][0];
+	v.prev_bp_alt = f[18][0];
+	v.filters = filters_m;
+	v.reGenotype();
+
+	return true;
+}
@@ -0,0 +1,93 @@
+#ifndef CHECKPOINT_HH
+#define CHECKPOINT_HH 1
+
+/****************************************************************************
+** Checkpoint.hh
+**
+** Journal of the completed windows and of the variants found in them, 
+** used to resume an interrupted run
+**
+*****************************************************************************/
+
+/************************** COPYRIGHT ***************************************
+**
+** New York Genome Center
+**
+** SOFTWARE COPYRIGHT NOTICE AGREEMENT
+** This software and its documentation are copyright (2016) by the New York
+** Genome Center. All rights are reserved. This software is supplied without
+** any warranty or guaranteed support whatsoever. The New York Genome Center
+** cannot be responsible for its use, misuse, or functionality.
+**
+** Version: 1.0.0
+** Author: Giuseppe Narzisi
+**
+*************************** /COPYRIGHT **************************************/
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <unordered_set>
+#include <pthread.h>
+#include <time.h>
+#include "Variant.hh"
+#include "VariantDB.hh"
+
+using namespace std;
+
+// minimum time (in seconds) between two writes of the journal
+#define CHECKPOINT_INTERVAL 60
+
+// The journal is a text file made of a header line with the signature of 
+// the run configuration followed by one record per completed window:
+//
+//   W <window> <num variants>
+//   V <variant fields>          (one line per variant)
+//   E <window>
+//
+// or, for a window stopped by its time budget (analyzed again on resume):
+//
+//   O <window>
+//
+// Records are buffered and appended to the file every CHECKPOINT_INTERVAL 
+// seconds (and at the end of the run) with a single write followed by 
+// fsync. When the journal is reloaded only complete records are used and 
+// a partially written tail is discarded. Errors are reported on cerr and 
+// returned to the caller; after a failed write the journal is closed and 
+// the following records are dropped.
+class Checkpoint_t
+{
+public:
+
+	string filename_m; // journal file
+	string signature_m; // signature of the run configuration
+	int fd_m; // journal file descriptor (-1 if closed)
+	pthread_mutex_t lock_m; // protects the pending records
+	string pending_m; // records not written yet
+	time_t lastflush_m; // time of the last write
+	unordered_set<string> done_m; // windows completed in a previous run
+	Filters * filters_m; // filter thresholds of the reloaded variants
+	bool failed_m; // a write of the journal failed
+
+	Checkpoint_t() : fd_m(-1), lastflush_m(0), filters_m(NULL), failed_m(false) { pthread_mutex_init(&lock_m, NULL); }
+	~Checkpoint_t() { close(); pthread_mutex_destroy(&lock_m); }
+
+	bool open(const string & filename, const string & signature, bool resume, VariantDB_t & db, Filters * fs);
+	bool loadWindows(const string & filename, const string & signature, Filters * fs, map<string, vector<Variant_t> > & windows, set<string> & expired);
+	bool isDone(const string & window) const { return done_m.count(window) > 0; }
+	void commitWindow(const string & window, const vector<Variant_t> & vars);
+	void expireWindow(const string & window);
+	void flush();
+	bool close();
+
+private:
+	long load(vector< pair<string, vector<Variant_t> > > & records, set<string> & expired);
+	void append(const string & rec);
+	bool writeAll(const string & data);
+	void writePending();
+	static void writeVariant(ostream & out, const Variant_t & v);
+	bool readVariant(const string & line, Variant_t & v);
+};
+
+#endif
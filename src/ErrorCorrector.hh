@@ -26,15 +26,103 @@
 //#include <string>
 #include <iostream>
 #include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
 
 using namespace std;
 
+// MerBucket_t
+// half of a k-mer (hashed) and the node holding it
+//////////////////////////////////////////////////////////////////////////
+
+typedef pair<uint64_t, MerTable_t::iterator> MerBucket_t;
+
 class ErrorCorrector
 {
 public:
 
+	// neighbourhood index: a k-mer one substitution away from another shares 
+	// either its left or its right half, so the candidate nodes are found by 
+	// looking up the bucket of the half without the substituted position
+	vector<MerBucket_t> left_m;  // nodes bucketed by the first half of the k-mer
+	vector<MerBucket_t> right_m; // nodes bucketed by the second half of the k-mer
+
 	ErrorCorrector() { }
 	
+	static bool bucketLess(const MerBucket_t & a, const MerBucket_t & b) { return a.first < b.first; }
+
+	// hashHalf
+	// FNV-1a hash of mer[from,to), or of the same range of the reverse 
+	// complement of mer if rc is true
+	//////////////////////////////////////////////////////////////////////////
+	
+	static uint64_t hashHalf(const Mer_t & mer, int from, int to, bool rc) {
+		uint64_t h = 14695981039346656037ULL;
+		int M = mer.size()-1;
+		for (int p = from; p < to; p++) {
+			char c = rc ? rrc(mer[M-p]) : mer[p];
+			h = (h ^ (unsigned char)c) * 1099511628211ULL;
+		}
+		return h;
+	}
+	
+	// findBucket
+	// range of the nodes with the given hash in the index
+	//////////////////////////////////////////////////////////////////////////
+	
+	static pair<int,int> findBucket(const vector<MerBucket_t> & index, uint64_t h) {
+		MerBucket_t key(h, MerTable_t::iterator());
+		pair<vector<MerBucket_t>::const_iterator, vector<MerBucket_t>::const_iterator> r = equal_range(index.begin(), index.end(), key, bucketLess);
+		return make_pair((int)(r.first - index.begin()), (int)(r.second - index.begin()));
+	}
+	
+	// findNeighbour
+	// node of the bucket whose k-mer is mer (reverse complemented if rc) 
+	// with base b at position pos; nodes_m.end() if none
+	//////////////////////////////////////////////////////////////////////////
+	
+	static MerTable_t::iterator findNeighbour(MerTable_t & nodes_m, const vector<MerBucket_t> & index, pair<int,int> bucket, const Mer_t & mer, bool rc, int pos, char b) {
+		int M = mer.size()-1;
+		for (int e = bucket.first; e < bucket.second; e++) {
+			const Mer_t & merB = index[e].second->first;
+			if ( ((int)merB.size() != M+1) || (merB[pos] != b) ) { continue; }
+			
+			bool same = true;
+			for (int p = 0; p <= M && same; p++) {
+				if (p == pos) { continue; }
+				char c = rc ? rrc(mer[M-p]) : mer[p];
+				same = (merB[p] == c);
+			}
+			if (same) { return index[e].second; }
+		}
+		return nodes_m.end();
+	}
+	
+	// buildIndex
+	// index the nodes that can absorb errors (only k-mers with support >= 
+	// MIN_SUPPORT are used and coverage is only added to those)
+	//////////////////////////////////////////////////////////////////////////
+	
+	void buildIndex(MerTable_t & nodes_m, int MIN_SUPPORT) {
+		
+		left_m.clear();
+		right_m.clear();
+		
+		MerTable_t::iterator mi;
+		for (mi = nodes_m.begin(); mi != nodes_m.end(); mi++) {
+			if (mi->second->getTotTmrCov() < MIN_SUPPORT) { continue; }
+			
+			const Mer_t & mer = mi->first;
+			int h = mer.size()/2;
+			left_m.push_back(MerBucket_t(hashHalf(mer, 0, h, false), mi));
+			right_m.push_back(MerBucket_t(hashHalf(mer, h, mer.size(), false), mi));
+		}
+		
+		sort(left_m.begin(), left_m.end(), bucketLess);
+		sort(right_m.begin(), right_m.end(), bucketLess);
+	}
+	
 	void mersRecovery(MerTable_t & nodes_m, int MIN_SUPPORT, int MIN_QV) {
 		
 		//cerr << "mers recovery" << endl;
@@ -44,19 +132,29 @@ public:
 		MerTable_t::iterator mi;
 		MerTable_t::iterator mjF;
 		MerTable_t::iterator mjR;
+		
+		buildIndex(nodes_m, MIN_SUPPORT);
+		if (left_m.empty()) { return; }
 	
 		for (mi = nodes_m.begin(); mi != nodes_m.end(); mi++) {
 			Node_t * nodeA = mi->second;
 						
 			if(nodeA->getTotTmrCov() == 1) { // only process tumor singletons
 			
-				Mer_t merA = mi->first;
-				Mer_t merA_original = merA;
-				char old_bp;
+				const Mer_t & merA = mi->first;
+				int M = merA.size()-1;
+				int h = merA.size()/2;
+				
+				// buckets of the halves of the mer (both fwd and rev)
+				pair<int,int> leftF  = findBucket(left_m,  hashHalf(merA, 0, h, false));
+				pair<int,int> rightF = findBucket(right_m, hashHalf(merA, h, M+1, false));
+				pair<int,int> leftR  = findBucket(left_m,  hashHalf(merA, 0, h, true));
+				pair<int,int> rightR = findBucket(right_m, hashHalf(merA, h, M+1, true));
+				
 				// test changing each bp in the mer
 				
 				int num_changes = 0; // number of succesfull bp changes for this mer
-				for (unsigned int i=0; i<merA.size(); i++) {
+				for (int i=0; i<=M; i++) {
 					
 					//if(num_changes > 0) { break; } // allow only one base to be changed per mer
 						
@@ -64,18 +162,19 @@ public:
 					if(qv_covA == 0) { // if low quality base in tumor
 					
 						// change bp to any of the 3 other possibile bp
-						old_bp = merA[i]; // save old bp
 						for (unsigned int j=0; j<4; j++) {
-							if(BP[j] != merA[i]) { merA[i] = BP[j]; }
+							if(BP[j] == merA[i]) { continue; }
 					
-							// search for the modified mer (both fwd and rev)
-							Mer_t merAr = rc_str(merA);
-							mjF = nodes_m.find(merA); // forward
-							mjR = nodes_m.find(merAr); // reverse
+							// search for the modified mer (both fwd and rev): the substituted 
+							// position is in the other half of the bucket used
+							if (i >= h) { mjF = findNeighbour(nodes_m, left_m, leftF, merA, false, i, BP[j]); } 
+							else        { mjF = findNeighbour(nodes_m, right_m, rightF, merA, false, i, BP[j]); }
+							
+							if (M-i >= h) { mjR = findNeighbour(nodes_m, left_m, leftR, merA, true, M-i, rrc(BP[j])); }
+							else          { mjR = findNeighbour(nodes_m, right_m, rightR, merA, true, M-i, rrc(BP[j])); }
 
 							// update forward mer (if found)
 							if(mjF != nodes_m.end() && mjF != mi) { 
-								Mer_t merB = mjF->first;
 								Node_t * nodeB = mjF->second;
 								int qv_covB = (nodeB->cov_distr_tmr[i]).minqv_fwd + (nodeB->cov_distr_tmr[i]).minqv_rev;
 					
@@ -99,11 +198,10 @@ public:
 							
 							// update reverse mer (if found)
 							if(mjR != nodes_m.end() && mjR != mi) { 
-								Mer_t merB = mjR->first;
 								Node_t * nodeB = mjR->second;
 								
 								// for reverse complement need to adjust array index to find correct base position
-								int M = merB.size()-1;
+								int M = mjR->first.size()-1;
 								int qv_covB = (nodeB->cov_distr_tmr[M-i]).minqv_fwd + (nodeB->cov_distr_tmr[M-i]).minqv_rev;
 					
 								// merB has only 1 difference from merA
@@ -126,7 +224,6 @@ public:
 							
 							
 						}
-						merA[i] = old_bp; //revert changed bp
 					}		
 				}
 			}
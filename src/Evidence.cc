@@ -0,0 +1,317 @@
+#include "Evidence.hh"
+
+/****************************************************************************
+** Evidence.cc
+**
+** Binary file of the candidate variants of a run with their raw read
+** counts, used to regenerate the VCF under new filter thresholds without
+** assembling the regions again
+**
+*****************************************************************************/
+
+/************************** COPYRIGHT ***************************************
+**
+** New York Genome Center
+**
+** SOFTWARE COPYRIGHT NOTICE AGREEMENT
+** This software and its documentation are copyright (2016) by the New York
+** Genome Center. All rights are reserved. This software is supplied without
+** any warranty or guaranteed support whatsoever. The New York Genome Center
+** cannot be responsible for its use, misuse, or functionality.
+**
+** Version: 1.0.0
+** Author: Giuseppe Narzisi
+**
+*************************** /COPYRIGHT **************************************/
+
+#include <fstream>
+#include <cstring>
+#include <unordered_map>
+#include <time.h>
+#include "VariantDB.hh"
+
+#define EVIDENCE_MAGIC "LANCETEV"
+#define EVIDENCE_FORMAT 1
+
+// write
+// save the run information and the variants to file
+//////////////////////////////////////////////////////////////////////////
+bool Evidence_t::write(const string & filename)
+{
+	ofstream out(filename.c_str(), ios::out | ios::binary | ios::trunc);
+	if (!out.is_open()) {
+		cerr << "ERROR: could not write evidence file " << filename << endl;
+		return false;
+	}
+
+	// contig table (in order of first appearance)
+	vector<string> contigs;
+	unordered_map<string, unsigned int> ids;
+	for (unsigned int i = 0; i < variants_m.size(); ++i) {
+		if (ids.insert(make_pair(variants_m[i].chr, (unsigned int)contigs.size())).second) {
+			contigs.push_back(variants_m[i].chr);
+		}
+	}
+
+	string buf(EVIDENCE_MAGIC);
+	putInt(buf, EVIDENCE_FORMAT);
+	putString(buf, version_m);
+	putString(buf, reference_m);
+	putString(buf, command_line_m);
+	putString(buf, sample_name_normal_m);
+	putString(buf, sample_name_tumor_m);
+	putDouble(buf, filters_m.minPhredFisherSTR);
+	putDouble(buf, filters_m.minPhredFisher);
+	putDouble(buf, filters_m.maxVafNormal);
+	putDouble(buf, filters_m.minVafTumor);
+	putInt(buf, filters_m.minCovNormal);
+	putInt(buf, filters_m.maxCovNormal);
+	putInt(buf, filters_m.minCovTumor);
+	putInt(buf, filters_m.maxCovTumor);
+	putInt(buf, filters_m.minAltCntTumor);
+	putInt(buf, filters_m.maxAltCntNormal);
+	putInt(buf, filters_m.minStrandBias);
+	putInt(buf, active_regions_m);
+	putInt(buf, contigs.size());
+	for (unsigned int c = 0; c < contigs.size(); ++c) { putString(buf, contigs[c]); }
+	putInt(buf, variants_m.size());
+	out.write(buf.data(), buf.size());
+
+	unsigned int last_cid = 0;
+	int64_t last_pos = 0;
+	for (unsigned int i = 0; i < variants_m.size(); ++i) {
+		const Variant_t & v = variants_m[i];
+		unsigned int cid = ids[v.chr];
+		if (cid != last_cid) { last_pos = 0; }
+
+		// positions are sorted within a contig, the delta is zigzag encoded anyway
+		int64_t delta = (int64_t)v.pos - last_pos;
+		last_cid = cid;
+		last_pos = v.pos;
+
+		buf.clear();
+		putInt(buf, cid);
+		putInt(buf, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+		buf += v.type;
+		putInt(buf, v.len);
+		putInt(buf, v.kmer);
+		putString(buf, v.ref);
+		putString(buf, v.alt);
+		putString(buf, v.str);
+		putInt(buf, v.ref_cov_normal_fwd);
+		putInt(buf, v.ref_cov_normal_rev);
+		putInt(buf, v.ref_cov_tumor_fwd);
+		putInt(buf, v.ref_cov_tumor_rev);
+		putInt(buf, v.alt_cov_normal_fwd);
+		putInt(buf, v.alt_cov_normal_rev);
+		putInt(buf, v.alt_cov_tumor_fwd);
+		putInt(buf, v.alt_cov_tumor_rev);
+		buf += v.prev_bp_ref;
+		buf += v.prev_bp_alt;
+		out.write(buf.data(), buf.size());
+	}
+
+	// trailer
+	buf = EVIDENCE_MAGIC;
+	putInt(buf, variants_m.size());
+	out.write(buf.data(), buf.size());
+
+	out.close();
+	if (out.fail()) {
+		cerr << "ERROR: could not write evidence file " << filename << endl;
+		return false;
+	}
+
+	cerr << "Saved " << variants_m.size() << " variants to " << filename << endl;
+	return true;
+}
+
+// read
+// load the run information and the variants of a file (the variants use
+// the filter thresholds fs)
+//////////////////////////////////////////////////////////////////////////
+bool Evidence_t::read(const string & filename, Filters * fs)
+{
+	ifstream in(filename.c_str(), ios::in | ios::binary);
+	if (!in.is_open()) {
+		cerr << "ERROR: could not read evidence file " << filename << endl;
+		return false;
+	}
+
+	string magic(sizeof(EVIDENCE_MAGIC) - 1, ' ');
+	uint64_t format = 0;
+	in.read(&magic[0], magic.size());
+	if ( !in || (magic != EVIDENCE_MAGIC) || !getInt(in, format) ) {
+		cerr << "ERROR: " << filename << " is not a lancet evidence file" << endl;
+		return false;
+	}
+	if (format != EVIDENCE_FORMAT) {
+		cerr << "ERROR: unsupported format " << format << " of evidence file " << filename << endl;
+		return false;
+	}
+
+	uint64_t num_contigs = 0;
+	uint64_t num_variants = 0;
+	uint64_t f[8];
+	bool ok = getString(in, version_m) && getString(in, reference_m) && getString(in, command_line_m) &&
+		getString(in, sample_name_normal_m) && getString(in, sample_name_tumor_m) &&
+		getDouble(in, filters_m.minPhredFisherSTR) && getDouble(in, filters_m.minPhredFisher) &&
+		getDouble(in, filters_m.maxVafNormal) && getDouble(in, filters_m.minVafTumor);
+	for (int i = 0; ok && i < 8; ++i) { ok = getInt(in, f[i]); }
+	ok = ok && getInt(in, num_contigs);
+	if (ok) {
+		filters_m.minCovNormal = f[0];
+		filters_m.maxCovNormal = f[1];
+		filters_m.minCovTumor = f[2];
+		filters_m.maxCovTumor = f[3];
+		filters_m.minAltCntTumor = f[4];
+		filters_m.maxAltCntNormal = f[5];
+		filters_m.minStrandBias = f[6];
+		active_regions_m = (f[7] != 0);
+	}
+
+	vector<string> contigs;
+	for (uint64_t c = 0; ok && c < num_contigs; ++c) {
+		string name;
+		ok = getString(in, name);
+		contigs.push_back(name);
+	}
+	ok = ok && getInt(in, num_variants);
+
+	variants_m.clear();
+	uint64_t last_cid = 0;
+	int64_t last_pos = 0;
+	for (uint64_t i = 0; ok && i < num_variants; ++i) {
+		Variant_t v;
+		uint64_t cid, delta, len, kmer;
+		uint64_t cnt[8];
+		char type = 0;
+		char prev[2] = { 0, 0 };
+
+		ok = getInt(in, cid) && (cid < contigs.size()) && getInt(in, delta) && in.get(type) &&
+			getInt(in, len) && getInt(in, kmer) && getString(in, v.ref) && getString(in, v.alt) && getString(in, v.str);
+		for (int c = 0; ok && c < 8; ++c) { ok = getInt(in, cnt[c]); }
+		ok = ok && in.read(prev, 2);
+		if (!ok) { break; }
+
+		if (cid != last_cid) { last_pos = 0; }
+		last_cid = cid;
+		last_pos += (int64_t)(delta >> 1) ^ -(int64_t)(delta & 1);
+
+		v.chr = contigs[cid];
+		v.pos = last_pos;
+		v.type = type;
+		v.len = len;
+		v.kmer = kmer;
+		v.ref_cov_normal_fwd = cnt[0];
+		v.ref_cov_normal_rev = cnt[1];
+		v.ref_cov_tumor_fwd  = cnt[2];
+		v.ref_cov_tumor_rev  = cnt[3];
+		v.alt_cov_normal_fwd = cnt[4];
+		v.alt_cov_normal_rev = cnt[5];
+		v.alt_cov_tumor_fwd  = cnt[6];
+		v.alt_cov_tumor_rev  = cnt[7];
+		v.prev_bp_ref = prev[0];
+		v.prev_bp_alt = prev[1];
+		v.filters = fs;
+		v.reGenotype();
+		variants_m.push_back(v);
+	}
+
+	// the trailer is written last: a truncated file is rejected
+	uint64_t n = 0;
+	if (ok) {
+		in.read(&magic[0], magic.size());
+		ok = in && (magic == EVIDENCE_MAGIC) && getInt(in, n) && (n == num_variants);
+	}
+	if (!ok) {
+		cerr << "ERROR: evidence file " << filename << " is truncated or corrupted" << endl;
+		variants_m.clear();
+		return false;
+	}
+
+	cerr << "Loaded " << variants_m.size() << " variants from " << filename << endl;
+	return true;
+}
+
+// printVCF
+// print the variants in VCF format under the filter thresholds fs
+//////////////////////////////////////////////////////////////////////////
+void Evidence_t::printVCF(ostream & out, const string & version, const string & command_line, Filters & fs)
+{
+	time_t rawtime;
+	time (&rawtime);
+	char* DATE = ctime (&rawtime);
+
+	VariantDB_t db;
+	db.setCommandLine(command_line);
+	db.printHeader(out, version, reference_m, DATE, fs, sample_name_normal_m, sample_name_tumor_m);
+
+	for (unsigned int i = 0; i < variants_m.size(); ++i) {
+		variants_m[i].filters = &fs;
+		variants_m[i].printVCF(out);
+	}
+}
+
+// putInt
+//////////////////////////////////////////////////////////////////////////
+void Evidence_t::putInt(string & buf, uint64_t x)
+{
+	while (x >= 0x80) {
+		buf += (char)((x & 0x7f) | 0x80);
+		x >>= 7;
+	}
+	buf += (char)x;
+}
+
+// putString
+//////////////////////////////////////////////////////////////////////////
+void Evidence_t::putString(string & buf, const string & s)
+{
+	putInt(buf, s.size());
+	buf += s;
+}
+
+// putDouble
+//////////////////////////////////////////////////////////////////////////
+void Evidence_t::putDouble(string & buf, double x)
+{
+	uint64_t bits;
+	memcpy(&bits, &x, sizeof(bits));
+	putInt(buf, bits);
+}
+
+// getInt
+//////////////////////////////////////////////////////////////////////////
+bool Evidence_t::getInt(istream & in, uint64_t & x)
+{
+	x = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		int c = in.get();
+		if (c == EOF) { return false; }
+		x |= (uint64_t)(c & 0x7f) << shift;
+		if ((c & 0x80) == 0) { return true; }
+	}
+	return false;
+}
+
+// getString
+//////////////////////////////////////////////////////////////////////////
+bool Evidence_t::getString(istream & in, string & s)
+{
+	uint64_t n = 0;
+	if (!getInt(in, n) || n > (1 << 30)) { return false; }
+	s.resize(n);
+	if (n > 0) { in.read(&s[0], n); }
+	return (bool)in;
+}
+
+// getDouble
+//////////////////////////////////////////////////////////////////////////
+bool Evidence_t::getDouble(istream & in, double & x)
+{
+	uint64_t bits;
+	if (!getInt(in, bits)) { return false; }
+	memcpy(&x, &bits, sizeof(x));
+	return true;
+}
@@ -0,0 +1,75 @@
+#ifndef EVIDENCE_HH
+#define EVIDENCE_HH 1
+
+/****************************************************************************
+** Evidence.hh
+**
+** Binary file of the candidate variants of a run with their raw read
+** counts, used to regenerate the VCF under new filter thresholds without
+** assembling the regions again
+**
+*****************************************************************************/
+
+/************************** COPYRIGHT ***************************************
+**
+** New York Genome Center
+**
+** SOFTWARE COPYRIGHT NOTICE AGREEMENT
+** This software and its documentation are copyright (2016) by the New York
+** Genome Center. All rights are reserved. This software is supplied without
+** any warranty or guaranteed support whatsoever. The New York Genome Center
+** cannot be responsible for its use, misuse, or functionality.
+**
+** Version: 1.0.0
+** Author: Giuseppe Narzisi
+**
+*************************** /COPYRIGHT **************************************/
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <stdint.h>
+#include "Variant.hh"
+
+using namespace std;
+
+// The file starts with a magic string and the format version followed by
+// the run information (lancet version, reference, command line, sample
+// names and filter thresholds), the table of the contig names and the
+// variants in VCF order.
+// Integers are stored as LEB128 varints and the positions as differences
+// from the previous variant of the same contig; strings are prefixed by
+// their length. A trailer with the number of variants detects truncated
+// files. The filters are computed from the raw counts when the VCF is
+// printed, so any threshold can be applied to the file; the only exception
+// is the minimum alternative count in the tumor, which also selects the
+// active regions assembled by the run.
+class Evidence_t
+{
+public:
+
+	string version_m; // lancet version of the run
+	string reference_m; // reference (FASTA) of the run
+	string command_line_m; // command line of the run
+	string sample_name_normal_m;
+	string sample_name_tumor_m;
+	Filters filters_m; // filter thresholds of the run
+	bool active_regions_m; // windows selected by the active region module
+	vector<Variant_t> variants_m; // candidate variants in VCF order
+
+	Evidence_t() : active_regions_m(false) { }
+
+	bool write(const string & filename);
+	bool read(const string & filename, Filters * fs);
+	void printVCF(ostream & out, const string & version, const string & command_line, Filters & fs);
+
+private:
+	static void putInt(string & buf, uint64_t x);
+	static void putString(string & buf, const string & s);
+	static void putDouble(string & buf, double x);
+	static bool getInt(istream & in, uint64_t & x);
+	static bool getString(istream & in, string & s);
+	static bool getDouble(istream & in, double & x);
+};
+
+#endif
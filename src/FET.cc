@@ -0,0 +1,96 @@
+#include "FET.hh"
+
+/****************************************************************************
+** FET.cc
+**
+** Fisher's exact test with precomputed log-factorials and cached results
+**
+*****************************************************************************/
+
+/************************** COPYRIGHT ***************************************
+**
+** New York Genome Center
+**
+** SOFTWARE COPYRIGHT NOTICE AGREEMENT
+** This software and its documentation are copyright (2016) by the New York
+** Genome Center. All rights are reserved. This software is supplied without
+** any warranty or guaranteed support whatsoever. The New York Genome Center
+** cannot be responsible for its use, misuse, or functionality.
+**
+** Version: 1.0.0
+** Author: Giuseppe Narzisi
+**
+*************************** /COPYRIGHT **************************************/
+
+atomic<lfacttable_t *> FET_t::lfact_m(NULL);
+atomic<int> FET_t::lfact_max_m(0);
+pthread_mutex_t FET_t::lfact_lock_m = PTHREAD_MUTEX_INITIALIZER;
+vector<lfacttable_t *> FET_t::lfact_old_m;
+thread_local fetcache_t FET_t::cache_m[FET_CACHE_SIZE];
+
+// initLogFactorials
+// request log(i!) for i in [0,n] (n is the maximum coverage of a 
+// configuration). Nothing is allocated here: the table is built by the 
+// first test that reads it, at the largest size requested so far.
+//////////////////////////////////////////////////////////////
+void FET_t::initLogFactorials(int n)
+{
+	if (n > FET_MAX_TABLE) { n = FET_MAX_TABLE; }
+	if (n < 0) { n = 0; }
+
+	pthread_mutex_lock(&lfact_lock_m);
+	if (n+1 > lfact_max_m.load(memory_order_relaxed)) { lfact_max_m.store(n+1, memory_order_relaxed); }
+	pthread_mutex_unlock(&lfact_lock_m);
+}
+
+// growLogFactorials
+// build the table at the requested size, extending the current one. 
+// The larger table is published as a whole, so the threads reading the 
+// previous one are not affected; replaced tables are kept until exit.
+//////////////////////////////////////////////////////////////
+lfacttable_t * FET_t::growLogFactorials()
+{
+	pthread_mutex_lock(&lfact_lock_m);
+	lfacttable_t * t = lfact_m.load(memory_order_relaxed);
+	int size = lfact_max_m.load(memory_order_relaxed);
+	if (t == NULL || t->size < size) {
+		lfacttable_t * g = new lfacttable_t;
+		g->size = size;
+		g->v = new double[size];
+		int i = 0;
+		if (t != NULL) { for (; i < t->size; ++i) { g->v[i] = t->v[i]; } lfact_old_m.push_back(t); }
+		for (; i < size; ++i) { g->v[i] = lgamma(i+1); }
+		lfact_m.store(g, memory_order_release);
+		t = g;
+	}
+	pthread_mutex_unlock(&lfact_lock_m);
+
+	return t;
+}
+
+// kt_fisher_exact
+// fisher exact test on the 2x2 table, results are cached by table in 
+// the cache of the calling thread (no locking)
+//////////////////////////////////////////////////////////////
+double FET_t::kt_fisher_exact(int n11, int n12, int n21, int n22, double *_left, double *_right, double *two)
+{
+	unsigned int h = (unsigned int)n11;
+	h = h * 31 + (unsigned int)n12;
+	h = h * 31 + (unsigned int)n21;
+	h = h * 31 + (unsigned int)n22;
+	h ^= h >> 13;
+	fetcache_t & e = cache_m[h & (FET_CACHE_SIZE-1)];
+
+	if (e.valid && e.n11 == n11 && e.n12 == n12 && e.n21 == n21 && e.n22 == n22) {
+		*_left = e.left; *_right = e.right; *two = e.two;
+		return e.q;
+	}
+
+	double q = fisher_exact(n11, n12, n21, n22, _left, _right, two);
+
+	e.n11 = n11; e.n12 = n12; e.n21 = n21; e.n22 = n22;
+	e.q = q; e.left = *_left; e.right = *_right; e.two = *two;
+	e.valid = true;
+
+	return q;
+}
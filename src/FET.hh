@@ -30,20 +30,57 @@
 
 #include <math.h>
 #include <stdlib.h>
+#include <vector>
+#include <pthread.h>
+#include <atomic>
 
 using namespace std;
 
+#define FET_CACHE_SIZE 4096 // number of entries of the Fisher test cache of a thread (power of 2)
+#define FET_MAX_TABLE (1<<21) // max size of the log-factorial table
+
+// cached result of a fisher exact test
+typedef struct {
+	int n11, n12, n21, n22;
+	double q, left, right, two;
+	bool valid;
+} fetcache_t;
+
+// log-factorial table: v[n] = log(n!) for n < size
+typedef struct {
+	int size;
+	double * v;
+} lfacttable_t;
+
 class FET_t
 {
 public:
 
+	static atomic<lfacttable_t *> lfact_m; // current table (NULL until a test needs it)
+	static atomic<int> lfact_max_m; // entries requested by the configurations of the process
+	static pthread_mutex_t lfact_lock_m; // serializes the growth of the table
+	static vector<lfacttable_t *> lfact_old_m; // tables replaced by a larger one (still read by other threads)
+	static thread_local fetcache_t cache_m[FET_CACHE_SIZE]; // direct-mapped cache keyed by 2x2 table (one per thread)
+
 	FET_t() {}
 
+	static void initLogFactorials(int n);
+	static lfacttable_t * growLogFactorials();
+
+	// log(n!)
+	static double lfact(int n)
+	{
+		lfacttable_t * t = lfact_m.load(memory_order_acquire);
+		if (t != NULL && n < t->size) return t->v[n];
+		if (n < lfact_max_m.load(memory_order_relaxed)) return growLogFactorials()->v[n];
+		return lgamma(n+1);
+	}
+
 	// log\binom{n}{k}
 	static double lbinom(int n, int k)
 	{
 		if (k == 0 || n == k) return 0;
-		return lgamma(n+1) - lgamma(k+1) - lgamma(n-k+1);
+		return lfact(n) - lfact(k) - lfact(n-k);
 	}
 
 	// n11  n12  | n1_
@@ -88,7 +125,9 @@ public:
 		return aux->p;
 	}
 
-	double kt_fisher_exact(int n11, int n12, int n21, int n22, double *_left, double *_right, double *two)
+	double kt_fisher_exact(int n11, int n12, int n21, int n22, double *_left, double *_right, double *two);
+
+	double fisher_exact(int n11, int n12, int n21, int n22, double *_left, double *_right, double *two)
 	{
 		int i, j, max, min;
 		double p, q, left, right;
@@ -24,6 +24,23 @@
 **
 *************************** /COPYRIGHT **************************************/
 
+// constants
+//////////////////////////////////////////////////////////////////////////
+
+const char Graph_t::CODE_MAPPED = 'M';
+const char Graph_t::CODE_BASTARD = 'B';
+
+const string Graph_t::COLOR_ALL    = "white"; 
+const string Graph_t::COLOR_LOW    = "grey";
+const string Graph_t::COLOR_NOVO   = "darkorange3";
+const string Graph_t::COLOR_TUMOR  = "red";
+const string Graph_t::COLOR_NORMAL = "green";
+const string Graph_t::COLOR_SHARED = "blue"; //"deepskyblue4";
+const string Graph_t::COLOR_SOURCE = "orange\" style=\"filled";
+const string Graph_t::COLOR_SINK   = "yellow\" style=\"filled";
+const string Graph_t::COLOR_TOUCH  = "magenta";
+
+
 // clear edge flags
 //////////////////////////////////////////////////////////////
 void Graph_t::clear(bool flag)
@@ -31,6 +48,7 @@ void Graph_t::clear(bool flag)
 	if(flag) {
 		//readid2info.clear();
 		vector<ReadInfo_t>().swap(readid2info); 
+		readstore_m.clear();
 		is_ref_added = false; // reference reads was in readid2info and removed
 	}
 	totalreadbp_m = 0;
@@ -42,6 +60,9 @@ void Graph_t::clear(bool flag)
 	}
 	nodes_m.clear();
 	unordered_map<Mer_t, Node_t *>().swap(nodes_m);	
+	vector< vector<Node_t *> >().swap(compnodes_m);
+	cyclefree_m = false;
+	cycletouched_m.clear();
 	//sparse_hash_map<Mer_t, Node_t *>().swap(nodes_m);
 	//hopscotch_map<Mer_t, Node_t *, hash<Mer_t>, equal_to<Mer_t>, allocator<pair<Mer_t,Node_t *>>, 30, true>().swap(nodes_m);
 
@@ -50,8 +71,10 @@ void Graph_t::clear(bool flag)
 
 	if (ref_m && flag == true)
 	{
-		ref_m->clear();
-		delete ref_m;
+		if (ownref_m) {
+			ref_m->clear();
+			delete ref_m;
+		}
 		ref_m = NULL;
 	}	
 }
@@ -68,8 +91,13 @@ void Graph_t::loadSequence(int readid, const string & seq, const string & qv, bo
 		
 	CanonicalMer_t uc;
 	CanonicalMer_t vc;
-	string uc_qv;
-	string vc_qv;
+	
+	// prefix counts of low quality bases: the k-mer starting at offset o
+	// is above quality iff lowqv_m[o+K] == lowqv_m[o]
+	int qvlen = qv.length();
+	lowqv_m.resize(qvlen+1);
+	lowqv_m[0] = 0;
+	for (int i = 0; i < qvlen; ++i) { lowqv_m[i+1] = lowqv_m[i] + ((qv[i] < MIN_QUAL_CALL) ? 1 : 0); }
 	
 	Node_t * unode = NULL;
 	Node_t * vnode = NULL;
@@ -86,18 +114,15 @@ void Graph_t::loadSequence(int readid, const string & seq, const string & qv, bo
 		if (offset == 0) {
 			uc.set(seq.substr(offset,   K));
 			vc.set(seq.substr(offset+1, K));	
-			uc_qv = qv.substr(offset,   K);
-			vc_qv = qv.substr(offset+1, K);
-			if (uc.ori_m == R) { reverse(uc_qv); }
-			if (vc.ori_m == R) { reverse(vc_qv); }
 		}
 		else {
 			uc = vc; 
-			uc_qv = vc_qv; 
 			vc.set(seq.substr(offset+1, K));
-			vc_qv = qv.substr(offset+1, K);
-			if (vc.ori_m == R) { reverse(vc_qv); }
 		}
+		
+		// base qualities of the k-mers (reversed when the canonical k-mer is reverse oriented)
+		const char * uc_qv = qv.data() + offset;
+		const char * vc_qv = qv.data() + offset + 1;
 
 		//cerr << readid << "\t" << offset << "\t" << uc << "\t" << vc << endl;
 		
@@ -147,7 +172,9 @@ void Graph_t::loadSequence(int readid, const string & seq, const string & qv, bo
 			vnode->updateCovStatus('N');
 		}
 						
-		if( (seqAboveQual(uc_qv,MIN_QUAL_CALL) && seqAboveQual(vc_qv,MIN_QUAL_CALL)) ) {
+		int uc_end = min(offset+K, qvlen);
+		int vc_end = min(offset+1+K, qvlen);
+		if( (lowqv_m[uc_end] == lowqv_m[offset]) && (lowqv_m[vc_end] == lowqv_m[offset+1]) ) {
 			
 			// set node label
 			if(readid2info[readid].label_m == TMR) {
@@ -170,23 +197,23 @@ void Graph_t::loadSequence(int readid, const string & seq, const string & qv, bo
 				
 		// add mate name info to the nodes
 		// (used to check for overlapping mates)
-		unode->addMateName(readid2info[readid].readname_m, readid2info[readid].mate_order_m);
-		vnode->addMateName(readid2info[readid].readname_m, readid2info[readid].mate_order_m);
+		unode->addMateName(readid2info[readid].fragid_m, readid2info[readid].mate_order_m);
+		vnode->addMateName(readid2info[readid].fragid_m, readid2info[readid].mate_order_m);
 
 		if (!isRef)
 		{		
 			if (offset == 0) 
 			{ 
-				if( !(unode->hasOverlappingMate(readid2info[readid].readname_m, readid2info[readid].mate_order_m)) ) { // do not update coverage for overlapping mates
+				if( !(unode->hasOverlappingMate(readid2info[readid].fragid_m, readid2info[readid].mate_order_m)) ) { // do not update coverage for overlapping mates
 					
 					if(readid2info[readid].label_m == TMR) {	
 						unode->incTmrCov(strand);
-						unode->updateCovDistr((int)(unode->getTmrCov(strand)),uc_qv,strand,'T');
+						unode->updateCovDistr((int)(unode->getTmrCov(strand)),uc_qv,(uc.ori_m == R),strand,'T');
 						ref_m->updateCoverage(uc.mer_m, strand, 'T'); // update reference k-mer coverage for tumor
 					}
 					else if(readid2info[readid].label_m == NML) {
 						unode->incNmlCov(strand);
-						unode->updateCovDistr((int)(unode->getNmlCov(strand)),uc_qv,strand,'N');
+						unode->updateCovDistr((int)(unode->getNmlCov(strand)),uc_qv,(uc.ori_m == R),strand,'N');
 						ref_m->updateCoverage(uc.mer_m, strand, 'N'); // update reference k-mer coverage for normal
 					}
 
@@ -201,16 +228,16 @@ void Graph_t::loadSequence(int readid, const string & seq, const string & qv, bo
 				}
 			}
 
-			if( !(vnode->hasOverlappingMate(readid2info[readid].readname_m, readid2info[readid].mate_order_m)) ) { // do not update coverage for overlapping mates
+			if( !(vnode->hasOverlappingMate(readid2info[readid].fragid_m, readid2info[readid].mate_order_m)) ) { // do not update coverage for overlapping mates
 
 				if(readid2info[readid].label_m == TMR) {
 					vnode->incTmrCov(strand);
-					vnode->updateCovDistr((int)(vnode->getTmrCov(strand)),vc_qv,strand,'T');
+					vnode->updateCovDistr((int)(vnode->getTmrCov(strand)),vc_qv,(vc.ori_m == R),strand,'T');
 					ref_m->updateCoverage(vc.mer_m, strand, 'T'); // update reference k-mer coverage for tumor
 				}
 				else if(readid2info[readid].label_m == NML) {
 					vnode->incNmlCov(strand);
-					vnode->updateCovDistr((int)(vnode->getNmlCov(strand)),vc_qv,strand,'N');
+					vnode->updateCovDistr((int)(vnode->getNmlCov(strand)),vc_qv,(vc.ori_m == R),strand,'N');
 					ref_m->updateCoverage(vc.mer_m, strand, 'N'); // update reference k-mer coverage for normal
 				}
 			}
@@ -282,6 +309,26 @@ void Graph_t::trim(int readid, const string & seq, const string & qv, bool isRef
 	readid2info[readid].trm3 = trim3;
 }
 
+// retrim
+// trim the reads again with the current quality threshold (the store 
+// keeps the untrimmed bases and qualities of the reads)
+//////////////////////////////////////////////////////////////
+
+void Graph_t::retrim()
+{
+	string seq;
+	string qv;
+	for (unsigned int i = 0; i < readid2info.size(); ++i)
+	{
+		if (readid2info[i].label_m == REF) { continue; } // the reference is never trimmed
+		
+		int len = readid2info[i].len_m;
+		readstore_m.seq(readid2info[i].seqoff_m, 0, len, seq);
+		qv.assign(readstore_m.qv(readid2info[i].seqoff_m), len);
+		trim(i, seq, qv, false);
+	}
+}
+
 // trimAndLoad
 //////////////////////////////////////////////////////////////
 
@@ -353,10 +400,11 @@ int Graph_t::countMappedReads()
 // addRead
 ////////////////////////////////////////////////////////////////
 
-ReadId_t Graph_t::addRead(const string & set, const string & readname, const string & seq, const string & qv, char code, int label, unsigned int strand, int mate_order)
+ReadId_t Graph_t::addRead(ReadSet_t set, const string & readname, const string & seq, const string & qv, char code, int label, unsigned int strand, int mate_order)
 {
 	ReadId_t retval = readid2info.size();
-	readid2info.push_back(ReadInfo_t(label, set, readname, seq, qv, code, strand, mate_order));
+	unsigned int seqoff = readstore_m.add(seq, qv);
+	readid2info.push_back(ReadInfo_t(label, set, readstore_m.fragid(readname), seqoff, seq.length(), code, strand, mate_order));
 	return retval;
 }
 
@@ -376,14 +424,14 @@ void Graph_t::printReads()
 {
 	for (unsigned int i = 0; i < readid2info.size(); ++i)
 	{
-		cout << i << "\t" << readid2info[i].readname_m << "\t" << readid2info[i].set_m << endl;
+		cout << i << "\t" << readstore_m.fragnames_m[readid2info[i].fragid_m] << "\t" << readSetName(readid2info[i].set_m) << endl;
 	}
 }
 
 // addpaired
 //////////////////////////////////////////////////////////////
 
-void Graph_t::addAlignment(const string & set,
+void Graph_t::addAlignment(ReadSet_t set,
 	const string & readname,
 	const string & seq,
 	const string & qv,
@@ -426,34 +474,31 @@ void Graph_t::addpaired(const string & set,
 void Graph_t::buildgraph(Ref_t * refinfo)
 {
 	ref_m = refinfo;
+	ref_m->resetCoverage(); // reference k-mer coverage is accumulated while loading the reads
 	
 	int refid = 0; 
 	if(!is_ref_added) {
 		string qv ((ref_m->rawseq).size(), 'K'); // create base-quality value string for reference
-		refid = addRead("ref", ref_m->hdr, ref_m->rawseq, qv, 'R', REF, FWD, 0);
+		refid = addRead(SET_REF, ref_m->hdr, ref_m->rawseq, qv, 'R', REF, FWD, 0);
 		is_ref_added = true;
 		if (VERBOSE) { cerr << "refid: " << refid << endl; }
 	}	
 		
+	string seq; // decoded (trimmed) read sequence, reused across reads
+	string qv; // (trimmed) base qualities, reused across reads
 	for (unsigned int i = 0; i < readid2info.size(); ++i)
 	{
+		// stop loading if the window is over its time budget (checked every 64 reads)
+		if ( ((i & 63) == 0) && overBudget() ) { break; }
+		
 		if ( !(readid2info[i].isjunk) ) { // skip junk (not A,C,G,T)
-			string seq; // = readid2info[i].seq_m;
-			string qv; // = readid2info[i].qv_m;
-			int len = (readid2info[i].seq_m).length();
+			int len = readid2info[i].len_m;
 			int t5 = readid2info[i].trm5;
 			int t3 = readid2info[i].trm3;
 			unsigned int strand = readid2info[i].strand;
-			//string cseq = seq;
-			//string cqv = qv;
-			if (t5 || t3) { 
-				seq = (readid2info[i].seq_m).substr(t5, len-t5-t3); 
-				qv = (readid2info[i].qv_m).substr(t5, len-t5-t3); 
-			}
-			else {
-				seq = readid2info[i].seq_m;
-				qv = readid2info[i].qv_m;
-			}
+			
+			readstore_m.seq(readid2info[i].seqoff_m, t5, len-t5-t3, seq);
+			qv.assign(readstore_m.qv(readid2info[i].seqoff_m) + t5, len-t5-t3);
 																			
 			if(readid2info[i].label_m == REF) {
 				loadSequence(i, seq, qv, true, t5, strand);
@@ -465,8 +510,12 @@ void Graph_t::buildgraph(Ref_t * refinfo)
 	}
 	
 	// precompute min coverage values for each node
+	// (all nodes belong to component 0 until the components are marked)
+	compnodes_m.assign(1, vector<Node_t *>());
+	compnodes_m[0].reserve(nodes_m.size());
 	MerTable_t::iterator mi;
 	for (mi = nodes_m.begin(); mi != nodes_m.end(); ++mi) {
+		compnodes_m[0].push_back(mi->second);
 		(mi->second)->computeMinCov();
 		
 		sort((mi->second)->mate1_name.begin(), (mi->second)->mate1_name.end()); // sort mate1 names
@@ -478,8 +527,6 @@ void Graph_t::buildgraph(Ref_t * refinfo)
 	
 	//cerr << "# of nodes: " << nodes_m.size() << endl;
 	
-	ref_m->computeCoverage('T');
-	ref_m->computeCoverage('N');
 	if (verbose) { ref_m->printKmerCoverage('N'); }
 	if (verbose) { ref_m->printKmerCoverage('T'); }
 }
@@ -490,29 +537,65 @@ bool Graph_t::hasCycle() {
 	
 	//cout << "Check for cycles (kmer = " << K << ")..." << endl;
 	
-	bool ans1 = false; 
-	bool ans2 = false; 
 	bool ans = false;
 	
+	cyclefree_m = false;
+	for (unsigned int i = 0; i < cycletouched_m.size(); ++i) { cycletouched_m[i]->cycletouched_m = false; }
+	cycletouched_m.clear();
+
 	if ( (source_m != NULL) && (sink_m != NULL) ) {
 		
-		MerTable_t::iterator mi;
+		// a new generation makes every node WHITE without recoloring them
+		newCycleGen();
+		cyclefullgen_m = cyclegen_m;
+		
+		ans = findCycle(source_m, F) || findCycle(source_m, R);
+		cyclefree_m = !ans;
+	}
 	
-		for (mi = nodes_m.begin(); mi != nodes_m.end(); ++mi) {
-			Node_t * node = mi->second;
+	if(ans) {
+		if(verbose) { cerr << "Cycle found in the graph (kmer = " << K << ")!" << endl; }
+	}
+	
+	return ans;
+}
 
-			//if (node->isRef())    { continue; }
-			if (node->isSpecial())    { continue; }
-			//if (node->touchRef_m) { continue; }
+// hasNewCycle
+// check for cycles only through the nodes touched by the cleanup since 
+// the last search. Removing nodes or edges cannot create a cycle and 
+// merging a chain maps a new cycle onto an old one, so if the last 
+// search found none any new cycle goes through a touched (node, strand) 
+// that the search from the source reached. Falls back to the full 
+// search when there is no previous result.
+//////////////////////////////////////////////////////////////
+bool Graph_t::hasNewCycle() {
+	
+	if (!cyclefree_m || cyclegen_m + 1 == 0) { return hasCycle(); }
+	
+	bool ans = false;
+	
+	if ( (source_m != NULL) && (sink_m != NULL) && !cycletouched_m.empty() ) {
 		
-			node->setColor(WHITE);
+		// colors are shared by the restarts: states already explored are BLACK
+		newCycleGen();
+
+		for (unsigned int i = 0; i < cycletouched_m.size() && !ans; ++i) {
+			Node_t * node = cycletouched_m[i];
+			
+			if (node->dead_m || node->isSpecial()) { continue; }
+			
+			for (int s = 0; s < 2 && !ans; ++s) {
+				Ori_t dir = (s == 0) ? F : R;
+				if (node->colorgen_m[s] < cyclefullgen_m) { continue; } // not reachable from the source
+				ans = findCycle(node, dir);
+			}
 		}
-		
-		hasCycleRec(source_m, F, &ans1);
-		hasCycleRec(source_m, R, &ans2);
-		ans = ans1 || ans2;
 	}
 	
+	for (unsigned int i = 0; i < cycletouched_m.size(); ++i) { cycletouched_m[i]->cycletouched_m = false; }
+	cycletouched_m.clear();
+	cyclefree_m = !ans;
+	
 	if(ans) {
 		if(verbose) { cerr << "Cycle found in the graph (kmer = " << K << ")!" << endl; }
 	}
@@ -520,6 +603,30 @@ bool Graph_t::hasCycle() {
 	return ans;
 }
 
+// newCycleGen
+// start a new generation of node colors for the cycle search
+//////////////////////////////////////////////////////////////
+void Graph_t::newCycleGen() {
+	
+	if (++cyclegen_m == 0) { // wrapped around: reset the stamps
+		MerTable_t::iterator mi;
+		for (mi = nodes_m.begin(); mi != nodes_m.end(); ++mi) { mi->second->colorgen_m[0] = mi->second->colorgen_m[1] = 0; }
+		cyclegen_m = 1;
+		cyclefullgen_m = 1;
+	}
+}
+
+// touchNode
+// record that the edges of the node changed since the last cycle search
+//////////////////////////////////////////////////////////////
+void Graph_t::touchNode(Node_t * node) {
+	
+	if (!node->cycletouched_m) {
+		node->cycletouched_m = true;
+		cycletouched_m.push_back(node);
+	}
+}
+
 // check if there is any node/kmer specific only to the tumor
 //////////////////////////////////////////////////////////////
 bool Graph_t::hasTumorOnlyKmer() {
@@ -544,36 +651,54 @@ bool Graph_t::hasTumorOnlyKmer() {
 	return ans;
 }
 
-void Graph_t::hasCycleRec(Node_t * node, Ori_t dir, bool *ans) {
+// findCycle
+// iterative dfs from node in direction dir: returns true if a 
+// (node, strand) still on the stack (GREY) is reached again
+//////////////////////////////////////////////////////////////
+bool Graph_t::findCycle(Node_t * start, Ori_t dir) {
 		
-	if(node != NULL && !(*ans)) {
+	if (start == NULL) { return false; }
+	if (cycleColor(start, dir) != WHITE) { return false; }
+	
+	vector<CycleFrame_t> & stack = cyclestack_m;
+	stack.clear();
+	
+	setCycleColor(start, dir, GREY);
+	stack.push_back(CycleFrame_t(start, dir));
+	
+	while (!stack.empty()) {
 		
-		node->setColor(GREY);
-			
-		for (unsigned int i = 0; i < node->edges_m.size(); ++i) {
-						
-			Edge_t & edge = node->edges_m[i];
-			if (edge.isDir(dir)) {
-
-				Node_t * other = getNode(edge);
-				
-				//if(other->isRef()) { continue; }
-				if(other->isSpecial()) { continue; }
-				
-				//if (DFS_VERBOSE) { cerr << "     ==> " << other->nodeid_m << endl; }
+		CycleFrame_t & frame = stack.back();
+		Node_t * node = frame.node_m;
+		
+		if (frame.edge_m == node->edges_m.size()) {
+			setCycleColor(node, frame.dir_m, BLACK);
+			stack.pop_back();
+			continue;
+		}
+		
+		Edge_t & edge = node->edges_m[frame.edge_m++];
+		if (!edge.isDir(frame.dir_m)) { continue; }
 
-				if(other->getColor() == GREY) { // cycle!
-					//cout << "cycle found!" << endl;
-					*ans = true;
-					break;
-				}
-				if(other->getColor() == WHITE) { 
-					hasCycleRec(other,  edge.destdir(), ans);
-				}
-			}
+		Node_t * other = getNode(edge);
+		
+		//if(other->isRef()) { continue; }
+		if(other->isSpecial()) { continue; }
+		
+		Ori_t odir = edge.destdir();
+		int color = cycleColor(other, odir);
+		if(color == GREY) { // cycle!
+			//cout << "cycle found!" << endl;
+			stack.clear();
+			return true;
+		}
+		if(color == WHITE) { 
+			setCycleColor(other, odir, GREY);
+			stack.push_back(CycleFrame_t(other, odir));
 		}
-		node->setColor(BLACK);
 	}
+	
+	return false;
 }
 
 // Edmonds–Karp style algorithm to enumarate the minimum number of 
@@ -648,6 +773,7 @@ void Graph_t::printAlignment(const string &ref_aln, const string &path_aln, Path
 void Graph_t::processPath(Path_t * path, Ref_t * ref, FILE * fp, bool printPathsToFile,
 	int &complete, int &perfect, int &withsnps, int &withindel, int &withmix) {
 	
+	double start = WindowStats_t::now();
 	const string & refseq = ref->seq;
 	int HD_DISTANCE_CUTOFF = 5;
 		
@@ -672,17 +798,29 @@ void Graph_t::processPath(Path_t * path, Ref_t * ref, FILE * fp, bool printPaths
 	assert(coverageN.size() == coverageT.size());
 	
 	string pathseq = path->str();
+	StrTrack_t strs; // STRs of the path (scanned when the first variant is saved)
 	
 	// Run global align if strings have different length or large hamming distance	
+	// (only the core between the shared prefix and suffix is aligned)
+	double alignstart = WindowStats_t::now();
 	int hd = HammingDistance(refseq,pathseq); 
 	//cerr << "HD=" << hd << endl;	
+	bool aligned = true;
 	if( (hd == -1) || (hd > HD_DISTANCE_CUTOFF) ) { 
-		global_align_aff(refseq, pathseq, ref_aln, path_aln, 0, 0); 
+		aligned = anchored_align_aff(refseq, pathseq, ref_aln, path_aln, 0, deadline_m); 
 	}
 	else {
 		ref_aln = refseq;
 		path_aln = pathseq;
 	}
+	double aligntime = WindowStats_t::now() - alignstart;
+	
+	// the alignment was stopped: the window is over its time budget
+	if (!aligned) {
+		expired_m = true;
+		stats_m.time_m[PHASE_ALIGN] += aligntime;
+		return;
+	}
 
 	/*
 	global_cov_align_aff(refseq, path->str(), coverageT_fwd, ref_aln, path_aln, cov_path_aln, 0, 0);
@@ -780,7 +918,7 @@ void Graph_t::processPath(Path_t * path, Ref_t * ref, FILE * fp, bool printPaths
 			// into the sequence path which is indexed using 0-based coordinates
 			spanner = path->pathcontig(pathpos);
 			if (spanner == NULL) { cerr << "Error: path position out of range: " << pathpos << endl; break; }
-			spanner->setRead2InfoList(&readid2info);
+			spanner->setRead2InfoList(&window_m->readid2info);
 			
 			bool within_tumor_node = false;
 			
@@ -793,7 +931,7 @@ void Graph_t::processPath(Path_t * path, Ref_t * ref, FILE * fp, bool printPaths
 				/*
 				unordered_set<ReadId_t>::const_iterator it;
 				for (auto it = spanner->reads_m.begin(); it != spanner->reads_m.end(); it++) {
-					cerr << readid2info[*it].readname_m.c_str() << endl;
+					cerr << window_m->readstore_m.fragnames_m[window_m->readid2info[*it].fragid_m].c_str() << endl;
 				}
 				*/
 			}			
@@ -994,7 +1132,7 @@ void Graph_t::processPath(Path_t * path, Ref_t * ref, FILE * fp, bool printPaths
 						/*
 						unordered_set<ReadId_t>::const_iterator it;
 						for (auto it = spanner->reads_m.begin(); it != spanner->reads_m.end(); it++) {
-							cerr << readid2info[*it].readname_m.c_str() << endl;
+							cerr << window_m->readstore_m.fragnames_m[window_m->readid2info[*it].fragid_m].c_str() << endl;
 						}
 						*/
 					}
@@ -1068,15 +1206,18 @@ void Graph_t::processPath(Path_t * path, Ref_t * ref, FILE * fp, bool printPaths
 				string MOTIF = "";
 				stringstream STR;
 					
-				bool ans = findTandems(pathseq, "test", MAX_UNIT_LEN, MIN_REPORT_UNITS, MIN_REPORT_LEN, DIST_FROM_STR, transcript[ti].start_pos, LEN, MOTIF);
+				if (!strs.built_m) { strs.build(pathseq, MAX_UNIT_LEN, MIN_REPORT_UNITS, MIN_REPORT_LEN); }
+				bool ans = strs.lookup(transcript[ti].start_pos, DIST_FROM_STR, LEN, MOTIF);
 				if(ans) { 
 					STR << LEN << MOTIF;
 					//cerr << "STR = " << STR.str() << endl; 					
 				}
 				
-				vDB->addVar(Variant_t(ref->refchr, transcript[ti].pos-1, transcript[ti].ref, transcript[ti].qry, 
+				Variant_t var(ref->refchr, transcript[ti].pos-1, transcript[ti].ref, transcript[ti].qry, 
 					RCNF, RCNR, RCTF, RCTR, ACNF, ACNR, ACTF, ACTR,
-					transcript[ti].prev_bp_ref, transcript[ti].prev_bp_alt, filters, K, STR.str(), transcript[ti].code));
+					transcript[ti].prev_bp_ref, transcript[ti].prev_bp_alt, filters, K, STR.str(), transcript[ti].code);
+				
+				saveVariant(var);
 				}
 		}
 		if(verbose) { cerr << endl; }
@@ -1108,6 +1249,8 @@ void Graph_t::processPath(Path_t * path, Ref_t * ref, FILE * fp, bool printPaths
 		cout << "default exception" << endl; 
 	}
 	
+	stats_m.time_m[PHASE_ALIGN] += aligntime;
+	stats_m.time_m[PHASE_VARIANTS] += WindowStats_t::now() - start - aligntime;
 }
 
 // processShortPath
@@ -1217,8 +1360,12 @@ Path_t * Graph_t::bfs(Node_t * source, Node_t * sink, Ori_t dir, Ref_t * ref)
 
 		if ((DFS_LIMIT) && (visit > DFS_LIMIT)) {
 			if(verbose) { cerr << "WARNING: DFS_LIMIT (" << DFS_LIMIT << ") exceeded" << endl; }
+			++stats_m.dfs_limit_m;
 			break;
 		}
+		
+		// stop the search if the window is over its time budget (checked every 1024 visits)
+		if ( ((visit & 1023) == 0) && overBudget() ) { break; }
 
 		path = Q.front();
 		Q.pop_front();
@@ -1337,16 +1484,21 @@ void Graph_t::eka(Node_t * source, Node_t * sink, Ori_t dir,
 	
 	while(true) {
 		
+		double start = WindowStats_t::now();
 		Path_t * path = bfs(source, sink, dir, ref);
+		stats_m.time_m[PHASE_PATHS] += WindowStats_t::now() - start;
 				
 		if (path == NULL) { break; }
+		if (expired_m) { path->reset(); delete path; break; } // search stopped by the time budget
 				
 		if (path->hasCycle_m) { ++allcycles; }
 		++complete;
+		++stats_m.paths_m;
 		
 		//if(path->hasTumorOnlyNode()) {
 			processPath(path, ref, fp, printPathsToFile, complete, perfect, withsnps, withindel, withmix);
 		//}
+		if (expired_m) { path->reset(); delete path; break; } // alignment stopped by the time budget
 		
 		for (unsigned int i = 0; i < path->edges_m.size(); ++i) {
 			(path->edges_m[i])->setFlag(1);
@@ -1385,7 +1537,7 @@ void Graph_t::eka(Node_t * source, Node_t * sink, Ori_t dir,
 
 	//if(printPathsToFile) {
 	//	fprintf(fp, ">stats\treflen=%d\tnumreads=%d\tcov=%0.02f\ttrim5=%d\ttrim3=%d\tnodes=%d\trefnodes=%d\tcomp=%d\trefcomp=%d\tvisit=%d\tcomplete=%d\tallcycles=%d\tshortpath=%d\ttoolong=%d\tdeadend=%d\tperfect=%d\twithsnps=%d\twithindel=%d\twithmix=%d\twithmixindel=%d\twithmixsnp=%d\twithvar=%d\n",
-	//		(int) ref_m->seq.length(), (int) readid2info.size(), ((float)totalreadbp_m / (float) ref_m->seq.length()),
+	//		(int) ref_m->seq.length(), (int) window_m->readid2info.size(), ((float)totalreadbp_m / (float) ref_m->seq.length()),
 	//		ref_m->trim5, ref_m->trim3, (int) nodes_m.size()-2, ref_m->refnodes-2, ref_m->allcomp, ref_m->refcomp,
 	//		visit, complete, allcycles, shortpaths, toolong, deadend, perfect, withsnps, withindel, withmix, withmixindel, withmixsnp, withvar);
 	//}
@@ -1434,6 +1586,7 @@ void Graph_t::dfs(Node_t * source, Node_t * sink, Ori_t dir,
 		if ((DFS_LIMIT) && (visit > DFS_LIMIT))
 		{
 			if(verbose) { cerr << "WARNING: DFS_LIMIT (" << DFS_LIMIT << ") exceeded" << endl; }
+			++stats_m.dfs_limit_m;
 			break;
 		}
 
@@ -1543,7 +1696,7 @@ void Graph_t::dfs(Node_t * source, Node_t * sink, Ori_t dir,
 
 	if(printPathsToFile) {
 		fprintf(fp, ">stats\treflen=%d\tnumreads=%d\tcov=%0.02f\ttrim5=%d\ttrim3=%d\tnodes=%d\trefnodes=%d\tcomp=%d\trefcomp=%d\tvisit=%d\tcomplete=%d\tallcycles=%d\tshortpath=%d\ttoolong=%d\tdeadend=%d\tperfect=%d\twithsnps=%d\twithindel=%d\twithmix=%d\twithmixindel=%d\twithmixsnp=%d\twithvar=%d\n",
-			(int) ref_m->seq.length(), (int) readid2info.size(), ((float)totalreadbp_m / (float) ref_m->seq.length()),
+			(int) ref_m->seq.length(), (int) window_m->readid2info.size(), ((float)totalreadbp_m / (float) ref_m->seq.length()),
 			ref_m->trim5, ref_m->trim3, (int) nodes_m.size()-2, ref_m->refnodes-2, ref_m->allcomp, ref_m->refcomp,
 			visit, complete, allcycles, shortpaths, toolong, deadend, perfect, withsnps, withindel, withmix, withmixindel, withmixsnp, withvar);
 	}
@@ -1567,7 +1720,7 @@ string Graph_t::nodeColor(Node_t * cur, string & who)
 	unordered_set<ReadId_t>::const_iterator si;
 	for (si = cur->reads_m.begin(); si != cur->reads_m.end(); ++si)
 	{
-		++(whocnt[readid2info[*si].set_m]);
+		++(whocnt[readSetName(window_m->readid2info[*si].set_m)]);
 	}
 
 	bool isTumor = cur->isTumor();
@@ -1637,14 +1790,14 @@ void Graph_t::printDot(const string & filename, int compid)
 
 	if (PRINT_DOT_READS)
 	{
-		for (unsigned int i = 0; i < readid2info.size(); ++i)
+		for (unsigned int i = 0; i < window_m->readid2info.size(); ++i)
 		{
 			fprintf(fp, "// %s %d %s -> %d (%s)\n",
-				readid2info[i].set_m.c_str(),
+				readSetName(window_m->readid2info[i].set_m),
 				i, 
-				readid2info[i].readname_m.c_str(),
-				readid2info[i].mateid_m, 
-				readid2info[i].contigid_m.c_str());
+				window_m->readstore_m.fragnames_m[window_m->readid2info[i].fragid_m].c_str(),
+				window_m->readid2info[i].mateid_m, 
+				window_m->readid2info[i].contigid_m.c_str());
 		}
 
 		fprintf(fp, "\n\n");
@@ -1679,7 +1832,7 @@ void Graph_t::printDot(const string & filename, int compid)
 		++nodes;
 
 		Node_t * cur = mi->second;
-		cur->setRead2InfoList(&readid2info);
+		cur->setRead2InfoList(&window_m->readid2info);
 
 		string who;
 		string color = nodeColor(cur, who);
@@ -1732,7 +1885,7 @@ void Graph_t::printDot(const string & filename, int compid)
 
 			for (ri = cur->reads_m.begin(); ri != cur->reads_m.end(); ++ri)
 			{
-				//fprintf(fp, " %s", readid2info[e.readids_m[j]].readname_m.c_str());
+				//fprintf(fp, " %s", window_m->readid2info[e.readids_m[j]].readname_m.c_str());
 				fprintf(fp, " %d", *ri);
 			}
 
@@ -1797,7 +1950,7 @@ void Graph_t::printDot(const string & filename, int compid)
 
 				for (unsigned int j = 0; j < e.readids_m.size(); ++j)
 				{
-					//fprintf(fp, " %s", readid2info[e.readids_m[j]].readname_m.c_str());
+					//fprintf(fp, " %s", window_m->readid2info[e.readids_m[j]].readname_m.c_str());
 					fprintf(fp, " %d", e.readids_m[j]);
 				}
 
@@ -1928,7 +2081,7 @@ void Graph_t::markRefEnds(Ref_t * refinfo, int compid)
 	int refid = 0; 
 	if(!is_ref_added) {
 		string qv ((ref_m->rawseq).size(), 'K'); // create base-quality value string for reference
-		refid = addRead("ref", ref_m->hdr, ref_m->rawseq, qv, 'R', REF, FWD, 0);
+		refid = addRead(SET_REF, ref_m->hdr, ref_m->rawseq, qv, 'R', REF, FWD, 0);
 		is_ref_added = true;
 		if (VERBOSE) { cerr << "refid: " << refid << endl; }
 	}
@@ -1951,6 +2104,7 @@ void Graph_t::markRefEnds(Ref_t * refinfo, int compid)
 
 	source_m = NULL;
 	sink_m = NULL;
+	cyclefree_m = false; // new source and sink: the next cycle search starts over
 	
 	bool ambiguous_match;
 	
@@ -2080,6 +2234,7 @@ void Graph_t::markRefEnds(Ref_t * refinfo, int compid)
 	source_m = newsource;
 
 	nodes_m.insert(make_pair(newsource->nodeid_m, newsource));
+	compnodes_m[compid].push_back(newsource);
 
 	// Add the fake sink node	
 	std::stringstream sinkid;
@@ -2116,6 +2271,7 @@ void Graph_t::markRefEnds(Ref_t * refinfo, int compid)
 	sink_m = newsink;
 
 	nodes_m.insert(make_pair(newsink->nodeid_m, newsink));
+	compnodes_m[compid].push_back(newsink);
 }
 
 // markRefNodes
@@ -2138,8 +2294,43 @@ void Graph_t::markRefNodes()
 	if(verbose) { cerr << " nodes: " << nodes << " refnodes: " << refnodes << endl; }
 }
 
-// numConnectedComponents
+// findComp
+// representative of the component of node (with path halving)
+//////////////////////////////////////////////////////////////
+
+Node_t * Graph_t::findComp(Node_t * node)
+{
+	while (node->ufparent_m != NULL)
+	{
+		if (node->ufparent_m->ufparent_m != NULL) { node->ufparent_m = node->ufparent_m->ufparent_m; }
+		node = node->ufparent_m;
+	}
+	return node;
+}
+
+// unionComp
+// merge the components of nodes a and b (union by rank)
+//////////////////////////////////////////////////////////////
+
+void Graph_t::unionComp(Node_t * a, Node_t * b)
+{
+	a = findComp(a);
+	b = findComp(b);
+	if (a == b) { return; }
+
+	if (a->ufrank_m < b->ufrank_m) { swap(a, b); }
+	b->ufparent_m = a;
+	if (a->ufrank_m == b->ufrank_m) { ++(a->ufrank_m); }
+}
+
+// markConnectedComponents
+// components are found with a union-find forest over the edges of 
+// the nodes left after the low coverage removal (the forest is not 
+// kept during the construction: removed nodes can split a component). 
+// Components are numbered in order of first appearance and their 
+// nodes collected in compnodes_m.
 //////////////////////////////////////////////////////////////
+
 int Graph_t::markConnectedComponents()
 {
 	if(verbose) { cerr << endl << "connected components" << endl; }
@@ -2153,57 +2344,53 @@ int Graph_t::markConnectedComponents()
 	{
 		++nodes;
 		mi->second->component_m = 0;
+		mi->second->ufparent_m = NULL;
+		mi->second->ufrank_m = 0;
 	}
 
-	int comp = 0;
-	int refcomp = 0;
-
 	for (mi = nodes_m.begin(); mi != nodes_m.end(); ++mi)
 	{
-		if (mi->second->component_m != 0) { continue; }
+		Node_t * cur = mi->second;
+		for (unsigned int i = 0; i < cur->edges_m.size(); ++i)
+		{
+			Node_t * next = getNode(cur->edges_m[i]);
+			if (next != NULL) { unionComp(cur, next); }
+		}
+	}
 
-		++comp;
+	int comp = 0;
+	int refcomp = 0;
+	vector<int> touches(1, 0);
 
-		deque<Node_t *> Q;
-		Q.push_back(mi->second);
+	compnodes_m.assign(1, vector<Node_t *>());
 
-		int touches = 0;
+	for (mi = nodes_m.begin(); mi != nodes_m.end(); ++mi)
+	{
+		Node_t * cur = mi->second;
+		Node_t * root = findComp(cur);
 
-		while (!Q.empty())
+		if (root->component_m == 0)
 		{
-			Node_t * cur = Q.front();
-			Q.pop_front();
-
-			if (cur->component_m == 0)
-			{
-				cur->component_m = comp;
+			root->component_m = ++comp;
+			compnodes_m.push_back(vector<Node_t *>());
+			touches.push_back(0);
+		}
 
-				if (cur->touchRef_m) { ++touches; }
+		cur->component_m = root->component_m;
+		compnodes_m[cur->component_m].push_back(cur);
 
-				for (unsigned int i = 0; i < cur->edges_m.size(); ++i)
-				{
-					Node_t * next = getNode(cur->edges_m[i]);
-					Q.push_back(next);
-				}
-			}
-			else
-			{
-				if (cur->component_m != comp)
-				{
-					cerr << "ERROR: cur->comp: " << cur->component_m << " != comp: " << comp << endl;
-					exit(1);
-				}
-			}
-		}
+		if (cur->touchRef_m) { ++(touches[cur->component_m]); }
+	}
 
-		if (touches)
+	for (int c = 1; c <= comp; ++c)
+	{
+		if (touches[c])
 		{
 			++refcomp;
-			ref_m->refcompids.insert(comp);
+			ref_m->refcompids.insert(c);
 		}
 	}
 
-
 	ref_m->refnodes = refnodes;
 	ref_m->refcomp  = refcomp;
 	ref_m->allcomp  = comp;
@@ -2226,6 +2413,49 @@ int Graph_t::markConnectedComponents()
 	return comp;
 }
 
+// extractComponent
+// move the nodes of a connected component into the (empty) graph comp, 
+// which can then be processed independently of the other components. 
+// comp shares the reads, the reference k-mer index and the reference 
+// coverage of this graph and gets its own copy of the reference sequence 
+// and ends, since marking the reference ends trims the sequence.
+//////////////////////////////////////////////////////////////
+
+void Graph_t::extractComponent(int compid, Graph_t & comp)
+{
+	assert(compid < (int)compnodes_m.size());
+
+	comp.window_m = this;
+	comp.ref_m = ref_m->componentView();
+	comp.is_ref_added = is_ref_added;
+	comp.totalreadbp_m = totalreadbp_m;
+	comp.readCycles = readCycles;
+	comp.cyclegen_m = cyclegen_m;
+
+	comp.compnodes_m.resize(compid+1);
+	comp.compnodes_m[compid].swap(compnodes_m[compid]);
+
+	vector<Node_t *> & nodes = comp.compnodes_m[compid];
+	for (unsigned int i = 0; i < nodes.size(); ++i)
+	{
+		nodes_m.erase(nodes[i]->nodeid_m);
+		comp.nodes_m.insert(make_pair(nodes[i]->nodeid_m, nodes[i]));
+	}
+}
+
+// releaseComponent
+// free the nodes and the reference view of a component graph
+//////////////////////////////////////////////////////////////
+
+void Graph_t::releaseComponent()
+{
+	assert(window_m != this);
+
+	delete ref_m; // the index and the coverage vectors belong to the window reference
+	ref_m = NULL;
+	clear(false);
+}
+
 // denovoNodes
 //////////////////////////////////////////////////////////////
 
@@ -2247,10 +2477,10 @@ void Graph_t::denovoNodes(const string & filename, const string & refname)
 		unordered_set<ReadId_t>::const_iterator si;
 		for (si = cur->reads_m.begin(); si != cur->reads_m.end(); ++si)
 		{
-			string & set = readid2info[*si].set_m;
-			if (set != "ref")
+			ReadSet_t set = window_m->readid2info[*si].set_m;
+			if (set != SET_REF)
 			{
-				++(who[set]);
+				++(who[readSetName(set)]);
 			}
 		}
 
@@ -2545,6 +2775,14 @@ void Graph_t::compressNode(Node_t * node, Ori_t dir)
 		// dead flag
 		buddy->dead_m = true;
 
+		// the merged node is entered on the strand of node from its own
+		// side and on the reverse strand of buddy from the far side
+		Ori_t bflip = (Edge_t::edgedir_dest(edir) == F) ? R : F;
+		int ns = strandOf(dir), nr = 1 - ns, bs = strandOf(Edge_t::edgedir_dest(edir)), br = strandOf(bflip);
+		if (buddy->colorgen_m[bs] > node->colorgen_m[ns]) { node->color[ns] = buddy->color[bs]; node->colorgen_m[ns] = buddy->colorgen_m[bs]; }
+		if (buddy->colorgen_m[br] > node->colorgen_m[nr]) { node->color[nr] = buddy->color[br]; node->colorgen_m[nr] = buddy->colorgen_m[br]; }
+		touchNode(node);
+
 		// isRef
 		//node->isRef_m |= buddy->isRef_m;
 		if(buddy->isRef()) { node->setIsRef(); }
@@ -2583,6 +2821,7 @@ void Graph_t::compressNode(Node_t * node, Ori_t dir)
 				node->edges_m.push_back(ne);
 				other->updateEdge(buddy->nodeid_m, Edge_t::fliplink(buddy->edges_m[i].dir_m),
 					node->nodeid_m, Edge_t::fliplink(ne.dir_m));
+				touchNode(other);
 			}
 		}		
 	}
@@ -2596,52 +2835,57 @@ void Graph_t::compress(int compid)
 {
 	if(verbose) { cerr << "compressing graph:"; }
 
-	MerTable_t::iterator mi;
+	vector<Node_t *> & nodes = compnodes_m[compid]; //only analyze the selected connected component 
 
-	for (mi = nodes_m.begin(); mi != nodes_m.end(); ++mi)
+	for (unsigned int i = 0; i < nodes.size(); ++i)
 	{
-		if(mi->second->component_m == compid) { //only analyze the selected connected component 
+		Node_t * node = nodes[i];
 		
-			if (mi->second->dead_m)  { continue; }
-			//if (mi->second->isRef()) { continue; }
-			if (mi->second->isSpecial()) { continue; }
+		if (node->dead_m)  { continue; }
+		//if (node->isRef()) { continue; }
+		if (node->isSpecial()) { continue; }
 
-			compressNode(mi->second, F);
-			compressNode(mi->second, R);
-		}
+		compressNode(node, F);
+		compressNode(node, R);
 	}
 
-	cleanDead();
+	cleanDead(compid);
 }
 
 // cleanDead
 ///////////////////////////////////////////////////////////////
 
-void Graph_t::cleanDead()
+void Graph_t::cleanDead(int compid)
 {
-	set<Mer_t> deadnodes;
+	vector<Node_t *> & nodes = compnodes_m[compid];
+	
+	// forget the dead nodes touched since the last cycle search
+	unsigned int touched = 0;
+	for (unsigned int i = 0; i < cycletouched_m.size(); ++i)
+	{
+		if (!cycletouched_m[i]->dead_m) { cycletouched_m[touched++] = cycletouched_m[i]; }
+	}
+	cycletouched_m.resize(touched);
 
-	MerTable_t::iterator mi;
-	for (mi = nodes_m.begin(); mi != nodes_m.end(); ++mi)
+	// dead nodes can only come from the component being processed
+	unsigned int live = 0;
+	for (unsigned int i = 0; i < nodes.size(); ++i)
 	{
-		if (mi->second->dead_m) 
+		if (nodes[i]->dead_m) 
 		{
-			deadnodes.insert(mi->second->nodeid_m);
+			MerTable_t::iterator mi = nodes_m.find(nodes[i]->nodeid_m);
+			assert(mi != nodes_m.end());
+			assert(mi->second == nodes[i]);
+
+			delete mi->second;
+			nodes_m.erase(mi);
 		}
+		else { nodes[live++] = nodes[i]; }
 	}
 
-	if(verbose) { cerr << "  removing " << deadnodes.size() << " dead nodes" << endl; }
+	if(verbose) { cerr << "  removing " << (nodes.size() - live) << " dead nodes" << endl; }
 
-	set<Mer_t>::iterator di;
-	for (di = deadnodes.begin(); di != deadnodes.end(); ++di)
-	{
-		mi = nodes_m.find(*di);
-		assert(mi != nodes_m.end());
-		assert(mi->second->dead_m);
-
-		delete mi->second;
-		nodes_m.erase(mi);
-	}
+	nodes.resize(live);
 }
 
 
@@ -2679,31 +2923,28 @@ void Graph_t::removeLowCov(bool docompression, int compid)
 	double avgcov = ((double) totalreadbp_m) / ((double) ref_m->rawseq.length());
 	//cerr << "avgcov: " << avgcov << endl;
 
-	MerTable_t::iterator mi;
+	vector<Node_t *> & nodes = compnodes_m[compid]; //only process the selected connected component 
 
-	for (mi = nodes_m.begin(); mi != nodes_m.end(); ++mi)
+	for (unsigned int i = 0; i < nodes.size(); ++i)
 	{
-		if(mi->second->component_m == compid) { //only process the selected connected component 
-		
-			Node_t * node = mi->second;
+		Node_t * node = nodes[i];
 
-			//if (node->isRef())    { continue; }
-			if (node->isSpecial())    { continue; }
-			//if (node->touchRef_m) { continue; }
+		//if (node->isRef())    { continue; }
+		if (node->isSpecial())    { continue; }
+		//if (node->touchRef_m) { continue; }
 
-			if ( (node->getMinCov() <= LOW_COV_THRESHOLD) || (node->getMinCov() <= (MIN_COV_RATIO*avgcov)) ||
-				(node->getTotTmrCov() == 1 && node->getTotNmlCov() == 1) )
-			//if ( (node->minCovMinQV() <= LOW_COV_THRESHOLD) || (node->minCovMinQV() <= (MIN_COV_RATIO*avgcov)) )
-			{
-				++lowcovnodes;
-				removeNode(node);
-			}
+		if ( (node->getMinCov() <= LOW_COV_THRESHOLD) || (node->getMinCov() <= (MIN_COV_RATIO*avgcov)) ||
+			(node->getTotTmrCov() == 1 && node->getTotNmlCov() == 1) )
+		//if ( (node->minCovMinQV() <= LOW_COV_THRESHOLD) || (node->minCovMinQV() <= (MIN_COV_RATIO*avgcov)) )
+		{
+			++lowcovnodes;
+			removeNode(node);
 		}
 	}
 
 	if (verbose) { cerr << " found " << lowcovnodes; }
 
-	cleanDead();
+	cleanDead(compid);
 	if(docompression) { compress(compid); }
 
 	if(verbose) { printStats(compid); }
@@ -2721,36 +2962,33 @@ void Graph_t::removeShortLinks(int compid)
 
 	if (verbose) { cerr << endl << "remove short links: "; }
 
-	MerTable_t::iterator mi;
+	vector<Node_t *> & nodes = compnodes_m[compid]; //only process the selected connected component 
 
-	for (mi = nodes_m.begin(); mi != nodes_m.end(); ++mi)
+	for (unsigned int i = 0; i < nodes.size(); ++i)
 	{
-		if(mi->second->component_m == compid) { //only process the selected connected component 
-		
-			Node_t * cur = mi->second;
+		Node_t * cur = nodes[i];
 
-			//if (cur->isRef()) { continue; }
-			if (cur->isSpecial()) { continue; }
+		//if (cur->isRef()) { continue; }
+		if (cur->isSpecial()) { continue; }
 
-			int deg = cur->edges_m.size();
-			int len = cur->getSize();
+		int deg = cur->edges_m.size();
+		int len = cur->getSize();
 
-			//if ((deg >= 2) && (len < MAX_LINK_LEN) )
-			if ((deg >= 2) && (len < MAX_LINK_LEN) && (cur->getMinCov() <= floor(sqrt(avgcov))) )
-			{
-				int LEN=0;
-				string MOTIF = "";
-				//stringstream STR;
-				
-				// do not remove short-links within STRs: small bubbles are normal in STRs due to the DeBruijn graph represenation.   
-				findTandems(cur->str_m, "shortlink", MAX_UNIT_LEN, MIN_REPORT_UNITS, MIN_REPORT_LEN, DIST_FROM_STR, K-1, LEN, MOTIF);
-				//STR << LEN << MOTIF;
-				//cout << cur->str_m << endl;
-				//cout << "MS:" << STR.str() << endl;				
-				if(LEN==0) {
-					removeNode(cur);
-					++links;
-				}
+		//if ((deg >= 2) && (len < MAX_LINK_LEN) )
+		if ((deg >= 2) && (len < MAX_LINK_LEN) && (cur->getMinCov() <= floor(sqrt(avgcov))) )
+		{
+			int LEN=0;
+			string MOTIF = "";
+			//stringstream STR;
+			
+			// do not remove short-links within STRs: small bubbles are normal in STRs due to the DeBruijn graph represenation.   
+			findTandems(cur->str_m, "shortlink", MAX_UNIT_LEN, MIN_REPORT_UNITS, MIN_REPORT_LEN, DIST_FROM_STR, K-1, LEN, MOTIF);
+			//STR << LEN << MOTIF;
+			//cout << cur->str_m << endl;
+			//cout << "MS:" << STR.str() << endl;				
+			if(LEN==0) {
+				removeNode(cur);
+				++links;
 			}
 		}
 	}
@@ -2777,25 +3015,22 @@ void Graph_t::removeTips(int compid)
 
 		if (verbose) { cerr << endl << "remove tips round: " << round; }
 
-		MerTable_t::iterator mi;
+		vector<Node_t *> & nodes = compnodes_m[compid]; //only process the selected connected component 
 
-		for (mi = nodes_m.begin(); mi != nodes_m.end(); ++mi)
+		for (unsigned int i = 0; i < nodes.size(); ++i)
 		{
-			if(mi->second->component_m == compid) { //only process the selected connected component 
-			
-				Node_t * cur = mi->second;
+			Node_t * cur = nodes[i];
 
-				//if (cur->isRef()) { continue; }
-				if (cur->isSpecial()) { continue; }
+			//if (cur->isRef()) { continue; }
+			if (cur->isSpecial()) { continue; }
 
-				int deg = cur->edges_m.size();
-				int len = cur->strlen() - K + 1;
+			int deg = cur->edges_m.size();
+			int len = cur->strlen() - K + 1;
 
-				if ((deg <= 1) && (len < MAX_TIP_LEN))
-				{
-					removeNode(cur);
-					++tips;
-				}
+			if ((deg <= 1) && (len < MAX_TIP_LEN))
+			{
+				removeNode(cur);
+				++tips;
 			}
 		}
 
@@ -3059,7 +3294,7 @@ void Graph_t::threadReads(int compid)
 							s1 != n1->reads_m.end();
 							++s1)
 							{
-								s2 = n2->reads_m.find(readid2info[*s1].mateid_m);
+								s2 = n2->reads_m.find(window_m->readid2info[*s1].mateid_m);
 
 								if (s2 != n2->reads_m.end())
 								{
@@ -3216,11 +3451,13 @@ void Graph_t::threadReads(int compid)
 							removeNode(cur);
 
 							++thread;
+							cyclefree_m = false; // new nodes: the next cycle search starts over
 
 							for (unsigned int j = 0; j < newnodes.size(); ++j)
 							{
 								Node_t * nn = newnodes[j];
 								nodes_m.insert(make_pair(nn->nodeid_m, nn));
+								compnodes_m[compid].push_back(nn);
 
 								if (VERBOSE) { cerr << "  swapping in: " << nn->nodeid_m << endl; }
 
@@ -3255,7 +3492,7 @@ void Graph_t::threadReads(int compid)
 
 		if (thread > 0)
 		{
-			cleanDead();
+			cleanDead(compid);
 			compress(compid);
 		}
 	}
@@ -3275,55 +3512,53 @@ void Graph_t::checkReadStarts(int compid)
 	int all = 0;
 	int bad = 0;
 
-	MerTable_t::iterator mi;
+	vector<Node_t *> & nodes = compnodes_m[compid]; //only analyze the selected connected component 
 
-	for (mi = nodes_m.begin(); mi != nodes_m.end(); ++mi)
+	for (unsigned int n = 0; n < nodes.size(); ++n)
 	{
-		if(mi->second->component_m == compid) { //only analyze the selected connected component 
+		Node_t * cur = nodes[n];
+
+		for (unsigned int i = 0; i < cur->readstarts_m.size(); ++i)
+		{
+			ReadStart_t & rstart = cur->readstarts_m[i];
+			ReadId_t rid         = rstart.readid_m;
+			ReadInfo_t & rinfo   = window_m->readid2info[rid];
 
-			Node_t * cur = mi->second;
+			string ckmer;
+			string rkmer;
+			window_m->readstore_m.seq(rinfo.seqoff_m, rstart.trim5_m, K, rkmer);
 
-			for (unsigned int i = 0; i < cur->readstarts_m.size(); ++i)
+			++all;
+
+			if (rstart.ori_m == R)
+			{
+				ckmer = cur->str_m.substr(rstart.nodeoffset_m-K+1, K);
+				ckmer = CanonicalMer_t::rc(ckmer);
+			}
+			else
 			{
-				ReadStart_t & rstart = cur->readstarts_m[i];
-				ReadId_t rid         = rstart.readid_m;
-				ReadInfo_t & rinfo   = readid2info[rid];
+				ckmer = cur->str_m.substr(rstart.nodeoffset_m, K);
+			}
 
-				string ckmer;
-				string rkmer = rinfo.seq_m.substr(rstart.trim5_m, K);
+			if ((rkmer != ckmer)) // || VERBOSE)
+			{
+				cerr << "Checking " << rid << " " << window_m->readstore_m.fragnames_m[rinfo.fragid_m] 
+					<< " " << rstart.ori_m 
+					<< " offset:" << rstart.nodeoffset_m 
+					<< " trim5:" << rstart.trim5_m << endl;
+				cerr << "  " << rkmer << endl;
+				cerr << "  " << ckmer << endl;
 
-				++all;
+				cur->print(cerr) << endl;
 
-				if (rstart.ori_m == R)
+				if (rkmer != ckmer)
 				{
-					ckmer = cur->str_m.substr(rstart.nodeoffset_m-K+1, K);
-					ckmer = CanonicalMer_t::rc(ckmer);
+					++bad;
+					cerr << "mismatch: " << cur->str_m << endl;
 				}
 				else
 				{
-					ckmer = cur->str_m.substr(rstart.nodeoffset_m, K);
-				}
-
-				if ((rkmer != ckmer)) // || VERBOSE)
-				{
-					cerr << "Checking " << rid << " " << rinfo.readname_m 
-						<< " " << rstart.ori_m 
-						<< " offset:" << rstart.nodeoffset_m 
-						<< " trim5:" << rstart.trim5_m << endl;
-					cerr << "  " << rkmer << endl;
-					cerr << "  " << ckmer << endl;
-
-					cur->print(cerr) << endl;
-
-					if (rkmer != ckmer)
-					{
-						++bad;
-						cerr << "mismatch: " << cur->str_m << endl;
-					}
-					else
-					{
-						cerr << "ok" << endl;
-					}
+					cerr << "ok" << endl;
 				}
 			}
 		}
@@ -3347,8 +3582,8 @@ void Graph_t::updateContigReadStarts()
 		{
 			ReadId_t rid = cur->readstarts_m[i].readid_m;
 
-			readid2info[rid].contigid_m = cur->nodeid_m;
-			readid2info[rid].readstartidx_m = i;
+			window_m->readid2info[rid].contigid_m = cur->nodeid_m;
+			window_m->readid2info[rid].readstartidx_m = i;
 		}
 	}
 }
@@ -3370,11 +3605,11 @@ void Graph_t::bundleMates()
 
 		for (unsigned int i = 0; i < cur->readstarts_m.size(); ++i)
 		{
-			ReadId_t mateid = readid2info[cur->readstarts_m[i].readid_m].mateid_m;
+			ReadId_t mateid = window_m->readid2info[cur->readstarts_m[i].readid_m].mateid_m;
 
 			if (mateid != -1)
 			{
-				Mer_t matecontig = readid2info[mateid].contigid_m;
+				Mer_t matecontig = window_m->readid2info[mateid].contigid_m;
 
 				if (matecontig != "")
 				{
@@ -3428,11 +3663,11 @@ void Graph_t::bundleMates()
 					ContigLink_t & link = list->linklist_m[i];
 
 					ReadId_t rid         = link.rid_m;
-					ReadInfo_t & rinfo   = readid2info[rid];
+					ReadInfo_t & rinfo   = window_m->readid2info[rid];
 					ReadStart_t & rstart = cur->readstarts_m[rinfo.readstartidx_m];
 
 					ReadId_t mid         = rinfo.mateid_m;
-					ReadInfo_t & minfo   = readid2info[mid];
+					ReadInfo_t & minfo   = window_m->readid2info[mid];
 					ReadStart_t & mstart = other->readstarts_m[minfo.readstartidx_m];
 
 					Edgedir_t linkdir = FF;
@@ -3484,8 +3719,8 @@ void Graph_t::bundleMates()
 						cerr << Edge_t::toString(linkdir) << ":" << linkdist << "\t"
 							<< lo << "\t" << hi << "\t"
 							<< rinfo.code_m << "\t" << dup << "\t"
-							<< rid << "\t"  << rinfo.readname_m <<  "\t" << rstart.nodeoffset_m << "\t" << rstart.ori_m << "\t"
-							<< mid << "\t"  << minfo.readname_m <<  "\t" << mstart.nodeoffset_m << "\t" << mstart.ori_m << endl;
+							<< rid << "\t"  << window_m->readstore_m.fragnames_m[rinfo.fragid_m] <<  "\t" << rstart.nodeoffset_m << "\t" << rstart.ori_m << "\t"
+							<< mid << "\t"  << window_m->readstore_m.fragnames_m[minfo.fragid_m] <<  "\t" << mstart.nodeoffset_m << "\t" << mstart.ori_m << endl;
 					}
 
 					if (!dup)
@@ -3551,6 +3786,21 @@ void Graph_t::printGraph()
 	}
 }
 
+// countGraph
+// number of nodes and edges of the graph (an edge is stored in both its nodes)
+//////////////////////////////////////////////////////////////
+
+void Graph_t::countGraph(long & nodes, long & edges)
+{
+	nodes = nodes_m.size();
+	edges = 0;
+	MerTable_t::iterator mi;
+	for (mi = nodes_m.begin(); mi != nodes_m.end(); ++mi) {
+		edges += (mi->second)->edges_m.size();
+	}
+	edges /= 2;
+}
+
 // printStats
 //////////////////////////////////////////////////////////////
 
@@ -3559,12 +3809,13 @@ void Graph_t::printStats(int compid)
 	int edgecnt = 0;
 	int span = 0;
 
-	MerTable_t::iterator gi;
-	for (gi = nodes_m.begin(); gi != nodes_m.end(); ++gi)
+	if (compid < (int)compnodes_m.size()) 
 	{
-		if(gi->second->component_m == compid) {
-			edgecnt += gi->second->edges_m.size();
-			span += gi->second->strlen();
+		vector<Node_t *> & nodes = compnodes_m[compid];
+		for (unsigned int i = 0; i < nodes.size(); ++i)
+		{
+			edgecnt += nodes[i]->edges_m.size();
+			span += nodes[i]->strlen();
 		}
 	}
 
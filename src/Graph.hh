@@ -45,6 +45,7 @@
 #include "Transcript.hh"
 #include "Variant.hh"
 #include "VariantDB.hh"
+#include "WindowStats.hh"
 
 
 #define WHITE 1
@@ -69,6 +70,16 @@ using namespace std;
 typedef unordered_map<Mer_t, Node_t *> MerTable_t;
 //typedef sparse_hash_map<Mer_t, Node_t *> MerTable_t;
 
+// node on the stack of the cycle search and next edge to follow
+struct CycleFrame_t
+{
+	Node_t * node_m;
+	Ori_t dir_m;
+	unsigned int edge_m;
+
+	CycleFrame_t(Node_t * node, Ori_t dir) : node_m(node), dir_m(dir), edge_m(0) { }
+};
+
 class Graph_t
 {
 public:
@@ -119,23 +130,45 @@ public:
 	MerTable_t nodes_m;
 	int totalreadbp_m;
 
+	vector< vector<Node_t *> > compnodes_m; // nodes of each connected component (0 = not yet assigned)
+
+	unsigned int cyclegen_m; // generation of the current cycle search (older node colors are WHITE)
+	unsigned int cyclefullgen_m; // generation of the last search from the source
+	bool cyclefree_m; // the last search found no cycle
+	vector<Node_t *> cycletouched_m; // nodes that gained edges since the last search
+	vector<CycleFrame_t> cyclestack_m;
+
 	Node_t * source_m;
 	Node_t * sink_m;
 
 	Ref_t * ref_m;
+	bool ownref_m; // if set, ref_m is deleted when the graph is cleared
 	bool is_ref_added;
 
 	ReadInfoList_t readid2info;
+	ReadStore_t readstore_m; // bases, qualities and names of the reads in readid2info
 	int readCycles;
+	vector<int> lowqv_m; // lowqv_m[i]: number of bases below MIN_QUAL_CALL in qv[0,i) of the current read
 	
 	VariantDB_t *vDB; // DB of variants
+	vector<Variant_t> * varbuf_m; // if set, variants are buffered here instead of added to vDB
 	Filters * filters; // filter thresholds
 
-	Graph_t() : ref_m(NULL), is_ref_added(0), readCycles(0) {
+	Graph_t * window_m; // graph holding the reads of the window (this graph, unless it is a component graph)
+	WindowStats_t stats_m; // statistics of the analysis of the window (or of the component)
+	double deadline_m; // time (WindowStats_t::now) the analysis of the window must end by (0 = no budget)
+	bool expired_m; // the analysis ran past the deadline and was stopped
+
+	Graph_t() : cyclegen_m(0), cyclefullgen_m(0), ref_m(NULL), ownref_m(true), is_ref_added(0), readCycles(0), vDB(NULL), varbuf_m(NULL), window_m(this), deadline_m(0), expired_m(false) {
 		clear(true); 
 	}
 
 	void setDB(VariantDB_t *db) { vDB = db; }
+	void setVariantBuffer(vector<Variant_t> * buf) { varbuf_m = buf; }
+	void setOwnRef(bool own) { ownref_m = own; }
+	void setDeadline(double d) { deadline_m = d; expired_m = false; }
+	bool overBudget() { if (!expired_m && (deadline_m > 0) && (WindowStats_t::now() > deadline_m)) { expired_m = true; } return expired_m; }
+	void saveVariant(const Variant_t & v) { ++stats_m.variants_m; if (varbuf_m != NULL) { varbuf_m->push_back(v); } else { vDB->addVar(v); } }
 	void setK(int k) { K = k; MAX_LINK_LEN = (int)floor((double)K/2.0); }
 	void setVerbose(bool v) { verbose = v; }
 	void setMoreVerbose(bool v) { VERBOSE = v; }
@@ -169,19 +202,20 @@ public:
 	void loadSequence(int readid, const string & seq, const string & qv, bool isRef, int trim5, unsigned int strand);
 	void trimAndLoad(int readid, const string & seq, const string & qv, bool isRef, unsigned int strand);
 	void trim(int readid, const string & seq, const string & qv, bool isRef);
+	void retrim();
 	void buildgraph(Ref_t * refinfo);
 
 	int countBastardReads();
 
 	int countMappedReads();
 
-	ReadId_t addRead(const string & set, const string & readname, const string & seq, const string & qv, char code, int label, unsigned int strand, int mate_order);
+	ReadId_t addRead(ReadSet_t set, const string & readname, const string & seq, const string & qv, char code, int label, unsigned int strand, int mate_order);
 
 	void addMates(ReadId_t r1, ReadId_t r2);
 
 	void printReads();
 
-	void addAlignment(const string & set,
+	void addAlignment(ReadSet_t set,
 		const string & readname,
 		const string & seq,
 		const string & qv,
@@ -211,7 +245,13 @@ public:
 	bool findRepeatsInGraphPaths(Node_t * source, Node_t * sink, Ori_t dir, Ref_t * ref);
 	bool hasTumorOnlyKmer();
 	bool hasCycle();
-	void hasCycleRec(Node_t * node, Ori_t dir, bool* ans);
+	bool hasNewCycle();
+	bool findCycle(Node_t * start, Ori_t dir);
+	void newCycleGen();
+	void touchNode(Node_t * node);
+	static int strandOf(Ori_t dir) { return (dir == R) ? 1 : 0; }
+	int cycleColor(Node_t * node, Ori_t dir) { int s = strandOf(dir); return (node->colorgen_m[s] == cyclegen_m) ? node->color[s] : WHITE; }
+	void setCycleColor(Node_t * node, Ori_t dir, int c) { int s = strandOf(dir); node->color[s] = c; node->colorgen_m[s] = cyclegen_m; }
 	string nodeColor(Node_t * cur, string & who);
 	string edgeColor(Node_t * cur, Edge_t & e);
 	void printDot(const string & filename, int compid);
@@ -219,7 +259,11 @@ public:
 	void printPairs(const string & filename);
 	void markRefEnds(Ref_t * refinfo, int compid);
 	void markRefNodes();
+	Node_t * findComp(Node_t * node);
+	void unionComp(Node_t * a, Node_t * b);
 	int markConnectedComponents();
+	void extractComponent(int compid, Graph_t & comp);
+	void releaseComponent();
 	void denovoNodes(const string & filename, const string & refname);
 	void alignRefNodes();
 	void countRefPath(const string & filename, const string & refname, bool printPathsToFile);
@@ -228,7 +272,7 @@ public:
 	Node_t * getNode(Edge_t & edge);
 	void compressNode(Node_t * node, Ori_t dir);
 	void compress(int compid);
-	void cleanDead();
+	void cleanDead(int compid);
 	void removeNode(Node_t * node);
 	void removeLowCov(bool docompression, int compid);
 	void removeTips(int compid);
@@ -241,6 +285,7 @@ public:
 	void scaffoldContigs();
 	void printGraph();
 	void printStats(int compid=0);
+	void countGraph(long & nodes, long & edges);
 };
 
 #endif
@@ -40,13 +40,17 @@ void printUsage() {
 		"Version: "<< VERSION << "\n"
 		"Contact: Giuseppe Narzisi <gnarzisi@nygenome.org>\n";
 
-	string USAGE = "\nUsage: lancet [options] --tumor <BAM file> --normal <BAM file> --ref <FASTA file> --reg <chr:start-end>\n [-h for full list of commands]\n\n";
+	string USAGE = "\nUsage: lancet [options] --tumor <BAM file> --normal <BAM file> --ref <FASTA file> --reg <chr:start-end>\n"
+		"       lancet merge [options] --tumor <BAM file> --normal <BAM file> --ref <FASTA file> --reg <chr:start-end> <checkpoint files>\n"
+		"       lancet serve [options] --tumor <BAM file> --normal <BAM file> --ref <FASTA file> [--socket <path>]\n"
+		"       lancet refilter [filter options] <evidence file>\n"
+		" [-h for full list of commands]\n\n";
 
 	cerr << HEADER.str() << USAGE;
 }
 
 // print help text to stderr
-void printHelpText(Filters & filters) {
+void printHelpText(lancet::Config & config) {
 		
 	stringstream helptext;
 	helptext <<
@@ -56,47 +60,59 @@ void printHelpText(Filters & filters) {
 		"   --ref, -r                <FASTA file>  : FASTA file of reference genome\n"
 		"   --reg, -p                <string>      : genomic region (in chr:start-end format)\n"
 		"   --bed, -B                <string>      : genomic regions from file (BED format)\n"
+		"   --genome                               : all the contigs of the BAM header (whole-genome mode)\n"
 
 		"\nOptional\n"
-		"   --min-k, k                <int>         : min kmersize [default: " << minK << "]\n"
-		"   --max-k, -K               <int>         : max kmersize [default: " << maxK << "]\n"
-		"   --trim-lowqual, -q        <int>         : trim bases below qv at 5' and 3' [default: " << MIN_QV_TRIM << "]\n"
-		"   --min-base-qual, -C       <int>         : minimum base quality required to consider a base for SNV calling [default: " << MIN_QV_CALL << "]\n"
-		"   --quality-range, -Q       <char>        : quality value range [default: " << (char) QV_RANGE << "]\n"
-		"   --min-map-qual, -b        <int>         : minimum read mapping quality in Phred-scale [default: " << MIN_MAP_QUAL << "]\n"
-		"   --max-as-xs-diff, -Z      <int>         : maximum different between AS and XS alignments scores [default: " << MAX_DELTA_AS_XS << "]\n"
-		"   --tip-len, -l             <int>         : max tip length [default: " << MAX_TIP_LEN << "]\n"
-		"   --cov-thr, -c             <int>         : min coverage threshold used to select reference anchors from the De Bruijn graph [default: " << COV_THRESHOLD << "]\n"
-		"   --cov-ratio, -x           <float>       : minimum coverage ratio used to remove nodes from the De Bruijn graph [default: " << MIN_COV_RATIO << "]\n"
-		"   --low-cov, -d             <int>         : low coverage threshold used to remove nodes from the De Bruijn graph [default: " << LOW_COV_THRESHOLD << "]\n"
-		"   --max-avg-cov, -u         <int>         : maximum average coverage allowed per region [default: " << MAX_AVG_COV << "]\n"
-		"   --window-size, -w         <int>         : window size of the region to assemble (in base-pairs) [default: " << WINDOW_SIZE << "]\n"
-		"   --padding, -P             <int>         : left/right padding (in base-pairs) applied to the input genomic regions [default: " << PADDING << "]\n"
-		"   --dfs-limit, -F           <int>         : limit dfs/bfs graph traversal search space [default: " << DFS_LIMIT << "]\n"
-		"   --max-indel-len, -T       <int>         : limit on size of detectable indel [default: " << MAX_INDEL_LEN << "]\n"
-		"   --max-mismatch, -M        <int>         : max number of mismatches for near-perfect repeats [default: " << MAX_MISMATCH << "]\n"
-		"   --num-threads, -X         <int>         : number of parallel threads [default: " << NUM_THREADS << "]\n"
+		"   --min-k, k                <int>         : min kmersize [default: " << config.minK << "]\n"
+		"   --max-k, -K               <int>         : max kmersize [default: " << config.maxK << "]\n"
+		"   --trim-lowqual, -q        <int>         : trim bases below qv at 5' and 3' [default: " << config.MIN_QV_TRIM << "]\n"
+		"   --min-base-qual, -C       <int>         : minimum base quality required to consider a base for SNV calling [default: " << config.MIN_QV_CALL << "]\n"
+		"   --quality-range, -Q       <char>        : quality value range [default: " << (char) config.QV_RANGE << "]\n"
+		"   --min-map-qual, -b        <int>         : minimum read mapping quality in Phred-scale [default: " << config.MIN_MAP_QUAL << "]\n"
+		"   --max-as-xs-diff, -Z      <int>         : maximum different between AS and XS alignments scores [default: " << config.MAX_DELTA_AS_XS << "]\n"
+		"   --tip-len, -l             <int>         : max tip length [default: " << config.MAX_TIP_LEN << "]\n"
+		"   --cov-thr, -c             <int>         : min coverage threshold used to select reference anchors from the De Bruijn graph [default: " << config.COV_THRESHOLD << "]\n"
+		"   --cov-ratio, -x           <float>       : minimum coverage ratio used to remove nodes from the De Bruijn graph [default: " << config.MIN_COV_RATIO << "]\n"
+		"   --low-cov, -d             <int>         : low coverage threshold used to remove nodes from the De Bruijn graph [default: " << config.LOW_COV_THRESHOLD << "]\n"
+		"   --max-avg-cov, -u         <int>         : maximum average coverage allowed per region [default: " << config.MAX_AVG_COV << "]\n"
+		"   --window-size, -w         <int>         : window size of the region to assemble (in base-pairs) [default: " << config.WINDOW_SIZE << "]\n"
+		"   --padding, -P             <int>         : left/right padding (in base-pairs) applied to the input genomic regions [default: " << config.PADDING << "]\n"
+		"   --dfs-limit, -F           <int>         : limit dfs/bfs graph traversal search space [default: " << config.DFS_LIMIT << "]\n"
+		"   --max-indel-len, -T       <int>         : limit on size of detectable indel [default: " << config.MAX_INDEL_LEN << "]\n"
+		"   --max-mismatch, -M        <int>         : max number of mismatches for near-perfect repeats [default: " << config.MAX_MISMATCH << "]\n"
+		"   --num-threads, -X         <int>         : number of parallel threads [default: " << config.NUM_THREADS << "]\n"
+		"   --checkpoint, -J          <string>      : journal completed windows and their variants to file\n"
+		"   --resume                                : skip the windows completed in the checkpoint file and reload their variants\n"
+		"   --shard                   <i/N>         : analyze only the i-th (1 to N) of N cost-balanced shards of the windows\n"
+		"   --contigs                 <string>      : comma separated list of the contigs to analyze in genome mode [default: all]\n"
+		"   --exclude-contigs         <string>      : comma separated list of the contigs to skip in genome mode\n"
+		"   --socket                  <string>      : UNIX socket the server (lancet serve) listens on [default: stdin/stdout]\n"
+		"   --evidence                <string>      : save the candidate variants and their read counts to file (input of lancet refilter)\n"
+		"   --sweep                   <string>      : file of parameter sets (one per line: output VCF and option=value pairs) analyzed in a single pass\n"
+		"   --window-stats            <string>      : write the statistics of each window (reads, time of each phase, k-mer sizes tried) to a TSV file\n"
+		"   --window-time-budget      <float>       : seconds allowed for the analysis of a window, skipped when over budget [default: no budget]\n"
+		"   --window-retry                          : retry the windows over budget at the end with larger k-mers and a smaller --dfs-limit\n"
 //		"   --rg-file, -g             <string>      : read group file\n"
-		"   --node-str-len, -L        <int>         : length of sequence to display at graph node (default: " << NODE_STRLEN << ")\n"
+		"   --node-str-len, -L        <int>         : length of sequence to display at graph node (default: " << config.NODE_STRLEN << ")\n"
 
 		"\nFilters\n"
-		"   --min-alt-count-tumor, -a  <int>        : minimum alternative count in the tumor [default: " << filters.minAltCntTumor << "]\n"
-		"   --max-alt-count-normal, -m <int>        : maximum alternative count in the normal [default: " << filters.maxAltCntNormal << "]\n"
-		"   --min-vaf-tumor, -e        <float>      : minimum variant allele frequency (AlleleCov/TotCov) in the tumor [default: " << filters.minVafTumor << "]\n"
-		"   --max-vaf-normal, -i       <float>      : maximum variant allele frequency (AlleleCov/TotCov) in the normal [default: " << filters.maxVafNormal << "]\n"
-		"   --min-coverage-tumor, -o   <int>        : minimum coverage in the tumor [default: " << filters.minCovTumor << "]\n"
-		"   --max-coverage-tumor, -y   <int>        : maximum coverage in the tumor [default: " << filters.maxCovTumor << "]\n"
-		"   --min-coverage-normal, -z  <int>        : minimum coverage in the normal [default: " << filters.minCovNormal << "]\n"
-		"   --max-coverage-normal, -j  <int>        : maximum coverage in the normal [default: " << filters.maxCovNormal << "]\n"
-		"   --min-phred-fisher, -s     <float>      : minimum fisher exact test score [default: " << filters.minPhredFisher << "]\n"
-		"   --min-phred-fisher-str, -E <float>      : minimum fisher exact test score for STR mutations [default: " << filters.minPhredFisherSTR << "]\n"
-		"   --min-strand-bias, -f      <float>      : minimum strand bias threshold [default: " << filters.minStrandBias << "]\n"
+		"   --min-alt-count-tumor, -a  <int>        : minimum alternative count in the tumor [default: " << config.filters.minAltCntTumor << "]\n"
+		"   --max-alt-count-normal, -m <int>        : maximum alternative count in the normal [default: " << config.filters.maxAltCntNormal << "]\n"
+		"   --min-vaf-tumor, -e        <float>      : minimum variant allele frequency (AlleleCov/TotCov) in the tumor [default: " << config.filters.minVafTumor << "]\n"
+		"   --max-vaf-normal, -i       <float>      : maximum variant allele frequency (AlleleCov/TotCov) in the normal [default: " << config.filters.maxVafNormal << "]\n"
+		"   --min-coverage-tumor, -o   <int>        : minimum coverage in the tumor [default: " << config.filters.minCovTumor << "]\n"
+		"   --max-coverage-tumor, -y   <int>        : maximum coverage in the tumor [default: " << config.filters.maxCovTumor << "]\n"
+		"   --min-coverage-normal, -z  <int>        : minimum coverage in the normal [default: " << config.filters.minCovNormal << "]\n"
+		"   --max-coverage-normal, -j  <int>        : maximum coverage in the normal [default: " << config.filters.maxCovNormal << "]\n"
+		"   --min-phred-fisher, -s     <float>      : minimum fisher exact test score [default: " << config.filters.minPhredFisher << "]\n"
+		"   --min-phred-fisher-str, -E <float>      : minimum fisher exact test score for STR mutations [default: " << config.filters.minPhredFisherSTR << "]\n"
+		"   --min-strand-bias, -f      <float>      : minimum strand bias threshold [default: " << config.filters.minStrandBias << "]\n"
 			
 		"\nShort Tandem Repeat parameters\n"
-		"   --max-unit-length, -U      <int>        : maximum unit length of the motif [default: " << MAX_UNIT_LEN << "]\n"
-		"   --min-report-unit, -N      <int>        : minimum number of units to report [default: " << MIN_REPORT_UNITS << "]\n"
-		"   --min-report-len, -Y       <int>        : minimum length of tandem in base pairs [default: " << MIN_REPORT_LEN << "]\n"
-		"   --dist-from-str, -D        <int>        : distance (in bp) of variant from STR locus [default: " << DIST_FROM_STR << "]\n"
+		"   --max-unit-length, -U      <int>        : maximum unit length of the motif [default: " << config.MAX_UNIT_LEN << "]\n"
+		"   --min-report-unit, -N      <int>        : minimum number of units to report [default: " << config.MIN_REPORT_UNITS << "]\n"
+		"   --min-report-len, -Y       <int>        : minimum length of tandem in base pairs [default: " << config.MIN_REPORT_LEN << "]\n"
+		"   --dist-from-str, -D        <int>        : distance (in bp) of variant from STR locus [default: " << config.DIST_FROM_STR << "]\n"
 		
 		"\nFlags\n"
 		"   --primary-alignment-only, -I  : only use primary alignments for variant calling\n"
@@ -116,214 +132,24 @@ void printHelpText(Filters & filters) {
 }
 
 // print configuration to file
-void printConfiguration(ostream & out, Filters & filters)
+void printConfiguration(ostream & out, lancet::Config & config, const string & region, const string & bedfile)
 {
-	out << "tumor-BAM: "        << TUMOR << endl;
-	out << "normal-BAM: "       << NORMAL << endl;
-	out << "reference: "        << REFFILE << endl;
-	out << "region: "           << REGION  << endl;
-	out << "BED-file: "         << BEDFILE  << endl;
-
-	out << "min-K: "            << minK << endl;
-	out << "max-K: "            << maxK << endl;
-	out << "tip-len: "          << MAX_TIP_LEN << endl;
-
-	//out << "MIN_THREAD_READS: " << MIN_THREAD_READS << endl;
-	out << "cov-thr: "          << COV_THRESHOLD << endl;
-	cerr.unsetf(ios::floatfield); // floatfield not set
-	cerr.precision(5);
-	out << "cov-ratio: "        << MIN_COV_RATIO << endl;
-	cerr.setf(ios::fixed,ios::floatfield);
-	cerr.precision(1);
-	out << "low-cov: "          << LOW_COV_THRESHOLD << endl;
-	out << "window-size: "      << WINDOW_SIZE << endl;
-	out << "padding: "          << PADDING << endl;
-	out << "max-avg-cov: "      << MAX_AVG_COV << endl;
-	out << "min-map-qual: "     << MIN_MAP_QUAL << endl;
-	out << "max-as-xs-diff: "   << MAX_DELTA_AS_XS << endl;
-	out << "min-base-qual: "    << MIN_QV_CALL << endl;
-	out << "trim-lowqual: "     << MIN_QV_TRIM << endl;
-	out << "quality-range: "    << QV_RANGE << endl;	
-	out << "node-str-len: "     << NODE_STRLEN << endl;
-	out << "dfs-limit: "        << DFS_LIMIT << endl;
-	out << "max-indel-len: "    << MAX_INDEL_LEN << endl;
-	out << "max-mismatch: "     << MAX_MISMATCH << endl;
-	out << "num-threads: "      << NUM_THREADS << endl;	
-	//out << "SCAFFOLD_CONTIGS: " << bvalue(SCAFFOLD_CONTIGS) << endl;
-	//out << "INSERT_SIZE: "      << INSERT_SIZE << " +/- " << INSERT_STDEV << endl;
-	
-	// str parameters
-	out << "max-unit-length: "   << MAX_UNIT_LEN << endl;
-	out << "min-report-unit: "   << MIN_REPORT_UNITS << endl;
-	out << "min-report-len: "    << MIN_REPORT_LEN << endl;
-	out << "dist-from-str: "     << DIST_FROM_STR << endl;	
-	
-	//filters
-	out << "min-phred-fisher: "     << filters.minPhredFisher << endl;
-	out << "min-phred-fisher-str: " << filters.minPhredFisherSTR << endl;
-	out << "min-strand-bias: "      << filters.minStrandBias << endl;
-	out << "min-alt-count-tumor: "  << filters.minAltCntTumor << endl;
-	out << "max-alt-count-normal: " << filters.maxAltCntNormal << endl;
-	out << "min-vaf-tumor: "        << filters.minVafTumor << endl;
-	out << "max-vaf-normal: "       << filters.maxVafNormal << endl;
-	out << "min-coverage-tumor: "   << filters.minCovTumor << endl;
-	out << "max-coverage-tumor: "   << filters.maxCovTumor << endl;
-	out << "min-coverage-normal: "  << filters.minCovNormal << endl;
-	out << "max-coverage-normal: "  << filters.maxCovNormal << endl;
-
-	out << "primary-alignment-only: " << bvalue(PRIMARY_ALIGNMENT_ONLY) << endl;	
-	out << "XA-tag-filter: "    << bvalue(XA_FILTER) << endl;	
-	out << "active-regions: "   << bvalue(ACTIVE_REGIONS) << endl;
-	out << "kmer-recovery: "    << bvalue(KMER_RECOVERY) << endl;
-	out << "print-graphs: "     << bvalue(PRINT_ALL) << endl;
-	out << "verbose: "          << bvalue(verbose) << endl;
-	out << "more-verbose: "     << bvalue(VERBOSE) << endl;
-	out << "print-config-file: "<< bvalue(PRINT_CONFIG) << endl;
+	config.print(out);
+	out << "region: "           << region  << endl;
+	out << "BED-file: "         << bedfile  << endl;
 	
 	out << endl;
 }
 
-// loadRef
-//////////////////////////////////////////////////////////////
-int loadRefs(const string reference, const string region, vector< map<string, Ref_t *> > &reftable, RefVector &bamrefs, int num_threads, int thread)	
-{
-	//if(verbose) { cerr << "LoadRef " << reference << endl; }
-
-	string ss;
-	string hdr = region;
-	string CHR;
-	string START;
-	string END;
-	
-	// extrat coordinates for header
-	size_t x     = hdr.find_first_of(':');
-	
-	if ( (x == string::npos) && (hdr.length()>0) ) { // no ":" symbol found -> assume single chromosome name format	
-		CHR   = hdr.substr(0,x);
-		START = "1";
-		std::vector<RefData>::iterator it;
-	    for (it = bamrefs.begin() ; it != bamrefs.end(); ++it) {
-			//cerr << it->RefName << endl;
-			if (it->RefName == CHR) { 
-			    std::ostringstream oss;
-			    oss << it->RefLength;
-				END = oss.str(); 
-				break; 
-			}
-	    }
-		
-		// report error if the chromosome label is not found in BAM header.
-		if (it == bamrefs.end()) {
-			cerr << "ERROR: chromosome label " << CHR << " not found in BAM header!" << endl;  
-		}
-		
-	}
-	else {
-		size_t y = hdr.find_first_of('-', x);
-		CHR  	 = hdr.substr(0,x);
-		START	 = hdr.substr(x+1, y-x-1);
-		END   	 = hdr.substr(y+1, string::npos);
-				
-		int SP = stoi(START) - PADDING;
-		int EP = stoi(END) + PADDING;
-		
-		if(SP<1) {SP=1;} // start position cannnot be less than 1
-		// check chromosome size
-		std::vector<RefData>::iterator it;
-	    for (it = bamrefs.begin() ; it != bamrefs.end(); ++it) {
-			if (it->RefName == CHR) {
-				if(EP > it->RefLength) { EP = it->RefLength; } 
-				break; 
-			}
-		}		
-		// save updated coordinates
-		START = itos(SP);
-		END = itos(EP);
-	}
-	//cerr << CHR << ":" << START << "-" << END << endl; 
-	string REG = CHR+":"+START+"-"+END;
-	
-	// open fasta index
-    faidx_t *fai = fai_load(reference.c_str());
-    if ( !fai ) { cerr << "Could not load fai index of " << reference << endl; }
-
-	// extrat sequence
-    int seq_len;
-    char *seq = fai_fetch(fai, REG.c_str(), &seq_len);
-    if ( seq_len < 0 ) { cerr << "Failed to fetch sequence in " << REG << endl; }
-		
-	// convert char* to string
-	string s(seq, seq + seq_len);
-	
-	// convert to upper case and change IUPAC ambiguos codes in reference to Ns
-	for (unsigned int i = 0; i < s.length(); ++i) {
-		s[i] = toupper(s[i]);
-		if(isAmbiguos(s[i])) { s[i]='N'; }
-	}
-
-	// split into overalpping windows if sequence is too long
-	int end = s.length();
-	int offset = 0;
-	int delta = 100;
-	
-	int T = thread; // thread counter
-	for (; offset < end; offset+=delta) {
-		
-		// adjust end if 
-		int LEN = WINDOW_SIZE;
-		if( (offset + WINDOW_SIZE) >= (int)s.length() ) { 
-			LEN = s.length() - offset - 1;
-			//offset = s.length() - WINDOW_SIZE - 1;
-			end = offset;
-		}
-		
-		ss = s.substr(offset,LEN);
-		
-		// make new reference entry 
-		Ref_t * ref = new Ref_t(minK);
-	
-		ref->refchr   = CHR;
-		ref->refstart = atoi(START.c_str()) + offset;
-		ref->refend   = ref->refstart + LEN;
-		//ref->refend   = atoi(end.c_str());
-		
-		hdr = ref->refchr;
-		hdr += ":";
-		hdr += itos(ref->refstart);
-		hdr += "-";
-		hdr += itos(ref->refend);
-
-		if(verbose) { cerr << "hdr:\t" << hdr << endl; }
-		
-		ref->setHdr(hdr);
-		ref->setSeq(ss);
-		ref->setRawSeq(ss);
-		
-		ref->hdr = hdr;
-		
-		reftable[T].insert(make_pair(hdr, ref));
-		++num_windows;
-		
-		// move to next reftable
-		++T;
-		if( (num_windows%num_threads) == 0) { T=0; }
-	}
-	
-	fai_destroy(fai);
-	
-	return T;
-}
-
-// loadbed : load regions from BED file
+// loadbed : regions of a BED file (padded)
 //////////////////////////////////////////////////////////////
-void loadBed(const string bedfile, vector< map<string, Ref_t *> > &reftable, RefVector &bamrefs, int num_threads) { 
+void loadBed(const string bedfile, int padding, vector<string> &regions) { 
 	
 	int num_regions = 0;
 	string line;
 	string region;
 	vector<std::string> tokens;
 	ifstream bfile (bedfile);
-	int t = 0;
 	if (bfile.is_open()) {
 		while ( getline (bfile,line) ) {
 			
@@ -341,14 +167,14 @@ void loadBed(const string bedfile, vector< map<string, Ref_t *> > &reftable, Ref
 				tokens.push_back(token);
 			}
 			
-			int SP = stoi(tokens[1]) - PADDING;
-			int EP = stoi(tokens[2]) + PADDING;
+			int SP = stoi(tokens[1]) - padding;
+			int EP = stoi(tokens[2]) + padding;
 			
 			if(SP<1) {SP=1;} // start position cannnot be less than 1
 				
 			//region = tokens[0] + ":" + tokens[1] + "-" + tokens[2];	
 			region = tokens[0] + ":" + itos(SP) + "-" + itos(EP);	
-			t = loadRefs(REFFILE,region,reftable,bamrefs,num_threads, t);
+			regions.push_back(region);
 		}
 		bfile.close();
 		
@@ -360,241 +186,122 @@ void loadBed(const string bedfile, vector< map<string, Ref_t *> > &reftable, Ref
 	}
 }
 
-static void* execute(void* ptr) {
-
-    Microassembler* ma = (Microassembler*)ptr;
+// loadSweep : configurations of a parameter sweep
+// every line of the file is a configuration: the output VCF followed by
+// option=value pairs (long options of the command line) that change the
+// base configuration
+//////////////////////////////////////////////////////////////
+void loadSweep(const string sweepfile, const lancet::Config & base, vector<lancet::Config> & configs, vector<string> & outputs) {
 	
-	ma->processReads();
-	//ma->vDB.printToVCF();
+	ifstream sfile (sweepfile);
+	if (!sfile.is_open()) {
+		cerr << "Couldn't open " << sweepfile << endl;
+		exit(1);
+	}
+	
+	string line;
+	int num_line = 0;
+	while ( getline (sfile,line) ) {
+		++num_line;
+		
+		size_t x = line.find_first_not_of(" \t\r");
+		if ( (x == string::npos) || (line[x] == '#') ) { continue; } // skip empty lines and comments
+		
+		istringstream iss(line);
+		string output;
+		string token;
+		iss >> output;
+		
+		lancet::Config config = base;
+		while (iss >> token) {
+			size_t eq = token.find('=');
+			string option = token.substr(0, eq);
+			if (option.compare(0, 2, "--") == 0) { option = option.substr(2); }
+			
+			if ( (eq == string::npos) || !config.set(option, token.substr(eq+1)) ) {
+				cerr << "ERROR: invalid parameter " << token << " at line " << num_line << " of " << sweepfile << endl;
+				exit(1);
+			}
+		}
+		
+		configs.push_back(config);
+		outputs.push_back(output);
+	}
+	sfile.close();
+	
+	if (configs.empty()) {
+		cerr << "ERROR: no configuration in " << sweepfile << endl;
+		exit(1);
+	}
 	
-	pthread_exit(NULL);
+	cerr << "Loaded " << configs.size() << " configurations from " << sweepfile << endl;
 }
 
-//lancet_function(tumor, normal, ref, reg, numthreads)
-
-
-// main
+// rLancet
+// call the variants of a region or of a BED file and print them in VCF format
 //////////////////////////////////////////////////////////////////////////
 int rLancet(string tumor_bam, string normal_bam, string ref_fasta, string reg, string bed_file, int numthreads)
 {
-
-	TUMOR = tumor_bam;
-	NORMAL = normal_bam;
-	REFFILE = ref_fasta;
-	REGION = reg;
-	BEDFILE = bed_file;
-	NUM_THREADS = numthreads;
-	
-	// initilize filter thresholds
-	Filters filters;
-	filters.minPhredFisherSTR = 25;
-	filters.minPhredFisher = 5;
-	filters.minCovNormal = 10;
-	filters.maxCovNormal = 1000000;
-	filters.minCovTumor = 4;
-	filters.maxCovTumor = 1000000;
-	filters.minVafTumor = 0.04;
-	filters.maxVafNormal = 0;
-	filters.minAltCntTumor = 3;
-	filters.maxAltCntNormal = 0;
-	filters.minStrandBias = 1;
-
-	// update min base quality values
-	MIN_QUAL_TRIM = MIN_QV_TRIM + QV_RANGE;
-	MIN_QUAL_CALL = MIN_QV_CALL + QV_RANGE;
+	lancet::Config config;
+	config.TUMOR = tumor_bam;
+	config.NORMAL = normal_bam;
+	config.REFFILE = ref_fasta;
+	config.NUM_THREADS = numthreads;
 
 	bool errflg = false;
 
-	if (TUMOR == "") { cerr << "ERROR: Must provide the tumor BAM file (-t)" << endl; ++errflg; }
-	if (NORMAL == "") { cerr << "ERROR: Must provide the normal BAM file (-n)" << endl; ++errflg; }		
-	if (REFFILE == "") { cerr << "ERROR: Must provide a reference genome file (-r)" << endl; ++errflg; }
-	if ( (BEDFILE == "") && (REGION == "") ) { cerr << "ERROR: Must provide region (-p) or BED file (-B)" << endl; ++errflg; }
+	if (config.TUMOR == "") { cerr << "ERROR: Must provide the tumor BAM file (-t)" << endl; ++errflg; }
+	if (config.NORMAL == "") { cerr << "ERROR: Must provide the normal BAM file (-n)" << endl; ++errflg; }		
+	if (config.REFFILE == "") { cerr << "ERROR: Must provide a reference genome file (-r)" << endl; ++errflg; }
+	if ( (bed_file == "") && (reg == "") ) { cerr << "ERROR: Must provide region (-p) or BED file (-B)" << endl; ++errflg; }
 
 	if (errflg) { exit(EXIT_FAILURE); }
 	
+	vector<string> regions;
+	if (bed_file != "") { loadBed(bed_file, config.PADDING, regions); }
+	if (reg != "") { regions.push_back(reg); }
+	
+	lancet::Caller caller(config);
+	if (caller.open() != 0) { return -1; }
+	
     ofstream params_file;
     params_file.open ("config.txt");
-	printConfiguration(params_file, filters); // save parameters setting to file
+	printConfiguration(params_file, caller.config_m, reg, bed_file); // save parameters setting to file
     params_file.close();
 
-	if(verbose) { printConfiguration(cerr, filters); }
-	
-	BamReader readerT;
-	// attempt to open the BamReader
-	if ( !readerT.Open(TUMOR) ) {
-		cerr << "Could not open tumor BAM file." << endl;
-		return -1;
-	}
+	if(caller.config_m.verbose) { printConfiguration(cerr, caller.config_m, reg, bed_file); }
 	
-	BamReader readerN;
-	// attempt to open the BamReader
-	if ( !readerN.Open(NORMAL) ) {
-		cerr << "Could not open normal BAM file." << endl;
-		return -1;
-	}
+	if (caller.call(regions) != 0) { return -1; }
 	
-	bool found = (checkPresenceOfMDtag(readerT) || checkPresenceOfMDtag(readerN));		
-	if(!found && ACTIVE_REGIONS) {
-		cerr << endl << "--------WARNING--------" << endl;
-		cerr << "MD tag required to select active regions, but is missing from alignments." << endl;
-		cerr << "RECOMMENDED ACTION: turn off the active region module (--active-region-off)" << endl;
-		cerr << "-----------------------" << endl << endl;
-	}
-	
-	RefVector references = readerT.GetReferenceData(); // Extract all reference sequence entries.
-	
-	// run the assembler on each region
-	try {
-		
-		//Microassembler* driver = new Microassembler();
-		//driver->run(argc, argv);
-		//assembler->vDB.printToVCF();
-
-		pthread_t threads[NUM_THREADS];
-		pthread_attr_t attr;
-		void * status;
-		int rc;
-		int i;		
-		vector<Microassembler*> assemblers(NUM_THREADS, new Microassembler());
-		vector< map<string, Ref_t *> > reftables(NUM_THREADS, map<string, Ref_t *>()); // table of references to analyze
-		
-		if (BEDFILE != "") {
-			loadBed(BEDFILE,reftables,references,NUM_THREADS);
-		}
-		if (REGION != "") {
-			loadRefs(REFFILE,REGION,reftables,references,NUM_THREADS, 0);
-		}
-		
-		cerr << num_windows << " total windows to process" << endl << endl;
-		
-		// Initialize and set thread joinable
-		pthread_attr_init(&attr);
-		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
-
-		for( i=0; i < NUM_THREADS; ++i ) {
-			cerr << "starting thread " << (i+1) << " on " << reftables[i].size() << " windows" << endl;
-		
-			assemblers[i] = new Microassembler();
-
-			assemblers[i]->XA_FILTER = XA_FILTER;
-			assemblers[i]->PRIMARY_ALIGNMENT_ONLY = PRIMARY_ALIGNMENT_ONLY;
-			assemblers[i]->ACTIVE_REGION_MODULE = ACTIVE_REGIONS;
-			assemblers[i]->KMER_RECOVERY = KMER_RECOVERY;
-			assemblers[i]->verbose = verbose;
-			assemblers[i]->VERBOSE = VERBOSE;
-			assemblers[i]->PRINT_DOT_READS = PRINT_DOT_READS;
-			assemblers[i]->PRINT_ALL = PRINT_ALL;
-			assemblers[i]->MIN_QV_CALL = MIN_QV_CALL;
-			assemblers[i]->MIN_QV_TRIM = MIN_QV_TRIM;
-			assemblers[i]->QV_RANGE = QV_RANGE;
-			assemblers[i]->MIN_QUAL_TRIM = MIN_QUAL_TRIM;
-			assemblers[i]->MIN_QUAL_CALL = MIN_QUAL_CALL;
-			assemblers[i]->MIN_MAP_QUAL = MIN_MAP_QUAL;
-			assemblers[i]->MAX_DELTA_AS_XS = MAX_DELTA_AS_XS;
-			assemblers[i]->TUMOR = TUMOR;
-			assemblers[i]->NORMAL = NORMAL;
-			assemblers[i]->RG_FILE = RG_FILE;
-			assemblers[i]->REFFILE = REFFILE;
-			assemblers[i]->minK = minK;
-			assemblers[i]->maxK = maxK;
-			assemblers[i]->MAX_TIP_LEN = MAX_TIP_LEN;
-			assemblers[i]->MIN_THREAD_READS = MIN_THREAD_READS;
-			assemblers[i]->COV_THRESHOLD = COV_THRESHOLD;
-			assemblers[i]->MIN_COV_RATIO = MIN_COV_RATIO;
-			assemblers[i]->LOW_COV_THRESHOLD = LOW_COV_THRESHOLD;
-			assemblers[i]->MAX_AVG_COV = MAX_AVG_COV;
-			assemblers[i]->NODE_STRLEN = NODE_STRLEN;
-			assemblers[i]->DFS_LIMIT = DFS_LIMIT;
-			assemblers[i]->MAX_INDEL_LEN = MAX_INDEL_LEN;
-			assemblers[i]->MAX_MISMATCH = MAX_MISMATCH;	
-			assemblers[i]->MAX_UNIT_LEN = MAX_UNIT_LEN;
-			assemblers[i]->MIN_REPORT_UNITS = MIN_REPORT_UNITS;
-			assemblers[i]->MIN_REPORT_LEN = MIN_REPORT_LEN;
-			assemblers[i]->DIST_FROM_STR = DIST_FROM_STR;
-			
-			assemblers[i]->reftable = &reftables[i];
-			assemblers[i]->setFilters(&filters);
-			assemblers[i]->setID(i+1);
+	cerr << "Export variants to VCF file" << endl;
+	caller.printVCF(cout, VERSION);
 	
-			rc = pthread_create(&threads[i], NULL, execute, (void * )assemblers[i]);
-			
-			if (rc){
-				cerr << "Error:unable to create thread," << rc << endl;
-				exit(-1);
-			}
-		}
-		
-		// free attribute and wait for the other threads
-		pthread_attr_destroy(&attr);
-		for( i=0; i < NUM_THREADS; ++i ){
-			rc = pthread_join(threads[i], &status);
-			if (rc){
-				cerr << "Error:unable to join," << rc << endl;
-				exit(-1);
-			}
-			cerr << "Main: completed thread id :" << (i+1) ;
-			cerr << " exiting with status :" << status << endl;
-		}
-		
-		int tot_skip = 0;
-		int tot_svn_only = 0;
-		int tot_indel_only = 0;
-		int tot_softclip_only = 0;
-		int tot_indel_or_softclip = 0;
-		int tot_snv_or_indel = 0;
-		int tot_snv_or_softclip = 0;
-		int tot_snv_or_indel_or_softclip = 0;
-		//merge variant from all threads
-		cerr << "Merge variants" << endl;
-		VariantDB_t variantDB; // variants DB
-		for( i=0; i < NUM_THREADS; ++i ) {
-			
-			tot_skip += assemblers[i]->num_skip;
-			tot_svn_only += assemblers[i]->num_snv_only_regions;
-			tot_indel_only += assemblers[i]->num_indel_only_regions;
-			tot_softclip_only += assemblers[i]->num_softclip_only_regions;
-			tot_indel_or_softclip += assemblers[i]->num_indel_or_softclip_regions;			
-			tot_snv_or_indel += assemblers[i]->num_snv_or_indel_regions;			
-			tot_snv_or_softclip += assemblers[i]->num_snv_or_softclip_regions;
-			tot_snv_or_indel_or_softclip += assemblers[i]->num_snv_or_indel_or_softclip_regions;
-						
-			map<string,Variant_t> db = (assemblers[i]->vDB).DB;
-			map<string,Variant_t>::iterator it;			
-			for (it=db.begin(); it!=db.end(); ++it) {
-				variantDB.addVar(it->second);
-			}
-		}
-		
-		//if(verbose) {
-			cerr << "Total # of skipped windows: " << tot_skip << " (" << (100*(double)tot_skip/double(num_windows)) << "\%)" << endl;
-			cerr << "- # of windows with SNVs only: " << tot_svn_only << endl;
-			cerr << "- # of windows with indels only: " << tot_indel_only << endl;
-			cerr << "- # of windows with softclips only: " << tot_softclip_only << endl;
-			cerr << "- # of windows with indels or softclips: " << tot_indel_or_softclip << endl;
-			cerr << "- # of windows with SNVs or indels: " << tot_snv_or_indel << endl;
-			cerr << "- # of windows with SNVs or softclips: " << tot_snv_or_softclip << endl;
-			cerr << "- # of windows with SNVs or indels or softclips: " << tot_snv_or_indel_or_softclip << endl;
-		//}
-		
-		/***** get current time and date *****/
-		time_t rawtime;
-		time (&rawtime);
-		char* DATE = ctime (&rawtime);
-		/***************************************/
-		
-		variantDB.printToVCF(VERSION, REFFILE, DATE, filters, assemblers[0]->sample_name_normal, assemblers[0]->sample_name_tumor);		
-	}
-	catch (int e) {
-		cerr << "An exception occurred. Exception Nr. " << e << endl;
-	}
-
-	pthread_exit(NULL);
+	return 0;
 }
 
 // main
 //////////////////////////////////////////////////////////////////////////
 int main(int argc, char** argv)
 {
+	
+	// merge subcommand: same options as the sharded runs followed by their checkpoint files
+	if ( (argc > 1) && (string(argv[1]) == "merge") ) {
+		MERGE = true;
+		--argc;
+		++argv;
+	}
+	// serve subcommand: same options as a run, the regions are requested by the clients
+	else if ( (argc > 1) && (string(argv[1]) == "serve") ) {
+		SERVE = true;
+		--argc;
+		++argv;
+	}
+	// refilter subcommand: filter options followed by the evidence file of a run
+	else if ( (argc > 1) && (string(argv[1]) == "refilter") ) {
+		REFILTER = true;
+		--argc;
+		++argv;
+	}
 
 	if (argc == 1)
 	{
@@ -614,30 +321,20 @@ int main(int argc, char** argv)
 		exit(0);
 	}
 
-	COMMAND_LINE = buildCommandLine(argc,argv);
+	lancet::Config config; // defaults of the calling parameters
+	config.COMMAND_LINE = buildCommandLine(argc,argv);
 	
 	cerr.setf(ios::fixed,ios::floatfield);
 	cerr.precision(1);
 	
-	// initilize filter thresholds
-	Filters filters;
-	filters.minPhredFisherSTR = 25;
-	filters.minPhredFisher = 5;
-	filters.minCovNormal = 10;
-	filters.maxCovNormal = 1000000;
-	filters.minCovTumor = 4;
-	filters.maxCovTumor = 1000000;
-	filters.minVafTumor = 0.04;
-	filters.maxVafNormal = 0;
-	filters.minAltCntTumor = 3;
-	filters.maxAltCntNormal = 0;
-	filters.minStrandBias = 1;
-	
 	bool errflg = false;
 	int ch;
 
 	optarg = NULL;
 	
+	// codes of the options without a short name
+	enum { OPT_RESUME = 256, OPT_SHARD, OPT_GENOME, OPT_CONTIGS, OPT_EXCLUDE_CONTIGS, OPT_SOCKET, OPT_EVIDENCE, OPT_SWEEP, OPT_WINDOW_STATS, OPT_WINDOW_TIME_BUDGET, OPT_WINDOW_RETRY };
+	
 	static struct option long_options[] = {
 		
 		// required
@@ -668,6 +365,18 @@ int main(int argc, char** argv)
 		{"dfs-limit",  required_argument, 0, 'F'},
 		//{"path-limit",  required_argument, 0, 'P'},
 		{"num-threads",  required_argument, 0, 'X'},
+		{"checkpoint",  required_argument, 0, 'J'},
+		{"resume", no_argument, 0, OPT_RESUME},
+		{"shard",  required_argument, 0, OPT_SHARD},
+		{"genome", no_argument, 0, OPT_GENOME},
+		{"contigs",  required_argument, 0, OPT_CONTIGS},
+		{"exclude-contigs",  required_argument, 0, OPT_EXCLUDE_CONTIGS},
+		{"socket",  required_argument, 0, OPT_SOCKET},
+		{"evidence",  required_argument, 0, OPT_EVIDENCE},
+		{"sweep",  required_argument, 0, OPT_SWEEP},
+		{"window-stats",  required_argument, 0, OPT_WINDOW_STATS},
+		{"window-time-budget",  required_argument, 0, OPT_WINDOW_TIME_BUDGET},
+		{"window-retry", no_argument, 0, OPT_WINDOW_RETRY},
 		{"max-indel-len",  required_argument, 0, 'T'},
 		{"max-mismatch",  required_argument, 0, 'M'},
 
@@ -706,64 +415,81 @@ int main(int argc, char** argv)
 	int option_index = 0;
 
 	//while (!errflg && ((ch = getopt (argc, argv, "u:m:n:r:g:s:k:K:l:t:c:d:x:BDRACIhSL:T:M:vF:q:b:Q:P:p:E")) != EOF))
-	while (!errflg && ((ch = getopt_long (argc, argv, "u:n:r:g:k:K:l:f:t:c:C:d:x:ARhHSIWOL:T:P:M:vVF:q:b:B:Q:p:s:E:a:m:e:i:o:y:z:w:j:X:U:N:Y:D:Z:", long_options, &option_index)) != -1))
+	while (!errflg && ((ch = getopt_long (argc, argv, "u:n:r:g:k:K:l:f:t:c:C:d:x:ARhHSIWOL:T:P:M:vVF:q:b:B:Q:p:s:E:a:m:e:i:o:y:z:w:j:X:J:U:N:Y:D:Z:", long_options, &option_index)) != -1))
 	{
 		switch (ch)
 		{
-			case 't': TUMOR            = optarg;       break; 
-			case 'n': NORMAL           = optarg;       break; 
-			case 'r': REFFILE          = optarg;       break;
+			case 't': config.TUMOR            = optarg;       break; 
+			case 'n': config.NORMAL           = optarg;       break; 
+			case 'r': config.REFFILE          = optarg;       break;
 			case 'B': BEDFILE          = optarg;       break;
 			case 'p': REGION           = optarg;       break;
 			
-			case 'g': RG_FILE          = optarg;       break;
-			case 'k': minK             = atoi(optarg); break;
-			case 'K': maxK             = atoi(optarg); break;
-			case 'l': MAX_TIP_LEN      = atoi(optarg); break;
+			case 'g': config.RG_FILE          = optarg;       break;
+			case 'k': config.minK             = atoi(optarg); break;
+			case 'K': config.maxK             = atoi(optarg); break;
+			case 'l': config.MAX_TIP_LEN      = atoi(optarg); break;
 			//case 't': MIN_THREAD_READS = atoi(optarg); break;
-			case 'c': COV_THRESHOLD    = atoi(optarg); break;
-			case 'x': MIN_COV_RATIO    = atof(optarg); break;
-			case 'd': LOW_COV_THRESHOLD= atoi(optarg); break;
-			case 'w': WINDOW_SIZE      = atoi(optarg); break;
-			case 'P': PADDING          = atoi(optarg); break;
-			case 'u': MAX_AVG_COV      = atoi(optarg); break;
+			case 'c': config.COV_THRESHOLD    = atoi(optarg); break;
+			case 'x': config.MIN_COV_RATIO    = atof(optarg); break;
+			case 'd': config.LOW_COV_THRESHOLD= atoi(optarg); break;
+			case 'w': config.WINDOW_SIZE      = atoi(optarg); break;
+			case 'P': config.PADDING          = atoi(optarg); break;
+			case 'u': config.MAX_AVG_COV      = atoi(optarg); break;
 			
-			case 'q': MIN_QV_TRIM      = atoi(optarg); break;
-			case 'C': MIN_QV_CALL      = atoi(optarg); break;
-			case 'b': MIN_MAP_QUAL     = atoi(optarg); break;
-			case 'Z': MAX_DELTA_AS_XS  = atoi(optarg); break;
-			case 'Q': QV_RANGE         = *optarg;      break;
-
-			case 'L': NODE_STRLEN      = atoi(optarg); break;
-			case 'F': DFS_LIMIT        = atoi(optarg); break;
-			case 'X': NUM_THREADS      = atoi(optarg); break;
-			case 'T': MAX_INDEL_LEN    = atoi(optarg); break;
-			case 'M': MAX_MISMATCH     = atoi(optarg); break;
+			case 'q': config.MIN_QV_TRIM      = atoi(optarg); break;
+			case 'C': config.MIN_QV_CALL      = atoi(optarg); break;
+			case 'b': config.MIN_MAP_QUAL     = atoi(optarg); break;
+			case 'Z': config.MAX_DELTA_AS_XS  = atoi(optarg); break;
+			case 'Q': config.QV_RANGE         = *optarg;      break;
+
+			case 'L': config.NODE_STRLEN      = atoi(optarg); break;
+			case 'F': config.DFS_LIMIT        = atoi(optarg); break;
+			case 'X': config.NUM_THREADS      = atoi(optarg); break;
+			case 'J': config.CHECKPOINT_FILE  = optarg;       break;
+			case OPT_SHARD: 
+				if ( (sscanf(optarg, "%d/%d", &config.SHARD, &config.NUM_SHARDS) != 2) || (config.NUM_SHARDS < 1) || (config.SHARD < 1) || (config.SHARD > config.NUM_SHARDS) ) { 
+					cerr << "ERROR: invalid shard " << optarg << " (expected i/N with 1 <= i <= N)" << endl;
+					errflg = true;
+				}
+				break;
+			case 'T': config.MAX_INDEL_LEN    = atoi(optarg); break;
+			case 'M': config.MAX_MISMATCH     = atoi(optarg); break;
 			
-			case 'U': MAX_UNIT_LEN     = atoi(optarg); break;
-			case 'N': MIN_REPORT_UNITS = atoi(optarg); break;
-			case 'Y': MIN_REPORT_LEN   = atoi(optarg); break;
-			case 'D': DIST_FROM_STR    = atoi(optarg); break;
-
-			case 'E': filters.minPhredFisherSTR = atof(optarg); break;			
-			case 's': filters.minPhredFisher = atof(optarg); break;
-			case 'f': filters.minStrandBias = atof(optarg); break;
-			case 'a': filters.minAltCntTumor = atoi(optarg); break;
-			case 'm': filters.maxAltCntNormal = atoi(optarg); break;
-			case 'e': filters.minVafTumor = atof(optarg); break;
-			case 'i': filters.maxVafNormal = atof(optarg); break;
-			case 'o': filters.minCovTumor = atoi(optarg); break;
-			case 'y': filters.maxCovTumor = atoi(optarg); break;
-			case 'z': filters.minCovNormal = atoi(optarg); break;
-			case 'j': filters.maxCovNormal = atoi(optarg); break;
-
-			case 'I': PRIMARY_ALIGNMENT_ONLY   = 1;    break;
-			case 'O': XA_FILTER        = 1;            break;
-			case 'W': ACTIVE_REGIONS   = 0;            break;
-			case 'R': KMER_RECOVERY    = 1;            break;
-			case 'v': verbose          = 1;            break;
-			case 'V': VERBOSE=1; verbose=1;            break;
-			case 'A': PRINT_ALL        = 1;            break;
+			case 'U': config.MAX_UNIT_LEN     = atoi(optarg); break;
+			case 'N': config.MIN_REPORT_UNITS = atoi(optarg); break;
+			case 'Y': config.MIN_REPORT_LEN   = atoi(optarg); break;
+			case 'D': config.DIST_FROM_STR    = atoi(optarg); break;
+
+			case 'E': config.filters.minPhredFisherSTR = atof(optarg); break;			
+			case 's': config.filters.minPhredFisher = atof(optarg); break;
+			case 'f': config.filters.minStrandBias = atof(optarg); break;
+			case 'a': config.filters.minAltCntTumor = atoi(optarg); break;
+			case 'm': config.filters.maxAltCntNormal = atoi(optarg); break;
+			case 'e': config.filters.minVafTumor = atof(optarg); break;
+			case 'i': config.filters.maxVafNormal = atof(optarg); break;
+			case 'o': config.filters.minCovTumor = atoi(optarg); break;
+			case 'y': config.filters.maxCovTumor = atoi(optarg); break;
+			case 'z': config.filters.minCovNormal = atoi(optarg); break;
+			case 'j': config.filters.maxCovNormal = atoi(optarg); break;
+
+			case 'I': config.PRIMARY_ALIGNMENT_ONLY   = 1;    break;
+			case 'O': config.XA_FILTER        = 1;            break;
+			case 'W': config.ACTIVE_REGIONS   = 0;            break;
+			case 'R': config.KMER_RECOVERY    = 1;            break;
+			case 'v': config.verbose          = 1;            break;
+			case 'V': config.VERBOSE=1; config.verbose=1;            break;
+			case 'A': config.PRINT_ALL        = 1;            break;
+			case OPT_RESUME: config.RESUME    = 1;            break;
+			case OPT_GENOME: config.GENOME    = 1;            break;
+			case OPT_CONTIGS: config.CONTIGS  = optarg;       break;
+			case OPT_EXCLUDE_CONTIGS: config.EXCLUDE_CONTIGS = optarg; break;
+			case OPT_SOCKET: SOCKET_PATH = optarg;     break;
+			case OPT_EVIDENCE: EVIDENCE_FILE = optarg; break;
+			case OPT_SWEEP: SWEEP_FILE = optarg;       break;
+			case OPT_WINDOW_STATS: config.WINDOW_STATS_FILE = optarg; break;
+			case OPT_WINDOW_TIME_BUDGET: config.WINDOW_TIME_BUDGET = atof(optarg); break;
+			case OPT_WINDOW_RETRY: config.WINDOW_RETRY = 1; break;
 			case 'H': PRINT_CONFIG     = 1;            break;
 
 			case 'h': errflg = 1;                      break;
@@ -778,202 +504,126 @@ int main(int argc, char** argv)
 		if (errflg)
 		{
 			//cout << helptext.str();
-			printHelpText(filters);
+			printHelpText(config);
 			exit (EXIT_FAILURE);
 		}
 	}
 
-	// update min base quality values
-	MIN_QUAL_TRIM = MIN_QV_TRIM + QV_RANGE;
-	MIN_QUAL_CALL = MIN_QV_CALL + QV_RANGE;
-
-	if (TUMOR == "") { cerr << "ERROR: Must provide the tumor BAM file (-t)" << endl; ++errflg; }
-	if (NORMAL == "") { cerr << "ERROR: Must provide the normal BAM file (-n)" << endl; ++errflg; }		
-	if (REFFILE == "") { cerr << "ERROR: Must provide a reference genome file (-r)" << endl; ++errflg; }
-	if ( (BEDFILE == "") && (REGION == "") ) { cerr << "ERROR: Must provide region (-p) or BED file (-B)" << endl; ++errflg; }
+	// refilter: VCF of the evidence file of a run under the filter thresholds of the command line
+	if (REFILTER) {
+		if (argc - optind != 1) { cerr << "ERROR: Must provide the evidence file of a run (lancet refilter [filter options] <evidence file>)" << endl; exit(EXIT_FAILURE); }
+		
+		Evidence_t evidence;
+		if (!evidence.read(argv[optind], &config.filters)) { return -1; }
+		
+		if (evidence.active_regions_m && (config.filters.minAltCntTumor < evidence.filters_m.minAltCntTumor)) {
+			cerr << "WARNING: the run selected the active regions with --min-alt-count-tumor " << evidence.filters_m.minAltCntTumor
+				 << ", variants with less support in the regions it skipped are missing" << endl;
+		}
+		
+		// precompute log-factorials for the fisher exact tests
+		FET_t::initLogFactorials(config.filters.maxCovTumor + config.filters.maxCovNormal);
+		
+		cerr << "Export variants to VCF file" << endl;
+		evidence.printVCF(cout, VERSION, config.COMMAND_LINE, config.filters);
+		return 0;
+	}
 
-	if (errflg) { exit(EXIT_FAILURE); }
-	
-	BamReader readerT;
-	// attempt to open the BamReader
-	if ( !readerT.Open(TUMOR) ) {
-		cerr << "Could not open tumor BAM file." << endl;
-		return -1;
+	if (config.TUMOR == "") { cerr << "ERROR: Must provide the tumor BAM file (-t)" << endl; ++errflg; }
+	if (config.NORMAL == "") { cerr << "ERROR: Must provide the normal BAM file (-n)" << endl; ++errflg; }		
+	if (config.REFFILE == "") { cerr << "ERROR: Must provide a reference genome file (-r)" << endl; ++errflg; }
+	if ( !SERVE && !config.GENOME && (BEDFILE == "") && (REGION == "") ) { cerr << "ERROR: Must provide region (-p), BED file (-B) or --genome" << endl; ++errflg; }
+	if ( config.GENOME && ((BEDFILE != "") || (REGION != "")) ) { cerr << "ERROR: --genome can not be used with region (-p) or BED file (-B)" << endl; ++errflg; }
+	if ( !config.GENOME && ((config.CONTIGS != "") || (config.EXCLUDE_CONTIGS != "")) ) { cerr << "ERROR: --contigs and --exclude-contigs require --genome" << endl; ++errflg; }
+	if ( config.RESUME && (config.CHECKPOINT_FILE == "") ) { cerr << "ERROR: Must provide the checkpoint file (-J) to resume a run" << endl; ++errflg; }
+	if (config.WINDOW_TIME_BUDGET < 0) { cerr << "ERROR: --window-time-budget must be positive" << endl; ++errflg; }
+	if ( config.WINDOW_RETRY && (config.WINDOW_TIME_BUDGET <= 0) ) { cerr << "ERROR: --window-retry requires --window-time-budget" << endl; ++errflg; }
+	
+	if (MERGE) {
+		for (int a = optind; a < argc; ++a) { MERGE_FILES.push_back(argv[a]); }
+		if (MERGE_FILES.empty()) { cerr << "ERROR: Must provide the checkpoint files of the shards to merge" << endl; ++errflg; }
+		if (config.NUM_SHARDS > 0) { cerr << "ERROR: --shard can not be used with merge" << endl; ++errflg; }
+		if (config.CHECKPOINT_FILE != "") { cerr << "ERROR: --checkpoint can not be used with merge" << endl; ++errflg; }
+		if (config.WINDOW_STATS_FILE != "") { cerr << "ERROR: --window-stats can not be used with merge" << endl; ++errflg; }
 	}
-	
-	BamReader readerN;
-	// attempt to open the BamReader
-	if ( !readerN.Open(NORMAL) ) {
-		cerr << "Could not open normal BAM file." << endl;
-		return -1;
+
+	if (SERVE) {
+		if ( config.GENOME || (BEDFILE != "") || (REGION != "") ) { cerr << "ERROR: the regions of serve are requested by the clients (no -p, -B or --genome)" << endl; ++errflg; }
+		if ( (config.NUM_SHARDS > 0) || (config.CHECKPOINT_FILE != "") ) { cerr << "ERROR: --shard and --checkpoint can not be used with serve" << endl; ++errflg; }
+		if (EVIDENCE_FILE != "") { cerr << "ERROR: --evidence can not be used with serve" << endl; ++errflg; }
+		if (config.WINDOW_STATS_FILE != "") { cerr << "ERROR: --window-stats can not be used with serve" << endl; ++errflg; }
 	}
 	
-	bool found = (checkPresenceOfMDtag(readerT) || checkPresenceOfMDtag(readerN));	
-	if(!found && ACTIVE_REGIONS) {
-		cerr << endl << "--------WARNING--------" << endl;
-		cerr << "The MD tag is required to select the active regions, but is missing from the alignments in the BAM(s) file(s)." << endl;
-		cerr << "To avoid unpredictable behavior, the active region module has been automatically turned off (--active-region-off)" << endl;
-		cerr << "-----------------------" << endl << endl;
-		
-		ACTIVE_REGIONS = 0; 
+	if (SWEEP_FILE != "") {
+		if (MERGE || SERVE) { cerr << "ERROR: --sweep can not be used with merge or serve" << endl; ++errflg; }
+		if ( (config.NUM_SHARDS > 0) || (config.CHECKPOINT_FILE != "") ) { cerr << "ERROR: --shard and --checkpoint can not be used with --sweep" << endl; ++errflg; }
+		if (EVIDENCE_FILE != "") { cerr << "ERROR: --evidence can not be used with --sweep" << endl; ++errflg; }
+		if (config.WINDOW_STATS_FILE != "") { cerr << "ERROR: --window-stats can not be used with --sweep" << endl; ++errflg; }
+		if (config.WINDOW_TIME_BUDGET > 0) { cerr << "ERROR: --window-time-budget can not be used with --sweep" << endl; ++errflg; }
 	}
+	else if (SOCKET_PATH != "") { cerr << "ERROR: --socket requires serve" << endl; ++errflg; }
 
-	RefVector references = readerT.GetReferenceData(); // Extract all reference sequence entries.
+	if (errflg) { exit(EXIT_FAILURE); }
+	
+	vector<lancet::Config> sweep_configs;
+	vector<string> sweep_outputs;
+	if (SWEEP_FILE != "") { loadSweep(SWEEP_FILE, config, sweep_configs, sweep_outputs); }
+	
+	lancet::Caller caller(config);
+	if (caller.open() != 0) { return -1; }
 	
     ofstream params_file;
 	
 	if(PRINT_CONFIG) {
 		params_file.open ("config.txt");
-		printConfiguration(params_file, filters); // save parameters setting to file
+		printConfiguration(params_file, caller.config_m, REGION, BEDFILE); // save parameters setting to file
 	}
 	
     params_file.close();
-	if(verbose) { printConfiguration(cerr, filters); }
-	
-	// run the assembler on each region
-	try {
-		
-		//Microassembler* driver = new Microassembler();
-		//driver->run(argc, argv);
-		//assembler->vDB.printToVCF();
-
-		pthread_t threads[NUM_THREADS];
-		pthread_attr_t attr;
-		void * status;
-		int rc;
-		int i;		
-		vector<Microassembler*> assemblers(NUM_THREADS, new Microassembler());
-		vector< map<string, Ref_t *> > reftables(NUM_THREADS, map<string, Ref_t *>()); // table of references to analyze
-		
-		if (BEDFILE != "") {
-			loadBed(BEDFILE,reftables,references,NUM_THREADS);
-		}
-		if (REGION != "") {
-			loadRefs(REFFILE,REGION,reftables,references,NUM_THREADS, 0);
+	if(caller.config_m.verbose) { printConfiguration(cerr, caller.config_m, REGION, BEDFILE); }
+	
+	// server mode: one assembler per client served concurrently
+	if (SERVE) {
+		int num_servers = (SOCKET_PATH == "") ? 1 : caller.config_m.NUM_THREADS;
+		vector<Microassembler*> assemblers(num_servers, (Microassembler *)NULL);
+		for (int a = 0; a < num_servers; ++a) {
+			assemblers[a] = new Microassembler();
+			lancet::Caller::configureAssembler(caller.config_m, assemblers[a], &caller.config_m.filters);
+			assemblers[a]->setID(a+1);
 		}
-		
-		cerr << num_windows << " total windows to process" << endl << endl;
-		
-		// Initialize and set thread joinable
-		pthread_attr_init(&attr);
-		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
-
-		for( i=0; i < NUM_THREADS; ++i ) {
-			cerr << "starting thread " << (i+1) << " on " << reftables[i].size() << " windows" << endl;
-		
-			assemblers[i] = new Microassembler();
-
-			assemblers[i]->XA_FILTER = XA_FILTER;
-			assemblers[i]->PRIMARY_ALIGNMENT_ONLY = PRIMARY_ALIGNMENT_ONLY;
-			assemblers[i]->ACTIVE_REGION_MODULE = ACTIVE_REGIONS;
-			assemblers[i]->KMER_RECOVERY = KMER_RECOVERY;
-			assemblers[i]->verbose = verbose;
-			assemblers[i]->VERBOSE = VERBOSE;
-			assemblers[i]->PRINT_DOT_READS = PRINT_DOT_READS;
-			assemblers[i]->PRINT_ALL = PRINT_ALL;
-			assemblers[i]->MIN_QV_CALL = MIN_QV_CALL;
-			assemblers[i]->MIN_QV_TRIM = MIN_QV_TRIM;
-			assemblers[i]->QV_RANGE = QV_RANGE;
-			assemblers[i]->MIN_QUAL_TRIM = MIN_QUAL_TRIM;
-			assemblers[i]->MIN_QUAL_CALL = MIN_QUAL_CALL;
-			assemblers[i]->MIN_MAP_QUAL = MIN_MAP_QUAL;
-			assemblers[i]->TUMOR = TUMOR;
-			assemblers[i]->NORMAL = NORMAL;
-			assemblers[i]->RG_FILE = RG_FILE;
-			assemblers[i]->REFFILE = REFFILE;
-			assemblers[i]->minK = minK;
-			assemblers[i]->maxK = maxK;
-			assemblers[i]->MAX_TIP_LEN = MAX_TIP_LEN;
-			assemblers[i]->MIN_THREAD_READS = MIN_THREAD_READS;
-			assemblers[i]->COV_THRESHOLD = COV_THRESHOLD;
-			assemblers[i]->MIN_COV_RATIO = MIN_COV_RATIO;
-			assemblers[i]->LOW_COV_THRESHOLD = LOW_COV_THRESHOLD;
-			assemblers[i]->MAX_AVG_COV = MAX_AVG_COV;
-			assemblers[i]->NODE_STRLEN = NODE_STRLEN;
-			assemblers[i]->DFS_LIMIT = DFS_LIMIT;
-			assemblers[i]->MAX_INDEL_LEN = MAX_INDEL_LEN;
-			assemblers[i]->MAX_MISMATCH = MAX_MISMATCH;		
-			assemblers[i]->MAX_UNIT_LEN = MAX_UNIT_LEN;
-			assemblers[i]->MIN_REPORT_UNITS = MIN_REPORT_UNITS;
-			assemblers[i]->MIN_REPORT_LEN = MIN_REPORT_LEN;
-			assemblers[i]->DIST_FROM_STR = DIST_FROM_STR;	
-			
-			assemblers[i]->reftable = &reftables[i];
-			assemblers[i]->setFilters(&filters);
-			assemblers[i]->setID(i+1);
+		Server_t server(caller.references_m, &caller.config_m.filters, VERSION, config.REFFILE, config.COMMAND_LINE, config.PADDING, config.WINDOW_SIZE);
+		int rc = server.run(assemblers, SOCKET_PATH);
+		for (int a = 0; a < num_servers; ++a) { delete assemblers[a]; }
+		return rc;
+	}
 	
-			rc = pthread_create(&threads[i], NULL, execute, (void * )assemblers[i]);
-			
-			if (rc){
-				cerr << "Error:unable to create thread," << rc << endl;
-				exit(-1);
-			}
-		}
-		
-		// free attribute and wait for the other threads
-		pthread_attr_destroy(&attr);
-		for( i=0; i < NUM_THREADS; ++i ){
-			rc = pthread_join(threads[i], &status);
-			if (rc){
-				cerr << "Error:unable to join," << rc << endl;
-				exit(-1);
-			}
-			cerr << "Main: completed thread id :" << (i+1) ;
-			cerr << " exiting with status :" << status << endl;
-		}
+	// regions of the run (the windows of genome mode are made by the caller)
+	vector<string> regions;
+	if (BEDFILE != "") { loadBed(BEDFILE, config.PADDING, regions); }
+	if (REGION != "") { regions.push_back(REGION); }
+	
+	// parameter sweep: one VCF per configuration
+	if (SWEEP_FILE != "") {
+		if (caller.sweep(regions, sweep_configs) != 0) { return -1; }
 		
-		int tot_skip = 0;
-		int tot_svn_only = 0;
-		int tot_indel_only = 0;
-		int tot_softclip_only = 0;
-		int tot_indel_or_softclip = 0;
-		int tot_snv_or_indel = 0;
-		int tot_snv_or_softclip = 0;
-		int tot_snv_or_indel_or_softclip = 0;
-		//merge variant from all threads
-		cerr << "Merge variants" << endl;
-		VariantDB_t variantDB; // variants DB
-		variantDB.setCommandLine(COMMAND_LINE);
-		for( i=0; i < NUM_THREADS; ++i ) {
-			
-			tot_skip += assemblers[i]->num_skip;
-			tot_svn_only += assemblers[i]->num_snv_only_regions;
-			tot_indel_only += assemblers[i]->num_indel_only_regions;
-			tot_softclip_only += assemblers[i]->num_softclip_only_regions;
-			tot_indel_or_softclip += assemblers[i]->num_indel_or_softclip_regions;			
-			tot_snv_or_indel += assemblers[i]->num_snv_or_indel_regions;			
-			tot_snv_or_softclip += assemblers[i]->num_snv_or_softclip_regions;
-			tot_snv_or_indel_or_softclip += assemblers[i]->num_snv_or_indel_or_softclip_regions;
-						
-			map<string,Variant_t> db = (assemblers[i]->vDB).DB;
-			map<string,Variant_t>::iterator it;			
-			for (it=db.begin(); it!=db.end(); ++it) {
-				variantDB.addVar(it->second);
-			}
+		cerr << "Export variants to VCF files" << endl;
+		for (unsigned int s = 0; s < sweep_outputs.size(); ++s) {
+			ofstream out(sweep_outputs[s].c_str());
+			if (!out.is_open()) { cerr << "ERROR: could not write " << sweep_outputs[s] << endl; return -1; }
+			caller.printSweepVCF(out, s, VERSION);
 		}
-		
-		//if(verbose) {
-			cerr << "Total # of skipped windows: " << tot_skip << " (" << (100*(double)tot_skip/double(num_windows)) << "\%)" << endl;
-			cerr << "- # of windows with SNVs only: " << tot_svn_only << endl;
-			cerr << "- # of windows with indels only: " << tot_indel_only << endl;
-			cerr << "- # of windows with softclips only: " << tot_softclip_only << endl;
-			cerr << "- # of windows with indels or softclips: " << tot_indel_or_softclip << endl;
-			cerr << "- # of windows with SNVs or indels: " << tot_snv_or_indel << endl;
-			cerr << "- # of windows with SNVs or softclips: " << tot_snv_or_softclip << endl;
-			cerr << "- # of windows with SNVs or indels or softclips: " << tot_snv_or_indel_or_softclip << endl;
-		//}
-		
-		/***** get current time and date *****/
-		time_t rawtime;
-		time (&rawtime);
-		char* DATE = ctime (&rawtime);
-		/***************************************/
-		
-		variantDB.printToVCF(VERSION, REFFILE, DATE, filters, assemblers[0]->sample_name_normal, assemblers[0]->sample_name_tumor);		
+		return 0;
 	}
-	catch (int e) {
-		cerr << "An exception occurred. Exception Nr. " << e << endl;
+	
+	if (MERGE) {
+		if (caller.merge(regions, MERGE_FILES) != 0) { return -1; }
 	}
-
-	pthread_exit(NULL);
+	else if (caller.call(regions) != 0) { return -1; }
+	
+	if ( (EVIDENCE_FILE != "") && !caller.writeEvidence(EVIDENCE_FILE, VERSION) ) { return -1; }
+	
+	cerr << "Export variants to VCF file" << endl;
+	caller.printVCF(cout, VERSION);
+	
+	return 0;
 }
@@ -25,79 +25,23 @@
 *************************** /COPYRIGHT **************************************/
 
 #include "Microassembler.hh"
+#include "Caller.hh"
+#include "Server.hh"
+#include "Evidence.hh"
 
 string VERSION = "1.0.7, July 16 2018";
-string COMMAND_LINE;
 
-/****  configuration parameters ****/
-int NUM_THREADS = 1;
-
-bool XA_FILTER = false;
-bool PRIMARY_ALIGNMENT_ONLY = false;
-bool ACTIVE_REGIONS = true;
-bool verbose = false;
-bool VERBOSE = false;
-bool PRINT_CONFIG = false;
-bool KMER_RECOVERY = false;
-bool PRINT_ALL = false;
-bool PRINT_DOT_READS = true;
-int MIN_QV_TRIM = 10;
-int MIN_QV_CALL = 17;
-int QV_RANGE = '!';
-int MIN_QUAL_TRIM = MIN_QV_TRIM + QV_RANGE;
-int MIN_QUAL_CALL = MIN_QV_CALL + QV_RANGE;
-int MIN_MAP_QUAL = 15;
-int MAX_DELTA_AS_XS = 5;
-int WINDOW_SIZE = 600;
-int PADDING = 250;
-
-string TUMOR;
-string NORMAL;
-string RG_FILE;
-string REFFILE;
-string BEDFILE;
+/****  options of the command line (the calling parameters are in lancet::Config) ****/
 string REGION;
-
-int minK = 11;
-int maxK = 101;
-int MAX_TIP_LEN = minK;
-unsigned int MIN_THREAD_READS = 1;
-int COV_THRESHOLD = 5;
-double MIN_COV_RATIO = 0.01;
-int LOW_COV_THRESHOLD = 1;
-int MAX_AVG_COV = 10000;
-int NODE_STRLEN = 100;
-int DFS_LIMIT = 1000000;
-int MAX_INDEL_LEN = 500;
-int MAX_MISMATCH = 2;
-	
-//STR parameters
-int MAX_UNIT_LEN = 4;
-int MIN_REPORT_UNITS = 3;
-int MIN_REPORT_LEN = 7;
-int DIST_FROM_STR = 1;
-
-bool SCAFFOLD_CONTIGS = 0;
-int INSERT_SIZE = 150;
-int INSERT_STDEV = 15;
-
-int num_windows = 0;
-
-// constants
-//////////////////////////////////////////////////////////////////////////
-
-const char Graph_t::CODE_MAPPED = 'M';
-const char Graph_t::CODE_BASTARD = 'B';
-
-const string Graph_t::COLOR_ALL    = "white"; 
-const string Graph_t::COLOR_LOW    = "grey";
-const string Graph_t::COLOR_NOVO   = "darkorange3";
-const string Graph_t::COLOR_TUMOR  = "red";
-const string Graph_t::COLOR_NORMAL = "green";
-const string Graph_t::COLOR_SHARED = "blue"; //"deepskyblue4";
-const string Graph_t::COLOR_SOURCE = "orange\" style=\"filled";
-const string Graph_t::COLOR_SINK   = "yellow\" style=\"filled";
-const string Graph_t::COLOR_TOUCH  = "magenta";
+string BEDFILE;
+bool PRINT_CONFIG = false;
+bool MERGE = false;
+vector<string> MERGE_FILES;
+bool SERVE = false;
+string SOCKET_PATH; // UNIX socket of the server (stdin/stdout if empty)
+bool REFILTER = false;
+string EVIDENCE_FILE; // candidate variants of the run (not saved if empty)
+string SWEEP_FILE; // configurations of a parameter sweep (no sweep if empty)
 
 /***********************************/
 
@@ -105,18 +49,16 @@ const string Graph_t::COLOR_TOUCH  = "magenta";
 void printUsage();
 
 // print help text to stderr
-void printHelpText(Filters & filters);
+void printHelpText(lancet::Config & config);
 
 // print configuration to file
-void printConfiguration(ostream & out, Filters & filters);
-
-// load referecne for fasta file
-int loadRefs(const string reference, const string region, vector< map<string, Ref_t *> > &reftable, RefVector &bamrefs, int num_threads, int thread);
+void printConfiguration(ostream & out, lancet::Config & config, const string & region, const string & bedfile);
 
-// loadbed : load regions from BED file
-void loadBed(const string bedfile, vector< map<string, Ref_t *> > &reftable, RefVector &bamrefs, int num_threads);
+// loadbed : regions of a BED file
+void loadBed(const string bedfile, int padding, vector<string> &regions);
 
-static void* execute(void* ptr);
+// loadSweep : configurations of a parameter sweep and their output files
+void loadSweep(const string sweepfile, const lancet::Config & base, vector<lancet::Config> & configs, vector<string> & outputs);
 
 int rLancet(string tumor_bam, string normal_bam, string ref_fasta, string reg, string bed_file, int numthreads);
 
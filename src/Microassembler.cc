@@ -23,6 +23,7 @@
 **
 *************************** /COPYRIGHT **************************************/
 
+
 // load Red Groups
 //////////////////////////////////////////////////////////////
 
@@ -47,6 +48,60 @@ void Microassembler::loadRG(const string & filename, int member) {
 	xfclose(fp);
 }
 
+// initReadGroups
+// assign dense ids to the read groups found in the BAM headers and 
+// mark the ones selected for the analysis
+//////////////////////////////////////////////////////////////
+void Microassembler::initReadGroups(SamHeader &headerT, SamHeader &headerN) {
+	
+	ALL_READGROUPS = (readgroups.find("null") != readgroups.end());
+	rg_names.clear();
+	rg_selected.clear();
+	rg_ids.clear();
+	rg_last = -1;
+	
+	if (ALL_READGROUPS) { return; } // no need to resolve read groups
+	
+	SamHeader * headers[2] = { &headerT, &headerN };
+	for (int h = 0; h < 2; ++h) {
+		SamReadGroupDictionary & RGS = headers[h]->ReadGroups;
+		for (SamReadGroupIterator it = RGS.Begin(); it != RGS.End(); ++it) {
+			if (!rg_ids.insert(make_pair(it->ID, (int)rg_names.size())).second) { continue; }
+			rg_names.push_back(it->ID);
+			rg_selected.push_back(readgroups.find(it->ID) != readgroups.end());
+		}
+	}
+	
+	// read groups requested but missing from the headers
+	for (set<string>::iterator it = readgroups.begin(); it != readgroups.end(); ++it) {
+		if (!rg_ids.insert(make_pair(*it, (int)rg_names.size())).second) { continue; }
+		rg_names.push_back(*it);
+		rg_selected.push_back(true);
+	}
+}
+
+// isSelectedRG
+// return true if the read belongs to one of the selected read groups
+//////////////////////////////////////////////////////////////
+bool Microassembler::isSelectedRG(const ReadTags_t & tags) {
+	
+	if (ALL_READGROUPS) { return true; }
+	if (tags.rg == NULL) { return false; }
+	
+	// reads are usually clustered by read group: check the last one first
+	if ( (rg_last >= 0) && (rg_names[rg_last].length() == tags.rg_len) && 
+		 (memcmp(rg_names[rg_last].data(), tags.rg, tags.rg_len) == 0) ) { 
+		return rg_selected[rg_last]; 
+	}
+	
+	rg_key.assign(tags.rg, tags.rg_len);
+	unordered_map<string,int>::const_iterator it = rg_ids.find(rg_key);
+	if (it == rg_ids.end()) { return false; } // read group not in the header
+	
+	rg_last = it->second;
+	return rg_selected[rg_last];
+}
+
 // extract sammple name from SamHeader
 //////////////////////////////////////////////////////////////
 string Microassembler::retriveSampleName(SamHeader &header) {
@@ -68,11 +123,15 @@ string Microassembler::retriveSampleName(SamHeader &header) {
 
 
 // processGraph
+// assemble the reads of the graph with k-mers from minkmer to maxkmer; the
+// reads are cleared at the end only if released
 //////////////////////////////////////////////////////////////////////////
 
-int Microassembler::processGraph(Graph_t & g, const string & refname, int minkmer, int maxkmer)
+int Microassembler::processGraph(Graph_t & g, Ref_t * refinfo, int minkmer, int maxkmer, bool release)
 {	
 	int numreads = 0;
+	const string & refname = refinfo->hdr;
+	expiredK = 0;
 
 	if (refname != "")
 	{
@@ -80,7 +139,7 @@ int Microassembler::processGraph(Graph_t & g, const string & refname, int minkme
 		//VERBOSE = false;
 		
 		// skip region if no mapped reads
-		if(g.countMappedReads()<=0) { return 0; }
+		if(g.countMappedReads()<=0) { g.stats_m.status_m = "no_reads"; return 0; }
 		
 		numreads = g.readid2info.size();
 
@@ -92,21 +151,16 @@ int Microassembler::processGraph(Graph_t & g, const string & refname, int minkme
 			<< endl;
 			cerr << "=====================================================" << endl;
 		}
-		// Load the reference
-		map<string, Ref_t *>::iterator ri = reftable->find(refname);
-		if (ri == reftable->end())
-		{
-			cerr << "Can't find ref info for: " << refname << endl;
-			exit(1);
-		}
-		Ref_t * refinfo = ri->second;
-		
 		bool rptInRef = false;
 		bool rptInQry = false;
 		bool cycleInGraph = false;
 
 		// dinamic kmer mode
 		for (int k=minkmer; k<=maxkmer; k+=2) {
+			
+			// stop if the window is over its time budget
+			if (g.overBudget()) { expiredK = k; break; }
+			
 			g.setK(k);
 			refinfo->setK(k);
 			
@@ -117,6 +171,7 @@ int Microassembler::processGraph(Graph_t & g, const string & refname, int minkme
 			// exit if the region has a repeat of size K
 			if(isRepeat(refinfo->rawseq, k)) { 
 				if(verbose) { cerr << "Repeat in reference sequence for kmer " << k << endl; }
+				g.stats_m.addK(k, "ref_repeat");
 				rptInRef = true;
 				//return; 
 				continue;
@@ -125,13 +180,17 @@ int Microassembler::processGraph(Graph_t & g, const string & refname, int minkme
 			// exit if the region has an almost perfect repeat of size K
 			if(isAlmostRepeat(refinfo->rawseq, k, MAX_MISMATCH)) { 
 				if(verbose) { cerr << "Near-perfect repeat in reference sequence for kmer " << k << endl; }
+				g.stats_m.addK(k, "ref_near_repeat");
 				rptInRef = true;
 				//return; 
 				continue;
 			}
 			
 			//if no repeats in the reference build graph	
+			double start = WindowStats_t::now();
 			g.buildgraph(refinfo);
+			g.countGraph(g.stats_m.nodes_m, g.stats_m.edges_m);
+			if (g.expired_m) { g.stats_m.time_m[PHASE_BUILD] += WindowStats_t::now() - start; expiredK = k; break; }
 			
 			// error correct reads (just singletons)
 			if(KMER_RECOVERY) {
@@ -158,84 +217,28 @@ int Microassembler::processGraph(Graph_t & g, const string & refname, int minkme
 			g.removeLowCov(false, 0);
 			int numcomp = g.markConnectedComponents();
 			//cerr << "Num components = " << numcomp << endl;
+			g.stats_m.time_m[PHASE_BUILD] += WindowStats_t::now() - start;
 			
 			// process each connected components
-			for (int c=1; c<=numcomp; ++c) { 
-				
-				char comp[21]; // enough to hold all numbers up to 64-bits
-				sprintf(comp, "%d", c);
-				
-				if(verbose) { g.printStats(c); }
-				
-				// mark source and sink
-				g.markRefEnds(refinfo, c);
-			
-				if (PRINT_ALL) { g.printDot(out_prefix + ".1l.c" + comp + ".dot", c); }
-			
-				// skip this component (and go to next one) if no tumor specific kmer found
-				//if ( !(g.hasTumorOnlyKmer()) ) { continue; }
-					
-				// if there is a cycle in the graph skip analysis
-				if (g.hasCycle()) { g.clear(false); cycleInGraph = true; break; }
-
-				g.checkReadStarts(c);
-	
-				// Initial compression
-				g.compress(c); 
-				if(verbose) { g.printStats(c); }
-				if (PRINT_ALL) { g.printDot(out_prefix + ".2c.c" + comp + ".dot",c); }
-
-				// Remove low coverage
-				g.removeLowCov(true, c);
-				if (PRINT_ALL) { g.printDot(out_prefix + ".3l.c" + comp + ".dot",c); }
-
-				// Remove tips
-				g.removeTips(c);
-				if (PRINT_ALL) { g.printDot(out_prefix + ".4t.c" + comp + ".dot",c); }
-				
-				// Remove short links (nodes connected by only a few low coverage kmers are likely to be chimeric connections)
-				g.removeShortLinks(c);
-				if (PRINT_ALL) { g.printDot(out_prefix + ".5s.c" + comp + ".dot",c); }
-				
-				// skip analysis if there is a cycle in the graph 
-				if (g.hasCycle()) { g.clear(false); cycleInGraph = true; break; }
-
-				// skip analysis if there is a perfect or near-perfect repeat in the graph paths			
-				if(g.hasRepeatsInGraphPaths(refinfo)) { g.clear(false); rptInQry = true; break; }
-			
-				// Thread reads
-				// BUG: threding is off because creates problems if the the bubble is not covered (end-to-end) 
-				// by the reads. This is particularly problematic for detecting denovo events
-				//g.threadReads(c);
-				//if (PRINT_ALL) { g.printDot(out_prefix + ".4thread.c" + comp + ".dot",c); }
-		
-				// scaffold contigs
-				if (SCAFFOLD_CONTIGS)
-				{
-					g.scaffoldContigs();
-				}
-
-				/*
-				if (PRINT_DENOVO)
-				{
-					g.denovoNodes(out_prefix + ".denovo.fa", refname);
-				}  
-				*/
-
-				//g.markRefNodes();
-				g.countRefPath(out_prefix + ".paths.fa", refname, false);
-				//g.printFasta(prefix + "." + refname + ".nodes.fa");
-
-				if (PRINT_ALL) { g.printDot(out_prefix + ".final.c" + comp + ".dot",c); }					
-			}
+			int status = processComponents(g, refname, numcomp);
+			if (status == COMP_CYCLE)  { g.clear(false); cycleInGraph = true; g.stats_m.addK(k, "cycle"); }
+			if (status == COMP_REPEAT) { g.clear(false); rptInQry = true; g.stats_m.addK(k, "graph_repeat"); }
+			if (status == COMP_TIMEOUT) { g.expired_m = true; expiredK = k; break; }
 			
 			if (rptInQry || cycleInGraph) { continue; }
 			
+			g.stats_m.addK(k, "ok");
+			g.stats_m.status_m = "done";
 			break; // break loop if graph has been processed correctly
 		}
+		if (g.expired_m) {
+			g.stats_m.addK(expiredK, "over_budget");
+			g.stats_m.status_m = "over_budget";
+		}
+		if (g.stats_m.status_m.empty()) { g.stats_m.status_m = "failed"; }
 		
-		// clear graph at the end.
-		g.clear(true);
+		// clear graph at the end (the reads are kept if not released)
+		g.clear(release);
 		
 		if(verbose) {
 			if(rptInRef) { cerr << " Found repeat in reference" << endl; }
@@ -249,6 +252,218 @@ int Microassembler::processGraph(Graph_t & g, const string & refname, int minkme
 }
 
 
+// processComponent
+// assemble a connected component of the graph and call its variants
+//////////////////////////////////////////////////////////////////////////
+
+int Microassembler::processComponent(Graph_t & g, const string & refname, int c)
+{
+	string out_prefix = "./" + refname;
+
+	char comp[21]; // enough to hold all numbers up to 64-bits
+	sprintf(comp, "%d", c);
+	
+	double start = WindowStats_t::now();
+	if(verbose) { g.printStats(c); }
+	
+	// mark source and sink
+	g.markRefEnds(g.ref_m, c);
+
+	if (PRINT_ALL) { g.printDot(out_prefix + ".1l.c" + comp + ".dot", c); }
+
+	// skip this component (and go to next one) if no tumor specific kmer found
+	//if ( !(g.hasTumorOnlyKmer()) ) { continue; }
+		
+	// if there is a cycle in the graph skip analysis
+	if (g.hasCycle()) { g.stats_m.time_m[PHASE_CLEANUP] += WindowStats_t::now() - start; return COMP_CYCLE; }
+
+	g.checkReadStarts(c);
+
+	// Initial compression
+	g.compress(c); 
+	if(verbose) { g.printStats(c); }
+	if (PRINT_ALL) { g.printDot(out_prefix + ".2c.c" + comp + ".dot",c); }
+
+	// Remove low coverage
+	g.removeLowCov(true, c);
+	if (PRINT_ALL) { g.printDot(out_prefix + ".3l.c" + comp + ".dot",c); }
+
+	// Remove tips
+	g.removeTips(c);
+	if (PRINT_ALL) { g.printDot(out_prefix + ".4t.c" + comp + ".dot",c); }
+	
+	// Remove short links (nodes connected by only a few low coverage kmers are likely to be chimeric connections)
+	g.removeShortLinks(c);
+	if (PRINT_ALL) { g.printDot(out_prefix + ".5s.c" + comp + ".dot",c); }
+	
+	// skip analysis if there is a cycle in the graph (only the nodes changed by the cleanup need to be checked)
+	if (g.hasNewCycle()) { g.stats_m.time_m[PHASE_CLEANUP] += WindowStats_t::now() - start; return COMP_CYCLE; }
+
+	// skip analysis if there is a perfect or near-perfect repeat in the graph paths			
+	if(g.hasRepeatsInGraphPaths(g.ref_m)) { g.stats_m.time_m[PHASE_CLEANUP] += WindowStats_t::now() - start; return COMP_REPEAT; }
+	g.stats_m.time_m[PHASE_CLEANUP] += WindowStats_t::now() - start;
+	
+	if (g.overBudget()) { return COMP_TIMEOUT; }
+
+	// Thread reads
+	// BUG: threding is off because creates problems if the the bubble is not covered (end-to-end) 
+	// by the reads. This is particularly problematic for detecting denovo events
+	//g.threadReads(c);
+	//if (PRINT_ALL) { g.printDot(out_prefix + ".4thread.c" + comp + ".dot",c); }
+
+	// scaffold contigs
+	if (SCAFFOLD_CONTIGS)
+	{
+		g.scaffoldContigs();
+	}
+
+	/*
+	if (PRINT_DENOVO)
+	{
+		g.denovoNodes(out_prefix + ".denovo.fa", refname);
+	}  
+	*/
+
+	//g.markRefNodes();
+	g.countRefPath(out_prefix + ".paths.fa", refname, false);
+	//g.printFasta(prefix + "." + refname + ".nodes.fa");
+	if (g.expired_m) { return COMP_TIMEOUT; }
+
+	if (PRINT_ALL) { g.printDot(out_prefix + ".final.c" + comp + ".dot",c); }
+
+	return COMP_OK;
+}
+
+// componentWorker
+// process the components of a window until none is left
+//////////////////////////////////////////////////////////////////////////
+
+static void* componentWorker(void* ptr) {
+
+	ComponentTasks_t * tasks = (ComponentTasks_t *)ptr;
+
+	while (true) {
+		pthread_mutex_lock(&tasks->lock_m);
+		int c = tasks->next_m++;
+		bool skip = (c > tasks->failed_m); // not needed after a failed component
+		pthread_mutex_unlock(&tasks->lock_m);
+
+		if (c >= (int)tasks->comps_m.size()) { break; }
+		if (skip) { continue; }
+
+		int status = tasks->ma_m->processComponent(*(tasks->comps_m[c]), tasks->refname_m, c);
+		tasks->status_m[c] = status;
+
+		if (status != COMP_OK) {
+			pthread_mutex_lock(&tasks->lock_m);
+			if (c < tasks->failed_m) { tasks->failed_m = c; }
+			pthread_mutex_unlock(&tasks->lock_m);
+		}
+	}
+
+	return NULL;
+}
+
+// processComponents
+// process the connected components of the window. When other workers are
+// idle the components are moved to graphs of their own and assembled
+// concurrently; their variants are then merged into the DB in component
+// order, exactly as if they had been processed one after the other.
+//////////////////////////////////////////////////////////////////////////
+
+int Microassembler::processComponents(Graph_t & g, const string & refname, int numcomp)
+{
+	int helpers = 0;
+	if ( (numcomp > 1) && !SCAFFOLD_CONTIGS ) { helpers = acquireSpareThreads(numcomp-1); }
+
+	if (helpers == 0) {
+		for (int c=1; c<=numcomp; c++) {
+			int status = processComponent(g, refname, c);
+			if (status != COMP_OK) { return status; }
+		}
+		return COMP_OK;
+	}
+
+	ComponentTasks_t tasks(this, refname, numcomp);
+	vector< vector<Variant_t> > buffers(numcomp+1);
+
+	for (int c=1; c<=numcomp; c++) {
+		Graph_t * comp = new Graph_t();
+		configureGraph(*comp);
+		comp->setK(g.K);
+		comp->setDFSLimit(g.DFS_LIMIT); // reduced when the window is retried
+		comp->setVariantBuffer(&buffers[c]);
+		comp->setDeadline(g.deadline_m);
+		g.extractComponent(c, *comp);
+		tasks.comps_m[c] = comp;
+	}
+
+	vector<pthread_t> threads(helpers);
+	int started = 0;
+	for (int i=0; i<helpers; i++) {
+		if (pthread_create(&threads[i], NULL, componentWorker, (void *)&tasks) != 0) { break; }
+		started++;
+	}
+	componentWorker((void *)&tasks);
+	for (int i=0; i<started; i++) { pthread_join(threads[i], NULL); }
+
+	releaseSpareThreads(helpers);
+
+	int status = COMP_OK;
+	int last = numcomp;
+	if (tasks.failed_m <= numcomp) {
+		last = tasks.failed_m;
+		status = tasks.status_m[last];
+	}
+
+	// the components are merged in component order, whatever the order the 
+	// helpers finished in: as after the sequential loop, the window reference 
+	// is left with the ends marked by the last component processed (the 
+	// sequence by the last one that found its sink)
+	for (int c=1; c<=last; c++) {
+		for (unsigned int i=0; i<buffers[c].size(); i++) { g.saveVariant(buffers[c][i]); }
+
+		Ref_t * cref = tasks.comps_m[c]->ref_m;
+		if (tasks.comps_m[c]->sink_m != NULL) { g.ref_m->seq = cref->seq; }
+		g.ref_m->trim5 = cref->trim5;
+		g.ref_m->trim3 = cref->trim3;
+	}
+
+	for (int c=1; c<=numcomp; c++) {
+		g.stats_m.add(tasks.comps_m[c]->stats_m);
+		tasks.comps_m[c]->releaseComponent();
+		delete tasks.comps_m[c];
+	}
+
+	return status;
+}
+
+// acquireSpareThreads
+// take up to n of the threads given back by the workers that are done
+//////////////////////////////////////////////////////////////////////////
+
+int Microassembler::acquireSpareThreads(int n)
+{
+	if (spare == NULL) { return 0; }
+	pthread_mutex_lock(&spare->lock_m);
+	int granted = (n < spare->count_m) ? n : spare->count_m;
+	spare->count_m -= granted;
+	pthread_mutex_unlock(&spare->lock_m);
+	return granted;
+}
+
+// releaseSpareThreads
+//////////////////////////////////////////////////////////////////////////
+
+void Microassembler::releaseSpareThreads(int n)
+{
+	if (spare == NULL) { return; }
+	pthread_mutex_lock(&spare->lock_m);
+	spare->count_m += n;
+	pthread_mutex_unlock(&spare->lock_m);
+}
+
+
 // isActiveRegion
 // Examines reads alignments (CIGAR and MD) to find evidence of mutations
 // returns true if there is evidence of mutation in the region
@@ -257,13 +472,11 @@ bool Microassembler::isActiveRegion(BamReader &reader, Ref_t *refinfo, BamRegion
 	// iterate through all alignments
 	int MIN_EVIDENCE = filters->minAltCntTumor; // min evidence equal to min support for somatic variant
 	BamAlignment al;
+	ReadTags_t tags;
 	int totalreadbp = 0;
 	bool ans = false;
-	bool flag = false;
 	int MQ = MIN_MAP_QUAL;
 	string CIGAR = "";
-	string rg = "";
-	string md = "";
 	
 	vector< int > clipSizes;
 	vector< int > readPositions; 
@@ -292,20 +505,18 @@ bool Microassembler::isActiveRegion(BamReader &reader, Ref_t *refinfo, BamRegion
 			
 			if( (al.QueryBases).empty() || (al.Qualities).empty() ) { continue; } // skip alignments with undefined sequence or qualities
 			
-			al.GetTag("RG", rg); // get the read group information for the read
-			if(rg.empty()) { rg = "null"; }
+			parseReadTags(al.TagData, tags, true); // extract RG and MD tags with a single scan of the tag data
 			
 			if( (al.QueryBases).length() != (al.Qualities).length() ) { 
 				cerr << "WARNING: inconsistent length between read sequence (L=" << (al.QueryBases).length() << ") and base qualities (L=" << (al.Qualities).length() << ")" << endl; 
 			}
 			
-			if ( (readgroups.find("null") != readgroups.end())  || (readgroups.find(rg) != readgroups.end()) ) { // select reads in the read group RG
+			if ( isSelectedRG(tags) ) { // select reads in the read group RG
 				
 				// parse MD string
 				// String for mismatching positions. Regex : [0-9]+(([A-Z]|\^[A-Z]+)[0-9]+)*10
-				flag = al.GetTag("MD", md); // get string of mismatching positions
-				//cerr << "MD: " << md << " alstart: " << alstart << " Q: " << al.Qualities << " MinQ " << MIN_QUAL_CALL << endl;
-				if(flag==true) { parseMD(md, mapX, alstart, al.Qualities, MIN_QUAL_CALL); }
+				//cerr << "MD: " << tags.md_str << " alstart: " << alstart << " Q: " << al.Qualities << " MinQ " << MIN_QUAL_CALL << endl;
+				if(tags.md) { parseMD(tags.md_str, mapX, alstart, al.Qualities, MIN_QUAL_CALL); }
 				
 				// add SNV to database
 				//Variant_t(string chr_, int pos_, string ref_, string alt_, int ref_cov_normal_, int ref_cov_tumor_, int alt_cov_normal_fwd_, int alt_cov_normal_rev_, int alt_cov_tumor_fwd_, int alt_cov_tumor_rev_, char prev_bp_ref_, char prev_bp_alt_, Filters &fs)
@@ -440,9 +651,9 @@ bool Microassembler::extractReads(BamReader &reader, Graph_t &g, Ref_t *refinfo,
 		if(code == NML) { cerr << "Extract reads from normal" << endl; }
 	}
 	
-	string sampleType;	
-	if(code == TMR) { sampleType = "tumor";  }
-	if(code == NML) { sampleType = "normal"; }
+	ReadSet_t sampleType = SET_TUMOR;	
+	if(code == TMR) { sampleType = SET_TUMOR;  }
+	if(code == NML) { sampleType = SET_NORMAL; }
 	
 	double CLIP_PRC = 0.5; // percent of soft-clipped bases in alignment
 	//double MAX_PRC_HIGH_CLIP_READS = 30; // max percent of reads with high soft-clipping rate (>CLIP_PRC)
@@ -452,12 +663,7 @@ bool Microassembler::extractReads(BamReader &reader, Graph_t &g, Ref_t *refinfo,
 	// iterate through all alignments
 	//int num_PCR_duplicates = 0;
 	BamAlignment al;
-	string rg = "";
-	string xt = "";	
-	string xa = "";	
-	int nm = 0;
-	float as = -1; 
-	float xs = -1; 
+	ReadTags_t tags;
 	
 	int num_unmapped = 0;
 	int num_XA_read = 0;
@@ -501,6 +707,9 @@ bool Microassembler::extractReads(BamReader &reader, Graph_t &g, Ref_t *refinfo,
 		if ( (al.MapQuality >= MQ) && !al.IsDuplicate() ) { // only keep reads with high map quality and skip PCR duplicates
 			
 			al.BuildCharData(); // Populates alignment string fields (read name, bases, qualities, tag data)
+			
+			// extract all the tags used by the filters below with a single scan of the tag data
+			parseReadTags(al.TagData, tags, false);
 								
 			int mate = 0;
 			int strand = FWD;
@@ -516,10 +725,8 @@ bool Microassembler::extractReads(BamReader &reader, Graph_t &g, Ref_t *refinfo,
 			*/
 			
 			// extract AS and XS tags (available in bwa-mem , not in bwa-aln)
-			as = -1; xs = -1;
-			
-			as = extract_sam_tag("AS", al);
-			xs = extract_sam_tag("XS", al);
+			float as = tags.as;
+			float xs = tags.xs;
 			float delta = abs(as-xs);
 			
 			/*
@@ -532,9 +739,7 @@ bool Microassembler::extractReads(BamReader &reader, Graph_t &g, Ref_t *refinfo,
 			if( (delta <= MIN_DELTA) && as!=-1 && xs!=-1 ) { ++num_equal_AS_XS_read; continue; } // skip alignments where AS and XS are very close
 			
 			// XM	Number of mismatches in the alignment
-			nm = 0;
-			al.GetTag("XM", nm); // get the XM tag for the read
-			if(nm >= MIN_XM) { ++num_high_XM_read; /*continue;*/ } // skip alignments with too many mis-matches
+			if(tags.xm >= MIN_XM) { ++num_high_XM_read; /*continue;*/ } // skip alignments with too many mis-matches
 			
 			// XT type: Unique/Repeat/N/Mate-sw
 			//
@@ -544,16 +749,13 @@ bool Microassembler::extractReads(BamReader &reader, Graph_t &g, Ref_t *refinfo,
 			// Nonetheless, the mapping quality is not necessarily zero. When its mate can be mapped unambiguously, 
 			// the read can still be mapped confidently and thus assigned a high mapQ.
 			// MapQ is computed for the read pair. XT is determined from a single read.
-			xt = "";
-			al.GetTag("XT", xt); // get the XT tag for the read
-			if(xt.empty()) { xt = "null"; }
-			if(xt == "R") { 
+			if(tags.xt == 'R') { 
 				++num_XT_R_read; 
 				if (code != NML) { // keep all reads in the normal, apply repeat filter only to tumor
 					continue; // skip alignments which are marked XT:R
 				}
 			}
-			if(xt == "M") { 
+			if(tags.xt == 'M') { 
 				++num_XT_M_read; 
 				//if (code != NML) { // keep all reads in the normal, apply repeat filter only to tumor
 					/*continue;*/  // skip alignments which are marked XT:M
@@ -563,11 +765,7 @@ bool Microassembler::extractReads(BamReader &reader, Graph_t &g, Ref_t *refinfo,
 			// XA
 			// -- BWA (Illumina): alternative hits; format: (chr,pos,CIGAR,NM;)
 			// -- tmap (Ion Torrent): stores the algorithm that produced this mapping and from what stage. The format is the algorithm name, and then the zero-based stage, separated by a dash.
-			xa = "";
-			al.GetTag("XA", xa); // get the XA for the read
-			if(xa.empty()) { xa = "null"; }
-			if(xa != "null") {
-				//cerr << al.Name << "\t" << xa << endl;
+			if(tags.xa) {
 				++num_XA_read; 
 				if (code != NML && XA_FILTER) { // keep all reads in the normal, apply repeat filter only to tumor
 					continue; // skip alignments with alternative hits
@@ -591,11 +789,7 @@ bool Microassembler::extractReads(BamReader &reader, Graph_t &g, Ref_t *refinfo,
 				if(prc_sc >= CLIP_PRC) { ++num_high_softclip_read; /*break;*/ }
 			}
 									
-			rg = "";
-			al.GetTag("RG", rg); // get the read group information for the read
-			if(rg.empty()) { rg = "null"; }
-			
-			if ( (readgroups.find("null") != readgroups.end())  || (readgroups.find(rg) != readgroups.end()) ) { // select reads in the read group RG
+			if ( isSelectedRG(tags) ) { // select reads in the read group RG
 				
 				if( !(al.IsMapped()) ) { // unmapped read
 					g.addAlignment(sampleType, al.Name, al.QueryBases, al.Qualities, mate, Graph_t::CODE_BASTARD, code, strand);
@@ -636,6 +830,126 @@ bool Microassembler::extractReads(BamReader &reader, Graph_t &g, Ref_t *refinfo,
 	return skip;
 }
 
+// configureGraph
+// set the configuration parameters of a graph
+//////////////////////////////////////////////////////////////////////////
+
+void Microassembler::configureGraph(Graph_t & g)
+{
+	g.setDB(vDB);
+	g.setVerbose(verbose);
+	g.setMoreVerbose(VERBOSE);
+	g.setMinQualTrim(MIN_QUAL_TRIM);
+	g.setMinQualCall(MIN_QUAL_CALL);
+	g.setBufferSize(BUFFER_SIZE);
+	g.setDFSLimit(DFS_LIMIT);
+	g.setCovThreshold(COV_THRESHOLD);
+	g.setMinCovRatio(MIN_COV_RATIO);
+	g.setLowCovThreshold(LOW_COV_THRESHOLD);
+	g.setPrintDotReads(PRINT_DOT_READS);
+	g.setNodeStrlen(NODE_STRLEN);
+	g.setMaxTipLength(MAX_TIP_LEN);
+	g.setMaxIndelLen(MAX_INDEL_LEN);
+	g.setMinThreadReads(MIN_THREAD_READS);
+	g.setScaffoldContigs(SCAFFOLD_CONTIGS);
+	g.setInsertSize(INSERT_SIZE);
+	g.setInsertStdev(INSERT_STDEV);
+	g.setMaxMismatch(MAX_MISMATCH);
+	g.setFilters(filters);
+	
+	// set STR params
+	g.setMaxUnitLen(MAX_UNIT_LEN);
+	g.setMinReportUnits(MIN_REPORT_UNITS);
+	g.setMinReportLen(MIN_REPORT_LEN);
+	g.setDistFromStr(DIST_FROM_STR);
+}
+
+// nextWindow
+// next window to analyze: from the shared queue if the windows are 
+// scheduled, otherwise from the reference table of the thread; then the
+// windows of the thread that ran out of time and are retried
+//////////////////////////////////////////////////////////////////////////
+Ref_t * Microassembler::nextWindow(map<string, Ref_t *>::iterator & ri)
+{
+	// windows of the queue and retried windows are materialized one at a time
+	if (window_m != NULL) { window_m->clear(); delete window_m; window_m = NULL; }
+	
+	if (!retrying_m) {
+		firstK_m = minK;
+		if (queue != NULL) {
+			window_m = queue->next(minK);
+			if (window_m != NULL) { return window_m; }
+		}
+		else if (ri != reftable->end()) { return (ri++)->second; }
+		
+		// all the windows were handed out: continue with the windows to retry
+		retrying_m = true;
+	}
+	
+	if (retry_m.empty()) { return NULL; }
+	
+	const RetryWindow_t & retry = retry_m.back();
+	window_m = new Ref_t(retry.minK);
+	window_m->refchr = retry.refchr;
+	window_m->refstart = retry.refstart;
+	window_m->refend = retry.refend;
+	window_m->setHdr(retry.hdr);
+	window_m->setSeq(retry.seq);
+	window_m->setRawSeq(retry.seq);
+	firstK_m = retry.minK;
+	retry_m.pop_back();
+	
+	return window_m;
+}
+
+// completeWindow
+// add the variants buffered for the window (with a checkpoint or a time
+// budget) to the DB and journal the window as completed; a window over
+// its time budget has no variants and is journaled as such, so that a 
+// resumed run analyzes it again
+//////////////////////////////////////////////////////////////////////////
+void Microassembler::completeWindow(const string & window, vector<Variant_t> & vars, bool expired)
+{
+	if (expired) {
+		vars.clear();
+		if (checkpoint != NULL) { checkpoint->expireWindow(window); }
+		return;
+	}
+	
+	for (unsigned int i=0; i<vars.size(); i++) { vDB->addVar(vars[i]); }
+	if (checkpoint != NULL) { checkpoint->commitWindow(window, vars); }
+	vars.clear();
+}
+
+// countReads
+// count the reads of the window in its statistics
+//////////////////////////////////////////////////////////////////////////
+void Microassembler::countReads(Graph_t & g)
+{
+	for (unsigned int i = 0; i < g.readid2info.size(); ++i) {
+		const ReadInfo_t & ri = g.readid2info[i];
+		if (ri.set_m == SET_TUMOR) { ++g.stats_m.reads_tumor_m; }
+		else if (ri.set_m == SET_NORMAL) { ++g.stats_m.reads_normal_m; }
+		else { continue; }
+		g.stats_m.readbp_m += ri.len_m;
+	}
+}
+
+// logWindow
+// buffer the statistics record of a window (start is the time the window
+// was taken) and write the buffer once it is full
+//////////////////////////////////////////////////////////////////////////
+void Microassembler::logWindow(const WindowStats_t & stats, double start)
+{
+	if (statslog == NULL) { return; }
+	
+	stats.print(statsbuf_m, ID, WindowStats_t::now() - start);
+	if (statsbuf_m.size() >= WINDOW_STATS_BUFFER) {
+		statslog->write(statsbuf_m);
+		statsbuf_m.clear();
+	}
+}
+
 // extract the reads from BAMs and process them
 int Microassembler::processReads() {
 	
@@ -645,50 +959,63 @@ int Microassembler::processReads() {
 	
 	cerr << "Process reads" << endl;
 	
-	// Process the reads
-	BamReader readerT;
-	SamHeader headerT;
+	if (openInputs() != 0) { return -1; }
+	
+	int rc = processWindows();
+	
+	closeInputs();
+	
+	clock_gettime(CLOCK_MONOTONIC, &finish);
+	elapsed = (finish.tv_sec - start.tv_sec);
+	elapsed += (finish.tv_nsec - start.tv_nsec) / 1000000000.0;
+	cerr << "Thread " << ID << " elapsed time:" << elapsed << " seconds" << endl;
+	
+	return rc;
+}
 
-	BamReader readerN;	
-	SamHeader headerN;
+// openInputs
+// open the tumor and normal BAMs with their indices, the read groups and
+// (with the shared queue) the index of the reference
+//////////////////////////////////////////////////////////////////////////
+int Microassembler::openInputs() {
 	
 	string index_filename;
 	bool index_found = false;
 		
 	// attempt to open our BamMultiReader
-	if ( !readerT.Open(TUMOR) ) {
+	if ( !readerT_m.Open(TUMOR) ) {
 		cerr << "Could not open tumor BAM files." << endl;
 		return -1;
 	}
 	// retrieve 'metadata' from BAM files, these are required by BamWriter
-	headerT = readerT.GetHeader();
+	SamHeader headerT = readerT_m.GetHeader();
 	
-	index_found = readerT.LocateIndex(); // locate and load BAM index file (.bam.bai)
+	index_found = readerT_m.LocateIndex(); // locate and load BAM index file (.bam.bai)
 	if(!index_found) {
 		index_filename = GetBaseFilename(TUMOR.c_str())+".bai";
-		index_found = readerT.OpenIndex(index_filename); //try with different extension .bai
+		index_found = readerT_m.OpenIndex(index_filename); //try with different extension .bai
 		if(!index_found) {
 			cerr << "ERROR: index not found for BAM file " << TUMOR << endl;
-			exit(1);
+			return -1;
 		}
 	}
 	
 	sample_name_tumor = retriveSampleName(headerT); // extract tumor sample name 
 
-	if ( !readerN.Open(NORMAL) ) {
+	if ( !readerN_m.Open(NORMAL) ) {
 		cerr << "Could not open normal BAM files." << endl;
 		return -1;
 	}
 	// retrieve 'metadata' from BAM files, these are required by BamWriter
-	headerN = readerN.GetHeader();
+	SamHeader headerN = readerN_m.GetHeader();
 	
-	index_found = readerN.LocateIndex(); // locate and load BAM index file (.bam.bai)
+	index_found = readerN_m.LocateIndex(); // locate and load BAM index file (.bam.bai)
 	if(!index_found) {
 		index_filename = GetBaseFilename(NORMAL.c_str())+".bai";		
-		index_found = readerN.OpenIndex(index_filename); //try with different extension .bai
+		index_found = readerN_m.OpenIndex(index_filename); //try with different extension .bai
 		if(!index_found) {
 			cerr << "ERROR: index not found for BAM file " << NORMAL << endl;
-			exit(1);
+			return -1;
 		}
 	}
 	
@@ -701,37 +1028,60 @@ int Microassembler::processReads() {
 	else {
 		readgroups.insert("null");
 	}
+	initReadGroups(headerT, headerN);
+	
+	// the assemblers of the sweep test the reads of the same read groups
+	for (unsigned int s = 0; s < sweep_m.size(); ++s) {
+		Microassembler * ma = sweep_m[s];
+		ma->readgroups = readgroups;
+		ma->ALL_READGROUPS = ALL_READGROUPS;
+		ma->rg_names = rg_names;
+		ma->rg_selected = rg_selected;
+		ma->rg_ids = rg_ids;
+		ma->rg_last = -1;
+	}
+	
+	// with the shared queue the sequence of each window is loaded when needed
+	if (queue != NULL) {
+		fai_m = fai_load(REFFILE.c_str());
+		if (fai_m == NULL) { 
+			cerr << "Could not load fai index of " << REFFILE << endl;
+			return -1;
+		}
+	}
+	
+	return 0;
+}
+
+// closeInputs
+//////////////////////////////////////////////////////////////////////////
+void Microassembler::closeInputs() {
+	
+	if (fai_m != NULL) { fai_destroy(fai_m); fai_m = NULL; }
+	
+	readerT_m.Close();
+	readerN_m.Close();
+}
 
+// processWindows
+// analyze the windows of the reference table or of the queue (the inputs 
+// must be open)
+//////////////////////////////////////////////////////////////////////////
+int Microassembler::processWindows() {
+	
 	Graph_t g;
 
 	//set configuration parameters
-	g.setDB(&vDB);
+	configureGraph(g);
 	g.setK(minK);
-	g.setVerbose(verbose);
-	g.setMoreVerbose(VERBOSE);
-	g.setMinQualTrim(MIN_QUAL_TRIM);
-	g.setMinQualCall(MIN_QUAL_CALL);
-	g.setBufferSize(BUFFER_SIZE);
-	g.setDFSLimit(DFS_LIMIT);
-	g.setCovThreshold(COV_THRESHOLD);
-	g.setMinCovRatio(MIN_COV_RATIO);
-	g.setLowCovThreshold(LOW_COV_THRESHOLD);
-	g.setPrintDotReads(PRINT_DOT_READS);
-	g.setNodeStrlen(NODE_STRLEN);
-	g.setMaxTipLength(MAX_TIP_LEN);
-	g.setMaxIndelLen(MAX_INDEL_LEN);
-	g.setMinThreadReads(MIN_THREAD_READS);
-	g.setScaffoldContigs(SCAFFOLD_CONTIGS);
-	g.setInsertSize(INSERT_SIZE);
-	g.setInsertStdev(INSERT_STDEV);
-	g.setMaxMismatch(MAX_MISMATCH);
-	g.setFilters(filters);
-	
-	// set STR params
-	g.setMaxUnitLen(MAX_UNIT_LEN);
-	g.setMinReportUnits(MIN_REPORT_UNITS);
-	g.setMinReportLen(MIN_REPORT_LEN);
-	g.setDistFromStr(DIST_FROM_STR);
+
+	// with a checkpoint or a time budget the variants of a window are buffered 
+	// until the window is completed (journaled, or discarded if over budget)
+	vector<Variant_t> windowvars;
+	if ( (checkpoint != NULL) || (WINDOW_TIME_BUDGET > 0) ) { g.setVariantBuffer(&windowvars); }
+
+	// windows taken from the queue are released by nextWindow, not by the graph
+	if (queue != NULL) { g.setOwnRef(false); }
 
 	string graphref = "";
 
@@ -748,101 +1098,208 @@ int Microassembler::processReads() {
 	double progress;
 	double old_progress = 0;
 	
-	/*
-    ofstream ofile;
-	stringstream filename;
-	filename << "elapsedtime.bywindow." << ID << ".txt";
-    ofile.open(filename.str());
-	*/
+	// windows over the time budget are retried with a ten times smaller 
+	// search limit, starting from the k-mer size after the one that ran out of time
+	int retry_dfs_limit = (DFS_LIMIT > 10) ? DFS_LIMIT/10 : DFS_LIMIT;
+	retry_m.clear();
+	retrying_m = false;
 	
-	for ( ri=reftable->begin() ; ri != reftable->end(); ++ri ) {
+	if (queue == NULL) { ri = reftable->begin(); }
+	Ref_t * refinfo = NULL;
+	while ( (refinfo = nextWindow(ri)) != NULL ) {
 
-		/*
-		struct timespec wstart, wfinish;
-		double welapsed;
-		clock_gettime(CLOCK_MONOTONIC, &wstart);
-		*/
+		double wstart = WindowStats_t::now(); // the window was taken
 		
-		++counter;
-		progress = floor(100*(double(counter)/(double)reftable->size()));
-		if (progress > old_progress) {
-			cerr << "Thread " << ID << " is " << progress << "\% done." << endl;
-			old_progress = progress;
+		if (retrying_m) { 
+			g.setOwnRef(false); // retried windows are released by nextWindow
+			g.setDFSLimit(retry_dfs_limit);
+		}
+		else {
+			++counter;
+			if (queue != NULL) { progress = floor(100*(double(queue->taken())/(double)queue->size())); }
+			else { progress = floor(100*(double(counter)/(double)reftable->size())); }
+			if (PRINT_PROGRESS && (progress > old_progress)) {
+				cerr << "Thread " << ID << " is " << progress << "\% done." << endl;
+				old_progress = progress;
+			}
 		}
 			
-		graphref = (*ri).first;
+		graphref = refinfo->hdr;
 		//cout << graphref << endl;
-		Ref_t * refinfo = (*ri).second;
+		
+		// continue if the window was completed by a previous run
+		if ( (checkpoint != NULL) && checkpoint->isDone(graphref) ) { continue; }
+		
+		if ( (fai_m != NULL) && !refinfo->loadSeq(fai_m) ) { continue; }
+		
+		g.stats_m.clear(graphref);
+		g.setDeadline((WINDOW_TIME_BUDGET > 0) ? wstart + WINDOW_TIME_BUDGET : 0);
 			
 		// continue if the region has only Ns or prefect repeat of size maxK
-		if(isNseq(refinfo->rawseq)) { continue; } 
-		if(isRepeat(refinfo->rawseq, maxK)) { continue; } 
+		if(isNseq(refinfo->rawseq)) { g.stats_m.status_m = "only_n"; logWindow(g.stats_m, wstart); completeWindow(graphref, windowvars); continue; } 
+		if(sweep_m.empty() && isRepeat(refinfo->rawseq, maxK)) { g.stats_m.status_m = "ref_repeat"; logWindow(g.stats_m, wstart); completeWindow(graphref, windowvars); continue; } 
 
-		region.LeftRefID = readerT.GetReferenceID(refinfo->refchr); // atoi((refinfo->refchr).c_str());
-		region.RightRefID = readerT.GetReferenceID(refinfo->refchr); // atoi((refinfo->refchr).c_str());
+		region.LeftRefID = readerT_m.GetReferenceID(refinfo->refchr); // atoi((refinfo->refchr).c_str());
+		region.RightRefID = readerT_m.GetReferenceID(refinfo->refchr); // atoi((refinfo->refchr).c_str());
 		region.LeftPosition = refinfo->refstart;
 		region.RightPosition = refinfo->refend;
 		//cout << "region = " << refinfo->refchr << ":" << refinfo->refstart << "-" << refinfo->refend << endl; 
 
-		bool jumpT = readerT.SetRegion(region);
+		bool jumpT = readerT_m.SetRegion(region);
 		if(!jumpT) {
 			cerr << "Error: not able to jump successfully to the region's left boundary in tumor" << endl;
 			return -1;
 		}
 
-		bool jumpN = readerN.SetRegion(region);
+		bool jumpN = readerN_m.SetRegion(region);
 		if(!jumpN) {
 			cerr << "Error: not able to jump successfully to the region's left boundary in normal" << endl;
 			return -1;
 		}
 		
+		// parameter sweep: the window is analyzed by all the configurations
+		if (!sweep_m.empty()) {
+			sweepWindow(g, refinfo, region, readcnt);
+			completeWindow(graphref, windowvars);
+			continue;
+		}
+		
 		bool activeT = true;
 		bool activeN = true;
 		
 		if (ACTIVE_REGION_MODULE) {
-			activeT = isActiveRegion(readerT, refinfo, region, TMR);
-			activeN = isActiveRegion(readerN, refinfo, region, NML);
+			double start = WindowStats_t::now();
+			activeT = isActiveRegion(readerT_m, refinfo, region, TMR);
+			activeN = isActiveRegion(readerN_m, refinfo, region, NML);
+			g.stats_m.time_m[PHASE_ACTIVE] = WindowStats_t::now() - start;
 		}
 		
 		if(activeT || activeN){
 			
-			readerT.SetRegion(region); // safe to jump back: errors would have been detected in the previous call to jump
-			readerN.SetRegion(region); // safe to jump back: errors would have been detected in the previous call to jump
+			readerT_m.SetRegion(region); // safe to jump back: errors would have been detected in the previous call to jump
+			readerN_m.SetRegion(region); // safe to jump back: errors would have been detected in the previous call to jump
 			
-			bool skipT = extractReads(readerT, g, refinfo, region, readcnt, TMR);
-			bool skipN = extractReads(readerN, g, refinfo, region, readcnt, NML);
+			double start = WindowStats_t::now();
+			bool skipT = extractReads(readerT_m, g, refinfo, region, readcnt, TMR);
+			bool skipN = extractReads(readerN_m, g, refinfo, region, readcnt, NML);
+			g.stats_m.time_m[PHASE_EXTRACT] = WindowStats_t::now() - start;
+			if (statslog != NULL) { countReads(g); }
 			
 			if(!skipT && !skipN) { 
-				//numreads_g = processGraph(g, graphref, minK, maxK);
-				processGraph(g, graphref, minK, maxK);
+				// the window may be released by the graph: keep what a retry needs
+				RetryWindow_t retry;
+				if (WINDOW_RETRY && !retrying_m) {
+					retry.hdr = refinfo->hdr;
+					retry.refchr = refinfo->refchr;
+					retry.refstart = refinfo->refstart;
+					retry.refend = refinfo->refend;
+					retry.seq = refinfo->rawseq;
+				}
 				
+				//numreads_g = processGraph(g, refinfo, minK, maxK);
+				processGraph(g, refinfo, firstK_m, maxK, true);
+				
+				if (g.expired_m) {
+					windowvars.clear(); // variants of the unfinished analysis
+					
+					retry.minK = expiredK + 2;
+					if (WINDOW_RETRY && !retrying_m && (retry.minK <= maxK)) {
+						retry_m.push_back(retry);
+						logWindow(g.stats_m, wstart);
+						continue; // completed by the retry
+					}
+					
+					++num_skip;
+					cerr << "WARNING: Skip region " << graphref << ". Over the time budget (" << WINDOW_TIME_BUDGET << "s)." << endl;
+				}
 			}
-			else { ++num_skip; g.clear(true); }
+			else { ++num_skip; g.clear(true); g.stats_m.status_m = "high_coverage"; }
 		}
 		else {
 			++num_skip;
+			g.stats_m.status_m = "inactive";
 			if(verbose) { cerr << "Skip region: not enough evidence for variation." << endl; }
 		}
 		
-		/*
-		clock_gettime(CLOCK_MONOTONIC, &wfinish);
-		welapsed = (wfinish.tv_sec - wstart.tv_sec);
-		welapsed += (wfinish.tv_nsec - wstart.tv_nsec) / 1000000000.0;
-		ofile << welapsed << "\t" << refinfo->refchr << ":" << refinfo->refstart << "-" << refinfo->refend << "\t" << numreads_g << endl;
-		*/
+		if (retrying_m) { g.stats_m.status_m.insert(0, "retry_"); }
+		logWindow(g.stats_m, wstart);
+		completeWindow(graphref, windowvars, g.expired_m);
 	}
-	//ofile.close();
 	
-	readerT.Close();
-	readerN.Close();
+	// write the last statistics records of the thread
+	if (statslog != NULL) { statslog->write(statsbuf_m); statsbuf_m.clear(); }
 	
-	clock_gettime(CLOCK_MONOTONIC, &finish);
-	elapsed = (finish.tv_sec - start.tv_sec);
-	elapsed += (finish.tv_nsec - start.tv_nsec) / 1000000000.0;
-	cerr << "Thread " << ID << " elapsed time:" << elapsed << " seconds" << endl;
-		
 	if(verbose) cerr << "=======" << endl;
-	if(verbose) cerr << "total reads: " << readcnt << " pairs: " << paircnt << " total graphs: " << graphcnt << " ref sequences: " << reftable->size() <<  endl;
+	if(verbose) cerr << "total reads: " << readcnt << " pairs: " << paircnt << " total graphs: " << graphcnt << " ref sequences: " << ((queue != NULL) ? queue->size() : reftable->size()) <<  endl;
 	
 	return 0;
 }
+
+// sweepWindow
+// analyze a window with every configuration of a parameter sweep: the
+// reads are extracted from the BAMs once and assembled by each
+// configuration, after trimming them again if its quality threshold is
+// different. The active region test is repeated only for configurations
+// with different thresholds (min base quality and min alternative count).
+//////////////////////////////////////////////////////////////////////////
+void Microassembler::sweepWindow(Graph_t & g, Ref_t * refinfo, BamRegion & region, int & readcnt)
+{
+	map< pair<int,int>, bool > active; // (min base quality, min alt count) -> active window
+	bool extracted = false;
+	bool skip = false;
+	int trimqual = 0; // quality threshold the reads were trimmed with
+	
+	// marking the reference ends trims the window reference: every
+	// configuration starts from the untrimmed one
+	const string refseq = refinfo->seq;
+	const unsigned short reftrim5 = refinfo->trim5;
+	const unsigned short reftrim3 = refinfo->trim3;
+	
+	for (unsigned int s = 0; s < sweep_m.size(); ++s) {
+		Microassembler * ma = sweep_m[s];
+		
+		if(isRepeat(refinfo->rawseq, ma->maxK)) { continue; }
+		
+		bool isactive = true;
+		if (ma->ACTIVE_REGION_MODULE) {
+			pair<int,int> key(ma->MIN_QUAL_CALL, ma->filters->minAltCntTumor);
+			map< pair<int,int>, bool >::iterator it = active.find(key);
+			if (it == active.end()) {
+				readerT_m.SetRegion(region);
+				bool activeT = ma->isActiveRegion(readerT_m, refinfo, region, TMR);
+				readerN_m.SetRegion(region);
+				bool activeN = ma->isActiveRegion(readerN_m, refinfo, region, NML);
+				it = active.insert(make_pair(key, activeT || activeN)).first;
+			}
+			isactive = it->second;
+		}
+		if (!isactive) {
+			++ma->num_skip;
+			if(verbose) { cerr << "Skip region: not enough evidence for variation." << endl; }
+			continue;
+		}
+		
+		if (!extracted) {
+			readerT_m.SetRegion(region);
+			readerN_m.SetRegion(region);
+			trimqual = g.MIN_QUAL_TRIM;
+			bool skipT = extractReads(readerT_m, g, refinfo, region, readcnt, TMR);
+			bool skipN = extractReads(readerN_m, g, refinfo, region, readcnt, NML);
+			skip = skipT || skipN;
+			extracted = true;
+		}
+		if (skip) { ++ma->num_skip; continue; }
+		
+		ma->configureGraph(g);
+		if (ma->MIN_QUAL_TRIM != trimqual) {
+			g.retrim();
+			trimqual = ma->MIN_QUAL_TRIM;
+		}
+		refinfo->seq = refseq;
+		refinfo->trim5 = reftrim5;
+		refinfo->trim3 = reftrim3;
+		ma->processGraph(g, refinfo, ma->minK, ma->maxK, false);
+	}
+	
+	g.clear(true);
+}
@@ -30,6 +30,7 @@
 #include <iostream>
 #include <fstream>
 #include <map>
+#include <unordered_map>
 #include <set>
 #include <assert.h>
 #include <cmath>
@@ -60,6 +61,9 @@
 #include "Graph.hh"
 #include "VariantDB.hh"
 #include "ErrorCorrector.hh"
+#include "Checkpoint.hh"
+#include "Scheduler.hh"
+#include "WindowStats.hh"
 
 using namespace std;
 using namespace HASHMAP;
@@ -67,6 +71,43 @@ using namespace BamTools;
 
 #define bvalue(value) ((value ? "true" : "false"))
 
+// outcome of the analysis of a connected component
+#define COMP_OK     0
+#define COMP_CYCLE  1 // cycle in the graph
+#define COMP_REPEAT 2 // near-perfect repeat in the graph paths
+#define COMP_TIMEOUT 3 // the window ran out of its time budget
+
+// SpareThreads_t
+// threads released by the workers of a run that are done with their 
+// windows, borrowed to assemble the components of a window in parallel
+//////////////////////////////////////////////////////////////////////////
+
+class SpareThreads_t {
+
+public:
+
+	pthread_mutex_t lock_m;
+	int count_m; // threads available
+
+	SpareThreads_t() : count_m(0) { pthread_mutex_init(&lock_m, NULL); }
+	~SpareThreads_t() { pthread_mutex_destroy(&lock_m); }
+};
+
+// RetryWindow_t
+// window that ran out of its time budget, analyzed again with a coarser
+// setting once the other windows of the thread are done
+//////////////////////////////////////////////////////////////////////////
+
+struct RetryWindow_t
+{
+	string hdr;
+	string refchr;
+	int refstart;
+	int refend;
+	string seq; // reference sequence of the window
+	int minK; // first k-mer size of the retry (after the one that ran out of time)
+};
+
 class Microassembler {
 
 public:
@@ -83,6 +124,7 @@ public:
 	bool PRINT_DOT_READS;
 	bool KMER_RECOVERY;
 	bool PRINT_ALL;
+	bool PRINT_PROGRESS; // report the progress of the thread on its windows
 
 	int MIN_QV_CALL;
 	int MIN_QV_TRIM;
@@ -127,6 +169,9 @@ public:
 	int DFS_LIMIT;
 	int MAX_INDEL_LEN;
 	int MAX_MISMATCH;
+	
+	double WINDOW_TIME_BUDGET; // seconds allowed for the analysis of a window (0 = no budget)
+	bool WINDOW_RETRY; // analyze again the windows over budget with a coarser setting
 		
 	Filters * filters; // filter thresholds
 	
@@ -139,13 +184,27 @@ public:
 	int graphCnt;
 	int num_skip; // number of regions/windows skipped 
 	set<string> readgroups;
+	vector<string> rg_names; // read groups from the BAM headers (index is the read group id)
+	vector<bool> rg_selected; // selected read groups by id
+	unordered_map<string,int> rg_ids; // read group name to id
+	string rg_key; // read group of the current read (reused to look up rg_ids)
+	bool ALL_READGROUPS; // true if reads from all read groups are selected
+	int rg_last; // id of the last resolved read group
 	set<string> RG_father;
 	set<string> RG_mother;
 	set<string> RG_self;
 	set<string> RG_sibling;
 	
 	map<string, Ref_t *> * reftable; // table of references to analyze
-	VariantDB_t vDB; // variants DB
+	WindowQueue_t * queue; // windows shared by all threads (NULL if windows are assigned to threads)
+	Ref_t * window_m; // window taken from the queue
+	BamReader readerT_m; // tumor BAM (open between openInputs and closeInputs)
+	BamReader readerN_m; // normal BAM
+	faidx_t * fai_m; // index of the reference (with the shared queue)
+	VariantDB_t * vDB; // variants DB (shared by all threads)
+	Checkpoint_t * checkpoint; // journal of the completed windows (shared by all threads, NULL if disabled)
+	WindowStatsLog_t * statslog; // per-window statistics (shared by all threads, NULL if disabled)
+	string statsbuf_m; // statistics records of the thread not written yet
 	
 	int num_snv_only_regions;
 	int num_indel_only_regions;
@@ -155,9 +214,23 @@ public:
 	int num_snv_or_softclip_regions;
 	int num_snv_or_indel_or_softclip_regions;
 	
+	SpareThreads_t * spare; // threads of the run available to assemble components (NULL if none)
+	vector<Microassembler *> sweep_m; // assemblers of the configurations of a parameter sweep (empty if none)
+	vector<RetryWindow_t> retry_m; // windows of the thread to analyze again
+	bool retrying_m; // the windows handed out are retries
+	int expiredK; // k-mer size being assembled when the last window ran out of time (0 if it did not)
+	int firstK_m; // first k-mer size of the window handed out by nextWindow
+	
 	Microassembler() { 
 		graphCnt = 0;
 		num_skip = 0;
+		vDB = NULL;
+		checkpoint = NULL;
+		statslog = NULL;
+		queue = NULL;
+		window_m = NULL;
+		fai_m = NULL;
+		spare = NULL;
 		
 		ACTIVE_REGION_MODULE = true;
 		PRIMARY_ALIGNMENT_ONLY = false;
@@ -171,6 +244,7 @@ public:
 		PRINT_DOT_READS = true;
 		KMER_RECOVERY	= false;
 		PRINT_ALL       = false;
+		PRINT_PROGRESS  = true;
 
 		MIN_QV_CALL    = 10;
 		MIN_QV_TRIM    = 10;
@@ -198,11 +272,19 @@ public:
 		NODE_STRLEN = 100;
 
 		RG_FILE = "";
+		ALL_READGROUPS = true;
+		rg_last = -1;
 
 		DFS_LIMIT = 1000000;
 		MAX_INDEL_LEN = 500;
 		MAX_MISMATCH = 2;
 		
+		WINDOW_TIME_BUDGET = 0;
+		WINDOW_RETRY = false;
+		retrying_m = false;
+		expiredK = 0;
+		firstK_m = minK;
+		
 		num_snv_only_regions = 0;
 		num_indel_only_regions = 0;
 		num_softclip_only_regions = 0;
@@ -216,14 +298,56 @@ public:
 	
 	void loadRefs(const string & filename);
 	void loadRG(const string & filename, int member);
-	int processGraph(Graph_t & g, const string & refname, int minK, int maxK);
+	void initReadGroups(SamHeader &headerT, SamHeader &headerN);
+	bool isSelectedRG(const ReadTags_t & tags);
+	int processGraph(Graph_t & g, Ref_t * refinfo, int minK, int maxK, bool release);
+	int processComponent(Graph_t & g, const string & refname, int c);
+	int processComponents(Graph_t & g, const string & refname, int numcomp);
+	void configureGraph(Graph_t & g);
 	int run(int argc, char** argv);
 	bool extractReads(BamReader &reader, Graph_t &g, Ref_t *refinfo, BamRegion &region, int &readcnt, int code);
 	bool isActiveRegion(BamReader &reader, Ref_t *refinfo, BamRegion &region, int code);
 	int processReads();
+	int openInputs();
+	void closeInputs();
+	int processWindows();
+	void sweepWindow(Graph_t & g, Ref_t * refinfo, BamRegion & region, int & readcnt);
+	Ref_t * nextWindow(map<string, Ref_t *>::iterator & ri);
+	void completeWindow(const string & window, vector<Variant_t> & vars, bool expired = false);
+	void countReads(Graph_t & g);
+	void logWindow(const WindowStats_t & stats, double start);
 	void setFilters(Filters * fs) { filters = fs; }
 	void setID(int i) { ID = i; }
 	string retriveSampleName(SamHeader &header);
+	
+	int acquireSpareThreads(int n);
+	void releaseSpareThreads(int n);
+};
+
+// ComponentTasks_t
+// connected components of a window shared by the threads assembling them
+//////////////////////////////////////////////////////////////////////////
+
+class ComponentTasks_t {
+
+public:
+
+	Microassembler * ma_m;
+	string refname_m;
+	vector<Graph_t *> comps_m; // graph of each component (index is the component id)
+	vector<int> status_m; // outcome of each component
+	int next_m; // next component to process
+	int failed_m; // first component that failed
+	pthread_mutex_t lock_m;
+
+	ComponentTasks_t(Microassembler * ma, const string & refname, int numcomp)
+		: ma_m(ma), refname_m(refname), comps_m(numcomp+1, (Graph_t *)NULL), 
+		  status_m(numcomp+1, COMP_OK), next_m(1), failed_m(numcomp+1)
+	{
+		pthread_mutex_init(&lock_m, NULL);
+	}
+
+	~ComponentTasks_t() { pthread_mutex_destroy(&lock_m); }
 };
 
 #endif
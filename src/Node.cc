@@ -371,8 +371,10 @@ void Node_t::updateCovStatus(char c)
 
 // updateCovDistr
 // updated the coverage distribution along the node string
+// (qv points to the base qualities of the k-mer in the read, 
+// reversed is true if the node string is the reverse complement of the read k-mer)
 //////////////////////////////////////////////////////////////
-void Node_t::updateCovDistr(int c, const string & qv, unsigned int strand, char sample) 
+void Node_t::updateCovDistr(int c, const char * qv, bool reversed, unsigned int strand, char sample) 
 {
 	vector<cov_t> * cov_distr = NULL;
 	
@@ -381,16 +383,18 @@ void Node_t::updateCovDistr(int c, const string & qv, unsigned int strand, char
 	else { cerr << "Error: unrecognized sample " << sample << endl; }
 	
  	//string::const_iterator it=qv.begin();
-	for (unsigned int i = 0; i < cov_distr->size(); ++i) {
+	unsigned int n = cov_distr->size();
+	for (unsigned int i = 0; i < n; ++i) {
+		char q = reversed ? qv[n-1-i] : qv[i];
 		if(strand == FWD) { 
 			((*cov_distr)[i]).fwd = c;
 			//if(*it >= MIN_QUAL) { (((*cov_distr)[i]).minqv_fwd)++; }
-			if(qv[i] >= MIN_QUAL) { ++(((*cov_distr)[i]).minqv_fwd); }
+			if(q >= MIN_QUAL) { ++(((*cov_distr)[i]).minqv_fwd); }
 		}
 		else if(strand == REV) { 
 			((*cov_distr)[i]).rev = c;
 			//if(*it >= MIN_QUAL) { (((*cov_distr)[i]).minqv_rev)++; }
-			if(qv[i] >= MIN_QUAL) { ++(((*cov_distr)[i]).minqv_rev); }	
+			if(q >= MIN_QUAL) { ++(((*cov_distr)[i]).minqv_rev); }	
 		}
 		//if (it!=qv.end()) { it++; }
 		//else {cerr << "Error: reached end of quality string (qv)" << endl; }
@@ -513,13 +517,13 @@ int Node_t::readOverlaps(const Node_t & other)
 // hasOverlappingMate
 // return true if the k-mer comes from the same fragment (overlapping mates)
 //////////////////////////////////////////////////////////////
-bool Node_t::hasOverlappingMate(string & read_name, int id)
+bool Node_t::hasOverlappingMate(int fragid, int id)
 {	
 	bool ans = false;
 	
 	if(id == 1) {
 		//if (mate2_name.find(read_name) != mate2_name.end()) { ans = true; }
-	    if (binary_search (mate2_name.begin(), mate2_name.end(), read_name)) { ans = true; }		
+	    if (binary_search (mate2_name.begin(), mate2_name.end(), fragid)) { ans = true; }		
 
 		//for (vector<string>::iterator it2 = mate2_name.begin() ; it2 != mate2_name.end(); ++it2) {
 		//	if ((*it2) == read_name) { ans = true; }
@@ -528,7 +532,7 @@ bool Node_t::hasOverlappingMate(string & read_name, int id)
 	
 	if(id == 2) {
 		//if (mate1_name.find(read_name) != mate1_name.end()) { ans = true; }
-	    if (binary_search (mate1_name.begin(), mate1_name.end(), read_name)) { ans = true; }		
+	    if (binary_search (mate1_name.begin(), mate1_name.end(), fragid)) { ans = true; }		
 			
 	    //for (vector<string>::iterator it1 = mate1_name.begin() ; it1 != mate1_name.end(); ++it1) {
 		//	if ((*it1) == read_name) { ans = true; }
@@ -539,12 +543,12 @@ bool Node_t::hasOverlappingMate(string & read_name, int id)
 }
 
 // add mate name to the set of mates containing this kmer
-void Node_t::addMateName(string & read_name, int id) 
+void Node_t::addMateName(int fragid, int id) 
 {	
 	//if(id == 1) { mate1_name.insert(read_name); }
 	//if(id == 2) { mate2_name.insert(read_name); }
-	if(id == 1) { mate1_name.push_back(read_name); }
-	if(id == 2) { mate2_name.push_back(read_name); }
+	if(id == 1) { mate1_name.push_back(fragid); }
+	if(id == 2) { mate2_name.push_back(fragid); }
 }
 
 // return tumor coverage on the input strand
@@ -65,9 +65,13 @@ public:
 	bool isSink_m;
 	bool dead_m;
 	int  component_m;
+	Node_t * ufparent_m; // union-find parent (NULL for the representative of a component)
+	unsigned short ufrank_m; // union-find rank
 	bool touchRef_m;
 	int  onRefPath_m;
-	unsigned short color;
+	unsigned short color[2]; // cycle search color of the forward and reverse strand
+	unsigned int colorgen_m[2]; // generation of the cycle search that set color
+	bool cycletouched_m; // gained edges since the last cycle search
 	int MIN_QUAL;
 	int mincov;
 	int mincovQV;
@@ -81,8 +85,8 @@ public:
 	
 	//unordered_set<string> mate1_name;
 	//unordered_set<string> mate2_name;
-	vector<string> mate1_name;
-	vector<string> mate2_name;
+	vector<int> mate1_name; // fragment ids of first mates containing this kmer
+	vector<int> mate2_name; // fragment ids of second mates containing this kmer
 	
 	vector<ReadStart_t> readstarts_m;
 	ContigLinkMap_t contiglinks_m;
@@ -103,9 +107,13 @@ public:
 		isSink_m(false),
 		dead_m(false),
 		component_m(0),
+		ufparent_m(NULL),
+		ufrank_m(0),
 		touchRef_m(false),
 		onRefPath_m(0),
-		color(0),
+		color(),
+		colorgen_m(),
+		cycletouched_m(false),
 		MIN_QUAL(0)
 		{ 	
 			cov_status.resize(str_m.size(),'E'); 
@@ -142,7 +150,7 @@ public:
 	float getTotNmlCov() { return cov_nml_m_fwd + cov_nml_m_rev; }
 	float getTotCov() { return cov_tmr_m_fwd + cov_tmr_m_rev + cov_nml_m_fwd + cov_nml_m_rev; }
 	bool isStatusCnt(char c);
-	void updateCovDistr(int c, const string & qv, unsigned int strand, char sample);
+	void updateCovDistr(int c, const char * qv, bool reversed, unsigned int strand, char sample);
 	void updateCovStatus(char c);
 	void revCovDistr();
 	void computeMinCov();
@@ -153,8 +161,8 @@ public:
 	
 	void setRead2InfoList(ReadInfoList_t * list) { readid2info = list; }
 	
-	void setColor(int c) { color = c; }
-	int getColor() { return color; }
+	void setColor(Ori_t dir, int c) { color[(dir == R) ? 1 : 0] = c; }
+	int getColor(Ori_t dir) { return color[(dir == R) ? 1 : 0]; }
 
 	bool isTandem();
 	void addEdge(Mer_t nodeid, Edgedir_t dir, ReadId_t readid);
@@ -170,8 +178,8 @@ public:
 	void sortReadStarts();
 	void addContigLink(Mer_t contigid, ReadId_t rid);
 	int cntReadCode(char code);
-	bool hasOverlappingMate(std::string & read_name, int id);
-	void addMateName(std::string & read_name, int id);
+	bool hasOverlappingMate(int fragid, int id);
+	void addMateName(int fragid, int id);
 
 	int readOverlaps(const Node_t & other);
 	
@@ -25,6 +25,7 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
 
 #include "Mer.hh"
 
@@ -38,21 +39,127 @@ using namespace std;
 
 typedef int ReadId_t;
 
+// ReadSet_t
+//////////////////////////////////////////////////////////////////////////
+
+enum ReadSet_t { SET_TUMOR, SET_NORMAL, SET_REF };
+
+inline const char * readSetName(ReadSet_t set)
+{
+	switch (set) {
+		case SET_TUMOR  : return "tumor";
+		case SET_NORMAL : return "normal";
+		case SET_REF    : return "ref";
+	}
+	return "?";
+}
+
+// ReadStore_t
+// columnar store of the reads of a window: bases are packed at 2 bits 
+// per base (non ACGT bases are flagged in a N mask and decoded as N), 
+// base qualities are kept in a single contiguous buffer and read names
+// are interned to fragment ids (mates share the same id)
+//////////////////////////////////////////////////////////////////////////
+
+class ReadStore_t
+{
+public:
+
+	vector<unsigned char> bases_m;  // 2-bit packed bases (4 per byte)
+	vector<unsigned char> nmask_m;  // 1 bit per base, set for non ACGT bases
+	string qv_m;                    // base qualities of all reads
+	unsigned int len_m;             // total number of bases in the store
+
+	unordered_map<string, int> fragids_m; // read name -> fragment id
+	vector<string> fragnames_m;           // fragment id -> read name
+
+	ReadStore_t() : len_m(0) {}
+
+	void clear()
+	{
+		vector<unsigned char>().swap(bases_m);
+		vector<unsigned char>().swap(nmask_m);
+		string().swap(qv_m);
+		len_m = 0;
+		unordered_map<string, int>().swap(fragids_m);
+		vector<string>().swap(fragnames_m);
+	}
+
+	// append sequence and qualities, returns the offset of the read in the store
+	unsigned int add(const string & seq, const string & qv)
+	{
+		unsigned int off = len_m;
+		unsigned int n = seq.length();
+
+		bases_m.resize((len_m + n + 3) / 4, 0);
+		nmask_m.resize((len_m + n + 7) / 8, 0);
+
+		for (unsigned int i = 0; i < n; ++i)
+		{
+			unsigned int p = len_m + i;
+			unsigned char code = 0;
+			switch (seq[i]) {
+				case 'A': case 'a': code = 0; break;
+				case 'C': case 'c': code = 1; break;
+				case 'G': case 'g': code = 2; break;
+				case 'T': case 't': code = 3; break;
+				default: nmask_m[p >> 3] |= (1 << (p & 7));
+			}
+			bases_m[p >> 2] |= (code << ((p & 3) << 1));
+		}
+
+		qv_m.append(qv, 0, n);
+		if (qv.length() < n) { qv_m.append(n - qv.length(), '!'); }
+		len_m += n;
+
+		return off;
+	}
+
+	// decode len bases starting at position start of the read at offset off
+	void seq(unsigned int off, unsigned int start, unsigned int len, string & out) const
+	{
+		static const char DNA[4] = { 'A', 'C', 'G', 'T' };
+
+		out.resize(len);
+		for (unsigned int i = 0; i < len; ++i)
+		{
+			unsigned int p = off + start + i;
+			if (nmask_m[p >> 3] & (1 << (p & 7))) { out[i] = 'N'; }
+			else { out[i] = DNA[(bases_m[p >> 2] >> ((p & 3) << 1)) & 3]; }
+		}
+	}
+
+	// base qualities of the read at offset off
+	const char * qv(unsigned int off) const { return qv_m.data() + off; }
+
+	// intern the read name to a fragment id
+	int fragid(const string & name)
+	{
+		unordered_map<string, int>::iterator it = fragids_m.find(name);
+		if (it != fragids_m.end()) { return it->second; }
+
+		int id = fragnames_m.size();
+		fragids_m.insert(make_pair(name, id));
+		fragnames_m.push_back(name);
+		return id;
+	}
+};
+
 // ReadInfo_t
 //////////////////////////////////////////////////////////////////////////
 
 class ReadInfo_t
 {
 public:
-	ReadInfo_t(const int label, const string & set, const string & readname, const string & seq, const string & qv, char code, unsigned int strnd, unsigned int mate_order)
-		: label_m(label), set_m(set), readname_m(readname), seq_m(seq), qv_m(qv), code_m(code), mateid_m(-1), mate_order_m(mate_order), strand(strnd), trm5(0), trm3(0), isjunk(false)
+	ReadInfo_t(const int label, ReadSet_t set, int fragid, unsigned int seqoff, unsigned int len, char code, unsigned int strnd, unsigned int mate_order)
+		: label_m(label), set_m(set), fragid_m(fragid), seqoff_m(seqoff), len_m(len), code_m(code), mateid_m(-1), mate_order_m(mate_order), strand(strnd), trm5(0), trm3(0), isjunk(false)
 		{ }
 
 	int            label_m;
-	string         set_m;
-	string         readname_m;
-	string         seq_m;
-	string         qv_m;
+	ReadSet_t      set_m;
+	int            fragid_m; // fragment (read name) id in the read store
+	unsigned int   seqoff_m; // offset of the read in the read store
+	unsigned int   len_m;    // read length
 	char           code_m;
 	ReadId_t       mateid_m;
 	unsigned short mate_order_m; // is first or second mate? (1=first, 2=mate, 0=unmated)
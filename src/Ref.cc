@@ -23,29 +23,78 @@
 *************************** /COPYRIGHT **************************************/
 
 
+// componentView
+// reference of a component graph assembled concurrently with the other 
+// components of the window: it has its own copy of the sequence and of 
+// the ends (trimmed by markRefEnds), while the k-mer index and the 
+// coverage are those of the window reference (read-only at that point)
+Ref_t * Ref_t::componentView() {
+	
+	indexMers(); // built before the components look it up concurrently
+	
+	Ref_t * view = new Ref_t(K);
+	view->hdr = hdr;
+	view->seq = seq;
+	view->rawseq = rawseq;
+	view->refchr = refchr;
+	view->refstart = refstart;
+	view->refend = refend;
+	view->trim5 = trim5;
+	view->trim3 = trim3;
+	view->refcompids = refcompids;
+	view->refnodes = refnodes;
+	view->refcomp = refcomp;
+	view->allcomp = allcomp;
+	view->normal_coverage = normal_coverage;
+	view->tumor_coverage = tumor_coverage;
+	view->indexed_m = true;
+	view->window_m = this;
+	
+	return view;
+}
+
 // allocate mmeory for data structures
 void Ref_t::init() {
 	
-	// allocate memory for mertables
-	mertable_nml = new 	unordered_map<string,cov_t>();
-	mertable_tmr = new 	unordered_map<string,cov_t>();
-	
 	// allocate memory for coverage info
 	normal_coverage = new vector<cov_t>(); // normal k-mer coverage across the reference
 	tumor_coverage  = new vector<cov_t>(); // tumor k-mer coverage across the reference
 	resetCoverage();
 }
 
-// index mers
+// pack a canonical mer into 64 bits (2 bits per base): exact for mers 
+// of K <= 32 made of ACGT only, a hash otherwise (N packs as A), in which 
+// case lookups are verified against the sequence
+uint64_t Ref_t::packMer(const string & cmer, bool & exact) {
+	
+	uint64_t key = 0;
+	exact = (cmer.length() <= 32);
+	for (unsigned int i = 0; i < cmer.length(); ++i) {
+		uint64_t code = 0;
+		switch (cmer[i]) {
+			case 'A': code = 0; break;
+			case 'C': code = 1; break;
+			case 'G': code = 2; break;
+			case 'T': code = 3; break;
+			default: exact = false;
+		}
+		if (i < 32) { key = (key << 2) | code; }
+		else { key = (key ^ code) * 0x9E3779B97F4A7C15ULL; }
+	}
+	return key;
+}
+
+// index mers: canonicalize every reference k-mer once per (window, k)
 void Ref_t::indexMers()
 {
 	if (!indexed_m)
 	{
-		
-		assert(mertable_nml != NULL);
-		assert(mertable_tmr != NULL);
+		merindex_m.clear();
+		nextpos_m.assign(seq.length(), -1);
+		exactkeys_m = true;
 		
 		CanonicalMer_t cmer;
+		bool exact;
 
 		//for (unsigned int i = 0; i < (seq.length() - K + 1); ++i)
 		for (unsigned int i = 0; (i + K) < seq.length(); ++i)
@@ -53,99 +102,71 @@ void Ref_t::indexMers()
 			//assert(i<seq.length()); // check for out of range index
 			cmer.set(seq.substr(i, K));
 			
-			cov_t c;
-		    mertable_nml->insert(std::pair<string,cov_t>(cmer.mer_m,c));
-		    mertable_tmr->insert(std::pair<string,cov_t>(cmer.mer_m,c));
-			
+			pair<unordered_map<uint64_t,int>::iterator,bool> ins = merindex_m.insert(std::pair<uint64_t,int>(packMer(cmer.mer_m, exact), i));
+			if (!exact) { exactkeys_m = false; }
+			if (!ins.second) { // repeated mer (or key collision of inexact mers)
+				int p = (ins.first)->second;
+				while (nextpos_m[p] != -1) { p = nextpos_m[p]; }
+				nextpos_m[i] = -1;
+				nextpos_m[p] = i;
+			}
 		}
 		indexed_m = true;
 	}
 }
 
-// return true if the input mer is found in the mertable
-bool Ref_t::hasMer(const string & cmer)
+// return the first reference position of the input canonical mer (-1 if not found);
+// verify is set if the further positions of the chain must be checked against the sequence
+int Ref_t::findMer(const string & cmer, bool & verify)
 {
-	indexMers();
-	return mertable_nml->count(cmer);
-}
-
-// updated coverage for input mer
-void Ref_t::updateCoverage(const string & cmer, unsigned int strand, char sample) {
+	if (window_m != NULL) { return window_m->findMer(cmer, verify); }
 	indexMers();
 	
-	unordered_map<string,cov_t> * mertable = NULL;
-		
-	if(sample == 'T')      { mertable = mertable_tmr; }
-	else if(sample == 'N') { mertable = mertable_nml; }
-	else { cerr << "Error: unrecognized sample " << sample << endl; }
-	
-	assert(mertable != NULL);
-	//if (mertable == NULL) { cerr << "Error: null pointer to mer-table!" << endl; } 
+	bool exact;
+	unordered_map<uint64_t,int>::const_iterator it = merindex_m.find(packMer(cmer, exact));
+	verify = !(exact && exactkeys_m);
+	if (it == merindex_m.end()) { return -1; }
+	if (!verify) { return it->second; }
 	
-	std::unordered_map<string,cov_t>::iterator it = mertable->find(cmer);
-	if (it != mertable->end()) {
-		if(strand == FWD) { ((*it).second).fwd += 1; }
-		else if(strand == REV) { ((*it).second).rev += 1; }
+	// inexact keys (long mers or mers with N): check the candidate positions against the sequence
+	for (int p = it->second; p != -1; p = nextpos_m[p]) {
+		if (isMerAt(p, cmer)) { return p; }
 	}
+	return -1;
+}
+
+// return true if the input mer is found in the reference
+bool Ref_t::hasMer(const string & cmer)
+{
+	return (findMer(cmer) != -1);
 }
 
-// compute kmer coverage over the reference sequence 
-void Ref_t::computeCoverage(char sample) {
-	CanonicalMer_t cmer;
+// updated coverage for input mer: the count goes directly to the coverage 
+// of every reference position holding the mer (the last base of the k-mer,
+// or the first K bases for the k-mer at position 0)
+void Ref_t::updateCoverage(const string & cmer, unsigned int strand, char sample) {
 	
-	unordered_map<string,cov_t> * mertable = NULL;
-	vector<cov_t> * coverage = NULL;
+	if (window_m != NULL) { window_m->updateCoverage(cmer, strand, sample); return; }
 	
-	if(sample == 'T')      { mertable = mertable_tmr; coverage = tumor_coverage; }
-	else if(sample == 'N') { mertable = mertable_nml; coverage = normal_coverage; }
+	vector<cov_t> * coverage = NULL;
+		
+	if(sample == 'T')      { coverage = tumor_coverage; }
+	else if(sample == 'N') { coverage = normal_coverage; }
 	else { cerr << "Error: unrecognized sample " << sample << endl; }
 	
-	assert(mertable != NULL);
 	assert(coverage != NULL);
-
-	for (unsigned i = 0; (i + K) < seq.length(); ++i) 	
-	{	
-		cmer.set(seq.substr(i, K));			
-		std::unordered_map<string,cov_t>::iterator it = mertable->find(cmer.mer_m);
-		if (it != mertable->end()) {
-			int cov_fwd = ((*it).second).fwd;
-			int cov_rev = ((*it).second).rev;
-			
-			/*
-			normal_coverage.at(i) = n_cov;			
-			tumor_coverage.at(i) = t_cov;
-			
-			if( i==(end-1) ) {
-				for (int l = 0; l < K; l++) {
-					normal_coverage.at(i+l) = n_cov;
-					tumor_coverage.at(i+l) = t_cov;
-				}
-			}
-			*/
-			
-			if(i==0) {
-				for (int j=i; j<K; ++j) { 
-					coverage->at(j).fwd = cov_fwd; 				
-					coverage->at(j).fwd = cov_rev; 
-				}
-			}
-			else {
-				coverage->at(i+K-1).fwd = cov_fwd;
-				coverage->at(i+K-1).rev = cov_rev;
-				
-				
-				//for (int l = 0; l < K-1; l++) {
-					//if(normal_coverage.at(i+l) < n_cov) { normal_coverage.at(i+l) = n_cov; }
-					//if(tumor_coverage.at(i+l) < t_cov) { tumor_coverage.at(i+l) = t_cov; }
-					//normal_coverage.at(i+l) = n_cov;
-					//tumor_coverage.at(i+l) = t_cov;
-				//}
-			}
-			
-		}
-		else {
-			coverage->at(i).fwd = 0;
-			coverage->at(i).rev = 0;
+	
+	bool verify;
+	int p = findMer(cmer, verify);
+	if (p == -1) { return; }
+	
+	for (; p != -1; p = nextpos_m[p]) {
+		if (verify && !isMerAt(p, cmer)) { continue; } 
+		
+		int first = (p == 0) ? 0 : p+K-1;
+		for (int j = first; j < p+K; ++j) {
+			if(strand == FWD) { (*coverage)[j].fwd += 1; }
+			else if(strand == REV) { (*coverage)[j].rev += 1; }
 		}
 	}
 }
@@ -216,11 +237,39 @@ void Ref_t::printKmerCoverage(char sample) {
 	cerr << " len: " << coverage->size() << endl;
 }
 
+// fetch the sequence of the window [refstart, refend) from the reference
+// (upper case, IUPAC ambiguous codes changed to Ns)
+bool Ref_t::loadSeq(faidx_t * fai) {
+	
+	string region = refchr + ":" + itos(refstart) + "-" + itos(refend-1);
+	
+	int seq_len = 0;
+	char * s = fai_fetch(fai, region.c_str(), &seq_len);
+	if ( (s == NULL) || (seq_len < 0) ) { 
+		cerr << "Failed to fetch sequence in " << region << endl; 
+		if (s != NULL) { free(s); }
+		return false;
+	}
+	
+	string ss(s, s + seq_len);
+	free(s);
+	
+	for (unsigned int i = 0; i < ss.length(); ++i) {
+		ss[i] = toupper(ss[i]);
+		if(isAmbiguos(ss[i])) { ss[i]='N'; }
+	}
+	
+	setSeq(ss);
+	setRawSeq(ss);
+	
+	return true;
+}
+
 // clear DT and free memory
 void Ref_t::clear() {
 	
-	if(mertable_nml != NULL)    { mertable_nml->clear();    delete mertable_nml;    mertable_nml = NULL;    }
-	if(mertable_tmr != NULL)    { mertable_tmr->clear();    delete mertable_tmr;    mertable_tmr = NULL;    }
+	unordered_map<uint64_t,int>().swap(merindex_m);
+	vector<int>().swap(nextpos_m);
 	if(normal_coverage != NULL) { normal_coverage->clear(); delete normal_coverage; normal_coverage = NULL; }
 	if(tumor_coverage != NULL)  { tumor_coverage->clear();  delete tumor_coverage;  tumor_coverage = NULL;  }
 }
@@ -29,8 +29,10 @@
 #include <unordered_map>
 #include <set>
 #include <vector>
+#include <stdint.h>
 #include "Mer.hh"
 #include "ReadInfo.hh"
+#include "htslib/faidx.h"
 
 
 using namespace std;
@@ -62,9 +64,12 @@ public:
 	unsigned short trim5;
 	unsigned short trim3;
 
-	// mapping of mers to fwd/rev counts (mer,cov_t)
-	unordered_map<string,cov_t> * mertable_nml;
-	unordered_map<string,cov_t> * mertable_tmr;
+	// index of the reference k-mers: packed canonical mer -> first position,
+	// further positions with the same canonical mer are chained in nextpos_m
+	unordered_map<uint64_t,int> merindex_m;
+	vector<int> nextpos_m;
+	bool exactkeys_m; // every indexed mer is packed exactly (ACGT only, K <= 32): hits need no check
+	Ref_t * window_m; // window reference whose index and coverage are used (NULL unless this is a component view)
 	
 	set<int> refcompids;
 
@@ -77,11 +82,9 @@ public:
 	vector<cov_t> * normal_coverage; // normal k-mer coverage across the reference
 	vector<cov_t> * tumor_coverage; // tumor k-mer coverage across the reference
 	
-	Ref_t(int k) : indexed_m(0) 
+	Ref_t(int k) : exactkeys_m(true), window_m(NULL), indexed_m(0) 
 	{
 		K = k; 
-		mertable_nml = NULL;
-		mertable_tmr = NULL;
 		normal_coverage = NULL;
 		tumor_coverage = NULL;
 	}
@@ -90,14 +93,19 @@ public:
 	void setRawSeq(string rawseq_) { rawseq = rawseq_; }
 	void setK(int k) { K = k; indexed_m = 0; clear(); init(); /*resetCoverage();*/ }
 	void setSeq(string seq_) { seq = seq_; }
+	bool loadSeq(faidx_t * fai);
 	//void setSeq(string seq_) { seq = seq_; normal_coverage.resize(seq.size()); tumor_coverage.resize(seq.size()); resetCoverage(); }
 
+	static uint64_t packMer(const string & cmer, bool & exact);
 	void indexMers();
+	int findMer(const string & cmer, bool & verify);
+	int findMer(const string & cmer) { bool verify; return findMer(cmer, verify); }
+	bool isMerAt(int p, const string & cmer) { return (seq.compare(p, K, cmer) == 0) || (CanonicalMer_t::rc2(seq.substr(p, K)) == cmer); }
 	bool hasMer(const string & cmer);
+	Ref_t * componentView();
 	bool isRefComp(int comp) { return refcompids.find(comp) != refcompids.end(); }
 	
 	void updateCoverage(const string & cmer, unsigned int strand, char sample);
-	void computeCoverage(char sample);
 	int getCovAt(unsigned pos, unsigned int strand, char sample);
 	int getMinCovInKbp(unsigned pos, int K, char sample);
 	void printKmerCoverage(char sample);
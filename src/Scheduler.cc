@@ -0,0 +1,355 @@
+#include "Scheduler.hh"
+
+/****************************************************************************
+** Scheduler.cc
+**
+** Windows of a run, cost model of their analysis and longest-processing-
+** time-first queue of the windows shared by the worker threads
+**
+*****************************************************************************/
+
+/************************** COPYRIGHT ***************************************
+**
+** New York Genome Center
+**
+** SOFTWARE COPYRIGHT NOTICE AGREEMENT
+** This software and its documentation are copyright (2016) by the New York
+** Genome Center. All rights are reserved. This software is supplied without
+** any warranty or guaranteed support whatsoever. The New York Genome Center
+** cannot be responsible for its use, misuse, or functionality.
+**
+** Version: 1.0.0
+** Author: Giuseppe Narzisi
+**
+*************************** /COPYRIGHT **************************************/
+
+#include <algorithm>
+#include "htslib/sam.h"
+#include "util.hh"
+
+// arguments of the threads estimating the cost of a slice of the windows
+struct CostTask_t
+{
+	CostModel_t * model;
+	WindowQueue_t * queue;
+	unsigned int begin;
+	unsigned int end;
+	bool ok; // all the sequences were fetched
+};
+
+static void * costWorker(void * ptr)
+{
+	CostTask_t * task = (CostTask_t *)ptr;
+	
+	task->ok = true;
+	for (unsigned int i = task->begin; i < task->end; ++i) {
+		WindowSpan_t & w = task->queue->windows_m[i];
+		Ref_t ref(task->model->minK_m);
+		ref.refchr = task->queue->contigs_m[w.contig];
+		ref.refstart = w.start;
+		ref.refend = min(w.end, w.start + COST_SEQ_LEN);
+		if (!task->model->loadSeq(&ref)) { task->ok = false; break; }
+		ref.refend = w.end;
+		w.cost = task->model->cost(&ref);
+	}
+	
+	return NULL;
+}
+
+// order windows by decreasing cost
+static bool byCost(const WindowSpan_t & first, const WindowSpan_t & second)
+{
+	return first.cost > second.cost;
+}
+
+CostModel_t::~CostModel_t()
+{
+	for (int s = 0; s < 2; ++s) {
+		if (idx_m[s] != NULL) { hts_idx_destroy(idx_m[s]); }
+	}
+	if (fai_m != NULL) { fai_destroy(fai_m); }
+	pthread_mutex_destroy(&lock_m);
+}
+
+// open
+// load the reference and the BAM indices; without an index the cost only 
+// depends on the reference sequence of the window. Returns false if the 
+// reference index can not be loaded.
+//////////////////////////////////////////////////////////////////////////
+bool CostModel_t::open(const string & reffile, const string & tumor, const string & normal, const RefVector & refs, int minK, int maxK)
+{
+	reffile_m = reffile;
+	minK_m = minK;
+	numK_m = (maxK >= minK) ? ((maxK-minK)/2 + 1) : 1;
+	
+	for (unsigned int i = 0; i < refs.size(); ++i) { tids_m.insert(make_pair(refs[i].RefName, (int)i)); }
+	
+	const string * bams[2] = { &tumor, &normal };
+	for (int s = 0; s < 2; ++s) {
+		idx_m[s] = hts_idx_load(bams[s]->c_str(), HTS_FMT_BAI);
+		if (idx_m[s] == NULL) { cerr << "WARNING: could not load the index of " << *bams[s] << " for the window cost model" << endl; }
+	}
+	
+	fai_m = fai_load(reffile_m.c_str());
+	if (fai_m == NULL) { 
+		cerr << "ERROR: could not load fai index of " << reffile_m << endl; 
+		return false;
+	}
+	return true;
+}
+
+// loadSeq
+// fetch the reference sequence of ref from the shared index
+//////////////////////////////////////////////////////////////////////////
+bool CostModel_t::loadSeq(Ref_t * ref)
+{
+	pthread_mutex_lock(&lock_m);
+	bool ok = ref->loadSeq(fai_m);
+	pthread_mutex_unlock(&lock_m);
+	return ok;
+}
+
+// alignedBytes
+// amount of alignment data (in uncompressed bytes) that has to be read to 
+// extract the region, from the chunks of the bins overlapping the region
+//////////////////////////////////////////////////////////////////////////
+long CostModel_t::alignedBytes(hts_idx_t * idx, int tid, int start, int end)
+{
+	hts_itr_t * itr = sam_itr_queryi(idx, tid, start, end);
+	if (itr == NULL) { return 0; }
+	
+	long bytes = 0;
+	for (int i = 0; i < itr->n_off; ++i) {
+		// virtual offsets: compressed block offset (48 bits) and offset inside the block (16 bits)
+		int64_t blocks = (int64_t)(itr->off[i].v >> 16) - (int64_t)(itr->off[i].u >> 16);
+		int64_t inside = (int64_t)(itr->off[i].v & 0xFFFF) - (int64_t)(itr->off[i].u & 0xFFFF);
+		int64_t delta = 3*blocks + inside; // assume 3x compression of the alignments
+		if (delta > 0) { bytes += delta; }
+	}
+	hts_itr_destroy(itr);
+	
+	return bytes;
+}
+
+// repeatFraction
+// fraction of the k-mers (of size minK) of the sequence already seen 
+// earlier in the sequence
+//////////////////////////////////////////////////////////////////////////
+double CostModel_t::repeatFraction(const string & seq)
+{
+	int K = (minK_m < 32) ? minK_m : 31;
+	if ((int)seq.length() < K) { return 0; }
+	
+	uint64_t table[COST_KMER_TABLE];
+	bool used[COST_KMER_TABLE] = { false };
+	const uint64_t mask = (((uint64_t)1) << (2*K)) - 1;
+	
+	uint64_t code = 0;
+	int valid = 0; // length of the current run of ACGT bases
+	int kmers = 0;
+	int repeated = 0;
+	
+	for (unsigned int i = 0; i < seq.length(); ++i) {
+		int b;
+		switch (seq[i]) {
+			case 'A': b = 0; break;
+			case 'C': b = 1; break;
+			case 'G': b = 2; break;
+			case 'T': b = 3; break;
+			default: b = -1;
+		}
+		if (b < 0) { valid = 0; code = 0; continue; }
+		
+		code = ((code << 2) | b) & mask;
+		if (++valid < K) { continue; }
+		
+		++kmers;
+		unsigned int h = (unsigned int)((code * 0x9E3779B97F4A7C15ULL) >> 40) & (COST_KMER_TABLE-1);
+		while (used[h] && table[h] != code) { h = (h+1) & (COST_KMER_TABLE-1); }
+		if (used[h]) { ++repeated; }
+		else if (kmers < COST_KMER_TABLE/2) { used[h] = true; table[h] = code; } // keep the table sparse
+	}
+	
+	return (kmers == 0) ? 0 : ((double)repeated/(double)kmers);
+}
+
+// cost
+// estimated cost of the analysis of a window
+//////////////////////////////////////////////////////////////////////////
+long CostModel_t::cost(Ref_t * ref)
+{
+	if (isNseq(ref->rawseq)) { return 1; } // skipped right away
+	
+	// windows without an index are weighted by their length
+	long bytes = ref->refend - ref->refstart;
+	
+	unordered_map<string, int>::iterator it = tids_m.find(ref->refchr);
+	if (it != tids_m.end()) {
+		for (int s = 0; s < 2; ++s) {
+			if (idx_m[s] != NULL) { bytes += alignedBytes(idx_m[s], it->second, ref->refstart, ref->refend); }
+		}
+	}
+	
+	double ks = 1 + (numK_m-1) * repeatFraction(ref->rawseq);
+	
+	return 1 + (long)(bytes * ks);
+}
+
+// costs
+// estimate the cost of the windows of the queue using num_threads threads:
+// returns false if the sequence of a window could not be fetched
+//////////////////////////////////////////////////////////////////////////
+bool CostModel_t::costs(WindowQueue_t & queue, int num_threads)
+{
+	if (num_threads < 1) { num_threads = 1; }
+	
+	unsigned int n = queue.windows_m.size();
+	unsigned int slice = (n + num_threads - 1) / num_threads;
+	vector<CostTask_t> tasks(num_threads);
+	vector<pthread_t> threads(num_threads);
+	vector<bool> started(num_threads, false);
+	
+	for (int t = 0; t < num_threads; ++t) {
+		tasks[t].model = this;
+		tasks[t].queue = &queue;
+		tasks[t].begin = min(n, t*slice);
+		tasks[t].end = min(n, (t+1)*slice);
+		
+		if (t == 0) { continue; } // the first slice is done by this thread
+		started[t] = (pthread_create(&threads[t], NULL, costWorker, (void *)&tasks[t]) == 0);
+		if (!started[t]) { costWorker((void *)&tasks[t]); }
+	}
+	costWorker((void *)&tasks[0]);
+	
+	bool ok = true;
+	for (int t = 0; t < num_threads; ++t) {
+		if (started[t]) { pthread_join(threads[t], NULL); }
+		ok = ok && tasks[t].ok;
+	}
+	return ok;
+}
+
+// setContigs
+// contigs of the BAM header (the contig table follows the header order)
+//////////////////////////////////////////////////////////////////////////
+void WindowQueue_t::setContigs(const RefVector & refs)
+{
+	for (unsigned int i = 0; i < refs.size(); ++i) {
+		if (contigids_m.find(refs[i].RefName) != contigids_m.end()) { continue; }
+		contigids_m.insert(make_pair(refs[i].RefName, (int)contigs_m.size()));
+		contigs_m.push_back(refs[i].RefName);
+	}
+}
+
+// addWindow
+//////////////////////////////////////////////////////////////////////////
+void WindowQueue_t::addWindow(const string & chr, int start, int end)
+{
+	unordered_map<string, int>::iterator it = contigids_m.find(chr);
+	if (it == contigids_m.end()) { // contig not in the header
+		it = contigids_m.insert(make_pair(chr, (int)contigs_m.size())).first;
+		contigs_m.push_back(chr);
+	}
+	
+	WindowSpan_t w;
+	w.contig = it->second;
+	w.start = start;
+	w.end = end;
+	w.cost = 0;
+	windows_m.push_back(w);
+}
+
+// addWindows
+// take the windows of the reference tables (the tables are emptied, the 
+// sequences are loaded again when the windows are analyzed)
+//////////////////////////////////////////////////////////////////////////
+void WindowQueue_t::addWindows(vector< map<string, Ref_t *> > & reftable)
+{
+	for (unsigned int t = 0; t < reftable.size(); ++t) {
+		map<string, Ref_t *>::iterator it;
+		for (it = reftable[t].begin(); it != reftable[t].end(); ++it) {
+			addWindow(it->second->refchr, it->second->refstart, it->second->refend);
+			delete it->second;
+		}
+		reftable[t].clear();
+	}
+}
+
+// addRegion
+// split the len bp of the region starting at start into overlapping 
+// windows, as loadRefs splits the sequence of a region (returns the 
+// number of windows added)
+//////////////////////////////////////////////////////////////////////////
+int WindowQueue_t::addRegion(const string & chr, int start, int len, int window_size)
+{
+	int n = 0;
+	int end = len;
+	int delta = 100;
+	for (int offset = 0; offset < end; offset += delta) {
+		int LEN = window_size;
+		if ( (offset + window_size) >= len ) { 
+			LEN = len - offset - 1;
+			end = offset;
+		}
+		addWindow(chr, start + offset, start + offset + LEN);
+		++n;
+	}
+	return n;
+}
+
+// name
+// name of the window (chr:start-end), as in the reference tables
+//////////////////////////////////////////////////////////////////////////
+string WindowQueue_t::name(const WindowSpan_t & w) const
+{
+	return contigs_m[w.contig] + ":" + itos(w.start) + "-" + itos(w.end);
+}
+
+// makeRef
+// new reference entry for the window (without sequence)
+//////////////////////////////////////////////////////////////////////////
+Ref_t * WindowQueue_t::makeRef(const WindowSpan_t & w, int k) const
+{
+	Ref_t * ref = new Ref_t(k);
+	ref->refchr = contigs_m[w.contig];
+	ref->refstart = w.start;
+	ref->refend = w.end;
+	ref->hdr = name(w);
+	return ref;
+}
+
+// schedule
+// order the windows by decreasing cost (ties keep the current order);
+// a single thread analyzes the windows in the current order
+//////////////////////////////////////////////////////////////////////////
+void WindowQueue_t::schedule(int num_threads)
+{
+	if (num_threads > 1) { stable_sort(windows_m.begin(), windows_m.end(), byCost); }
+	next_m = 0;
+}
+
+// next
+// reference entry of the next window to analyze (NULL when all the windows 
+// have been handed out); the entry is owned by the caller
+//////////////////////////////////////////////////////////////////////////
+Ref_t * WindowQueue_t::next(int k)
+{
+	int i = -1;
+	pthread_mutex_lock(&lock_m);
+	if (next_m < windows_m.size()) { i = next_m++; }
+	pthread_mutex_unlock(&lock_m);
+	
+	if (i < 0) { return NULL; }
+	return makeRef(windows_m[i], k);
+}
+
+// taken
+// number of windows handed out so far
+//////////////////////////////////////////////////////////////////////////
+unsigned int WindowQueue_t::taken()
+{
+	pthread_mutex_lock(&lock_m);
+	unsigned int n = next_m;
+	pthread_mutex_unlock(&lock_m);
+	return n;
+}
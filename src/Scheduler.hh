@@ -0,0 +1,126 @@
+#ifndef SCHEDULER_HH
+#define SCHEDULER_HH 1
+
+/****************************************************************************
+** Scheduler.hh
+**
+** Windows of a run, cost model of their analysis and longest-processing-
+** time-first queue of the windows shared by the worker threads
+**
+*****************************************************************************/
+
+/************************** COPYRIGHT ***************************************
+**
+** New York Genome Center
+**
+** SOFTWARE COPYRIGHT NOTICE AGREEMENT
+** This software and its documentation are copyright (2016) by the New York
+** Genome Center. All rights are reserved. This software is supplied without
+** any warranty or guaranteed support whatsoever. The New York Genome Center
+** cannot be responsible for its use, misuse, or functionality.
+**
+** Version: 1.0.0
+** Author: Giuseppe Narzisi
+**
+*************************** /COPYRIGHT **************************************/
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <stdint.h>
+#include <pthread.h>
+#include "api/BamAux.h"
+#include "htslib/hts.h"
+#include "htslib/faidx.h"
+#include "Ref.hh"
+
+using namespace std;
+using namespace BamTools;
+
+// size of the hash table used to find the repeated k-mers of a window
+#define COST_KMER_TABLE 2048
+
+// bases of the reference fetched (from the window start) to estimate the 
+// repeated k-mers of a window: the table keeps at most COST_KMER_TABLE/2
+#define COST_SEQ_LEN (COST_KMER_TABLE/2)
+
+class WindowQueue_t;
+
+// window of the reference (coordinates only: the sequence is loaded when 
+// the window is analyzed)
+struct WindowSpan_t
+{
+	int contig; // index in the contig table of the queue
+	int start;
+	int end;
+	long cost; // estimated cost of the analysis
+	
+	bool operator<(const WindowSpan_t & w) const {
+		if (contig != w.contig) { return contig < w.contig; }
+		if (start != w.start) { return start < w.start; }
+		return end < w.end;
+	}
+};
+
+// Estimated cost of the analysis of a window: the amount of alignments in
+// the window (from the bins and linear index of the tumor and normal BAM
+// indices) times the number of k-mer sizes the window is expected to go 
+// through, estimated from the repeated k-mers of the first COST_SEQ_LEN
+// bases of its reference sequence.
+class CostModel_t
+{
+public:
+
+	string reffile_m; // reference (FASTA)
+	faidx_t * fai_m; // reference index shared by the threads of costs()
+	pthread_mutex_t lock_m; // protects fai_m
+	hts_idx_t * idx_m[2]; // BAM indices of tumor and normal (NULL if not available)
+	unordered_map<string, int> tids_m; // contig name to BAM reference id
+	int minK_m;
+	int numK_m; // number of k-mer sizes tried for a window
+
+	CostModel_t() : fai_m(NULL), minK_m(11), numK_m(1) { idx_m[0] = idx_m[1] = NULL; pthread_mutex_init(&lock_m, NULL); }
+	~CostModel_t();
+
+	bool open(const string & reffile, const string & tumor, const string & normal, const RefVector & refs, int minK, int maxK);
+	long cost(Ref_t * ref);
+	bool costs(WindowQueue_t & queue, int num_threads);
+	bool loadSeq(Ref_t * ref);
+
+private:
+	long alignedBytes(hts_idx_t * idx, int tid, int start, int end);
+	double repeatFraction(const string & seq);
+};
+
+// All the windows of a run. Once scheduled the worker threads take the
+// next window from the queue as soon as they are done with the previous 
+// one; with more threads the windows are handed out in decreasing order 
+// of cost, so the most expensive windows start first.
+class WindowQueue_t
+{
+public:
+
+	vector<string> contigs_m; // contig names (BAM header order first)
+	unordered_map<string, int> contigids_m; // contig name to index in contigs_m
+	vector<WindowSpan_t> windows_m; // windows (in scheduling order once scheduled)
+	unsigned int next_m; // next window to hand out
+	pthread_mutex_t lock_m;
+
+	WindowQueue_t() : next_m(0) { pthread_mutex_init(&lock_m, NULL); }
+	~WindowQueue_t() { pthread_mutex_destroy(&lock_m); }
+
+	void setContigs(const RefVector & refs);
+	void addWindow(const string & chr, int start, int end);
+	void addWindows(vector< map<string, Ref_t *> > & reftable);
+	int addRegion(const string & chr, int start, int len, int window_size);
+	void clear() { windows_m.clear(); next_m = 0; }
+	string name(const WindowSpan_t & w) const;
+	Ref_t * makeRef(const WindowSpan_t & w, int k) const;
+	void schedule(int num_threads);
+	Ref_t * next(int k);
+	unsigned int size() const { return windows_m.size(); }
+	unsigned int taken();
+};
+
+#endif
@@ -0,0 +1,401 @@
+#include "Server.hh"
+
+/****************************************************************************
+** Server.cc
+**
+** Long-running server mode: the BAMs, their indices and the reference
+** index are opened once and regions are called on request
+**
+*****************************************************************************/
+
+/************************** COPYRIGHT ***************************************
+**
+** New York Genome Center
+**
+** SOFTWARE COPYRIGHT NOTICE AGREEMENT
+** This software and its documentation are copyright (2016) by the New York
+** Genome Center. All rights are reserved. This software is supplied without
+** any warranty or guaranteed support whatsoever. The New York Genome Center
+** cannot be responsible for its use, misuse, or functionality.
+**
+** Version: 1.0.0
+** Author: Giuseppe Narzisi
+**
+*************************** /COPYRIGHT **************************************/
+
+#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// thread serving the clients of the socket with its own assembler
+struct ServerWorker_t
+{
+	Server_t * server;
+	Microassembler * assembler;
+};
+
+// Server_t
+//////////////////////////////////////////////////////////////////////////
+Server_t::Server_t(const RefVector & refs, Filters * fs, const string & version, const string & reffile, const string & command_line, int padding, int window_size)
+{
+	refs_m = refs;
+	for (unsigned int i = 0; i < refs.size(); ++i) {
+		lengths_m.insert(make_pair(refs[i].RefName, refs[i].RefLength));
+	}
+	filters_m = fs;
+	version_m = version;
+	reffile_m = reffile;
+	command_line_m = command_line;
+	padding_m = padding;
+	window_size_m = window_size;
+	listen_fd_m = -1;
+	shutdown_m = false;
+	pthread_mutex_init(&lock_m, NULL);
+}
+
+// run
+// serve the requests of stdin (if socket is empty) or of the clients of
+// the socket until the input ends or a client asks to stop; the inputs of
+// the assemblers are opened once for all the requests
+//////////////////////////////////////////////////////////////////////////
+int Server_t::run(vector<Microassembler *> & assemblers, const string & socket)
+{
+	signal(SIGPIPE, SIG_IGN); // a client closing the connection only ends its session
+
+	// precompute log-factorials for the fisher exact tests
+	FET_t::initLogFactorials(filters_m->maxCovTumor + filters_m->maxCovNormal);
+
+	if (socket.empty()) {
+		WindowQueue_t queue;
+		queue.setContigs(refs_m);
+		assemblers[0]->queue = &queue;
+		assemblers[0]->PRINT_PROGRESS = false;
+		if (assemblers[0]->openInputs() != 0) { return -1; }
+		cerr << "Serving requests on stdin" << endl;
+		session(assemblers[0], queue, STDIN_FILENO, STDOUT_FILENO);
+		assemblers[0]->closeInputs();
+		return 0;
+	}
+
+	if (!listen(socket)) { return -1; }
+
+	vector<pthread_t> threads(assemblers.size());
+	vector<ServerWorker_t> workers(assemblers.size());
+	unsigned int started = 0; // threads created
+	int status = 0;
+	for (unsigned int i = 0; i < assemblers.size(); ++i) {
+		workers[i].server = this;
+		workers[i].assembler = assemblers[i];
+		int rc = pthread_create(&threads[i], NULL, worker, (void *)&workers[i]);
+		if (rc) {
+			cerr << "Error:unable to create thread," << rc << endl;
+			stop(); // the threads already started return
+			status = -1;
+			break;
+		}
+		++started;
+	}
+	for (unsigned int i = 0; i < started; ++i) {
+		void * failed = NULL;
+		pthread_join(threads[i], &failed);
+		if (failed != NULL) { status = -1; }
+	}
+
+	close(listen_fd_m);
+	listen_fd_m = -1;
+	unlink(socket_m.c_str());
+
+	return status;
+}
+
+// worker
+// accept the clients of the socket one at a time until the server stops
+//////////////////////////////////////////////////////////////////////////
+void * Server_t::worker(void * ptr)
+{
+	ServerWorker_t * w = (ServerWorker_t *)ptr;
+	Server_t * server = w->server;
+
+	WindowQueue_t queue;
+	queue.setContigs(server->refs_m);
+	w->assembler->queue = &queue;
+	w->assembler->PRINT_PROGRESS = false;
+	if (w->assembler->openInputs() != 0) { server->stop(); return ptr; } // non-NULL: the inputs could not be opened
+
+	while (!server->stopped()) {
+		int fd = accept(server->listen_fd_m, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) { continue; }
+			break; // the listening socket was shut down
+		}
+		server->session(w->assembler, queue, fd, fd);
+		close(fd);
+	}
+
+	w->assembler->closeInputs();
+	w->assembler->queue = NULL;
+	return NULL;
+}
+
+// listen
+// bind the UNIX socket (a stale socket file left by a previous server is
+// replaced, any other file is not)
+//////////////////////////////////////////////////////////////////////////
+bool Server_t::listen(const string & path)
+{
+	struct sockaddr_un addr;
+	if (path.size() >= sizeof(addr.sun_path)) {
+		cerr << "ERROR: socket path too long: " << path << endl;
+		return false;
+	}
+
+	struct stat st;
+	if (lstat(path.c_str(), &st) == 0) {
+		if (!S_ISSOCK(st.st_mode)) {
+			cerr << "ERROR: " << path << " exists and is not a socket" << endl;
+			return false;
+		}
+		unlink(path.c_str());
+	}
+
+	listen_fd_m = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd_m < 0) {
+		cerr << "ERROR: could not create socket: " << strerror(errno) << endl;
+		return false;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	if ( (::bind(listen_fd_m, (struct sockaddr *)&addr, sizeof(addr)) != 0) || (::listen(listen_fd_m, 16) != 0) ) {
+		cerr << "ERROR: could not listen on " << path << ": " << strerror(errno) << endl;
+		close(listen_fd_m);
+		listen_fd_m = -1;
+		return false;
+	}
+
+	socket_m = path;
+	cerr << "Serving requests on " << path << endl;
+	return true;
+}
+
+// stop
+// stop the server: the workers waiting for a client are woken up by
+// shutting down the listening socket
+//////////////////////////////////////////////////////////////////////////
+void Server_t::stop()
+{
+	pthread_mutex_lock(&lock_m);
+	shutdown_m = true;
+	pthread_mutex_unlock(&lock_m);
+
+	if (listen_fd_m >= 0) { shutdown(listen_fd_m, SHUT_RDWR); }
+}
+
+// stopped
+//////////////////////////////////////////////////////////////////////////
+bool Server_t::stopped()
+{
+	pthread_mutex_lock(&lock_m);
+	bool s = shutdown_m;
+	pthread_mutex_unlock(&lock_m);
+	return s;
+}
+
+// session
+// serve the requests of a client until it disconnects or quits
+//////////////////////////////////////////////////////////////////////////
+void Server_t::session(Microassembler * assembler, WindowQueue_t & queue, int in, int out)
+{
+	string buffer;
+	string line;
+	string response;
+
+	while (readLine(in, buffer, line)) {
+		bool more = request(assembler, queue, line, response);
+		if (!response.empty() && !writeAll(out, response)) { break; }
+		if (!more) { break; }
+	}
+}
+
+// request
+// serve a request line (returns false if the session must end)
+//////////////////////////////////////////////////////////////////////////
+bool Server_t::request(Microassembler * assembler, WindowQueue_t & queue, const string & line, string & response)
+{
+	response.clear();
+
+	// trim blanks and the carriage return of clients sending CRLF
+	size_t first = line.find_first_not_of(" \t\r");
+	if (first == string::npos) { return true; } // empty line
+	size_t last = line.find_last_not_of(" \t\r");
+	string req = line.substr(first, last - first + 1);
+
+	if (req == "quit") { return false; }
+	if (req == "shutdown") { stop(); return false; }
+
+	struct timespec start, finish;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	ostringstream out;
+	int records = 0;
+
+	if (req == "header") {
+		time_t rawtime;
+		time (&rawtime);
+		VariantDB_t db;
+		db.setCommandLine(command_line_m);
+		db.printHeader(out, version_m, reffile_m, ctime(&rawtime), *filters_m, assembler->sample_name_normal, assembler->sample_name_tumor);
+	}
+	else {
+		string chr;
+		int start_pos;
+		int end_pos;
+		string error;
+		if (!parseRegion(req, chr, start_pos, end_pos, error)) {
+			response = "#error\t" + error + "\n";
+			return true;
+		}
+
+		queue.clear();
+		queue.addRegion(chr, start_pos, end_pos - start_pos + 1, window_size_m);
+		queue.schedule(1);
+
+		VariantDB_t db; // variants of this request only
+		db.setContigs(refs_m);
+		assembler->vDB = &db;
+		int rc = assembler->processWindows();
+		assembler->vDB = NULL;
+
+		if (rc != 0) {
+			response = "#error\tcould not read the alignments of " + req + "\n";
+			return true;
+		}
+
+		db.printVariants(out);
+	}
+
+	response = out.str();
+	if (req != "header") { records = count(response.begin(), response.end(), '\n'); }
+
+	clock_gettime(CLOCK_MONOTONIC, &finish);
+	double elapsed = (finish.tv_sec - start.tv_sec) * 1000.0;
+	elapsed += (finish.tv_nsec - start.tv_nsec) / 1000000.0;
+
+	ostringstream done;
+	done.setf(ios::fixed, ios::floatfield);
+	done.precision(1);
+	done << "#done\t" << records << "\t" << elapsed << "\n";
+	response += done.str();
+
+	if (req != "header") { cerr << "Served " << req << ": " << records << " records in " << elapsed << " ms" << endl; }
+
+	return true;
+}
+
+// parseRegion
+// coordinates of the windows of a request (chr or chr:start-end), padded
+// and clipped to the contig as the regions of --reg
+//////////////////////////////////////////////////////////////////////////
+bool Server_t::parseRegion(const string & region, string & chr, int & start, int & end, string & error)
+{
+	size_t x = region.find_last_of(':');
+	chr = (x == string::npos) ? region : region.substr(0, x);
+
+	unordered_map<string, int>::iterator it = lengths_m.find(chr);
+	if ( (it == lengths_m.end()) && (x != string::npos) ) { // contig names can contain ':'
+		chr = region;
+		it = lengths_m.find(chr);
+		x = string::npos;
+	}
+	if (it == lengths_m.end()) {
+		error = "contig " + region.substr(0, region.find_last_of(':')) + " not found in BAM header";
+		return false;
+	}
+	int len = it->second;
+
+	if (x == string::npos) { // whole contig
+		start = 1;
+		end = len;
+		return true;
+	}
+
+	const char * s = region.c_str() + x + 1;
+	char * e = NULL;
+	long sp = strtol(s, &e, 10);
+	if ( (e == s) || (*e != '-') ) {
+		error = "invalid region " + region + " (expected chr:start-end)";
+		return false;
+	}
+	s = e + 1;
+	long ep = strtol(s, &e, 10);
+	if ( (e == s) || (*e != '\0') || (sp < 1) || (ep < sp) ) {
+		error = "invalid region " + region + " (expected chr:start-end)";
+		return false;
+	}
+
+	sp -= padding_m;
+	ep += padding_m;
+	if (sp < 1) { sp = 1; } // start position cannnot be less than 1
+	if (ep > len) { ep = len; }
+	if (sp > ep) {
+		error = "region " + region + " is outside of contig " + chr;
+		return false;
+	}
+
+	start = sp;
+	end = ep;
+	return true;
+}
+
+// readLine
+// next line of the input (false at the end of the input)
+//////////////////////////////////////////////////////////////////////////
+bool Server_t::readLine(int fd, string & buffer, string & line)
+{
+	char chunk[4096];
+
+	while (true) {
+		size_t nl = buffer.find('\n');
+		if (nl != string::npos) {
+			line = buffer.substr(0, nl);
+			buffer.erase(0, nl + 1);
+			return true;
+		}
+
+		ssize_t n = read(fd, chunk, sizeof(chunk));
+		if (n < 0 && errno == EINTR) { continue; }
+		if (n <= 0) { // end of input: a last line without newline is still a request
+			if (buffer.empty()) { return false; }
+			line = buffer;
+			buffer.clear();
+			return true;
+		}
+		buffer.append(chunk, n);
+	}
+}
+
+// writeAll
+//////////////////////////////////////////////////////////////////////////
+bool Server_t::writeAll(int fd, const string & data)
+{
+	size_t done = 0;
+	while (done < data.size()) {
+		ssize_t n = write(fd, data.data() + done, data.size() - done);
+		if (n < 0) {
+			if (errno == EINTR) { continue; }
+			return false;
+		}
+		done += n;
+	}
+	return true;
+}
@@ -0,0 +1,89 @@
+#ifndef SERVER_HH
+#define SERVER_HH 1
+
+/****************************************************************************
+** Server.hh
+**
+** Long-running server mode: the BAMs, their indices and the reference
+** index are opened once and regions are called on request
+**
+*****************************************************************************/
+
+/************************** COPYRIGHT ***************************************
+**
+** New York Genome Center
+**
+** SOFTWARE COPYRIGHT NOTICE AGREEMENT
+** This software and its documentation are copyright (2016) by the New York
+** Genome Center. All rights are reserved. This software is supplied without
+** any warranty or guaranteed support whatsoever. The New York Genome Center
+** cannot be responsible for its use, misuse, or functionality.
+**
+** Version: 1.0.0
+** Author: Giuseppe Narzisi
+**
+*************************** /COPYRIGHT **************************************/
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <pthread.h>
+#include "api/BamAux.h"
+#include "Variant.hh"
+#include "Microassembler.hh"
+#include "Scheduler.hh"
+
+using namespace std;
+using namespace BamTools;
+
+// Requests are read one per line, from stdin or from the clients of a
+// local UNIX socket:
+//
+//   chr:start-end    call the region (padded and windowed as --reg)
+//   chr              call a whole contig
+//   header           VCF header of the records
+//   quit             close the connection (end the server on stdin)
+//   shutdown         stop the server
+//
+// The VCF records of a region are followed by a line
+//
+//   #done <num records> <elapsed ms>
+//
+// and a request that can not be served gets a single line #error <message>.
+// With a socket every assembler serves one client at a time, so up to
+// one client per thread is served concurrently.
+class Server_t
+{
+public:
+
+	RefVector refs_m; // contigs of the BAM header
+	unordered_map<string, int> lengths_m; // contig name to length
+	Filters * filters_m; // filter thresholds
+	string version_m; // version reported in the VCF header
+	string reffile_m; // reference (FASTA)
+	string command_line_m; // command line reported in the VCF header
+	int padding_m; // padding of the requested regions
+	int window_size_m;
+	int listen_fd_m; // listening socket (-1 if serving stdin)
+	string socket_m; // path of the socket
+	bool shutdown_m; // set when a client asks the server to stop
+	pthread_mutex_t lock_m; // protects shutdown_m
+
+	Server_t(const RefVector & refs, Filters * fs, const string & version, const string & reffile, const string & command_line, int padding, int window_size);
+	~Server_t() { pthread_mutex_destroy(&lock_m); }
+
+	int run(vector<Microassembler *> & assemblers, const string & socket);
+
+private:
+	bool listen(const string & path);
+	void stop();
+	bool stopped();
+	void session(Microassembler * assembler, WindowQueue_t & queue, int in, int out);
+	bool request(Microassembler * assembler, WindowQueue_t & queue, const string & line, string & response);
+	bool parseRegion(const string & region, string & chr, int & start, int & end, string & error);
+	static bool readLine(int fd, string & buffer, string & line);
+	static bool writeAll(int fd, const string & data);
+	static void * worker(void * ptr);
+};
+
+#endif
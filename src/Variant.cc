@@ -23,7 +23,7 @@
 *************************** /COPYRIGHT **************************************/
 
 
-void Variant_t::printVCF() {
+void Variant_t::printVCF(ostream & out) {
 	//CHROM  POS     ID      REF     ALT     QUAL    FILTER  INFO    FORMAT  Pat4-FF-Normal-DNA      Pat4-FF-Tumor-DNA
 	string ID = ".";
 	string FILTER = "";
@@ -152,7 +152,7 @@ void Variant_t::printVCF() {
 	string NORMAL = GT_normal + ":" + itos(tot_ref_cov_normal) + "," + itos(tot_alt_cov_normal) + ":" + itos(ref_cov_normal_fwd) + "," + itos(ref_cov_normal_rev) +":" + itos(alt_cov_normal_fwd) + "," + itos(alt_cov_normal_rev) + ":" + itos(tot_ref_cov_normal+tot_alt_cov_normal);
 	string TUMOR = GT_tumor + ":" + itos(tot_ref_cov_tumor) + "," + itos(tot_alt_cov_tumor) + ":" + itos(ref_cov_tumor_fwd) + "," + itos(ref_cov_tumor_rev) + ":" + itos(alt_cov_tumor_fwd) + "," + itos(alt_cov_tumor_rev) + ":" + itos(tot_ref_cov_tumor+tot_alt_cov_tumor);
 	
-	cout << chr << "\t" << pos << "\t" << ID << "\t" << ref << "\t" << alt << "\t" << QUAL << "\t" << FILTER << "\t" << INFO << "\t" << FORMAT << "\t" << NORMAL << "\t" << TUMOR << endl;
+	out << chr << "\t" << pos << "\t" << ID << "\t" << ref << "\t" << alt << "\t" << QUAL << "\t" << FILTER << "\t" << INFO << "\t" << FORMAT << "\t" << NORMAL << "\t" << TUMOR << endl;
 }
 
 // compute genotype info in VCF format (GT field)
@@ -262,6 +262,13 @@ string Variant_t::getSignature() {
 	return ans;
 }
 
+// true if the two variants have the same signature (same event at the same locus)
+bool Variant_t::sameSignature(const Variant_t & v) const {
+	
+	return (pos == v.pos) && (type == v.type) && (len == v.len) && 
+		(chr == v.chr) && (ref == v.ref) && (alt == v.alt);
+}
+
 string Variant_t::getPosition() {
 		
 	string ans = chr+":"+itos(pos);
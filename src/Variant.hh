@@ -82,6 +82,8 @@ public:
 	
 	Filters * filters; // filter thresholds
 
+	Variant_t() : kmer(0), pos(0), type('S'), len(0), status('S'), filters(NULL) { }
+	
 	Variant_t(string chr_, int pos_, string ref_, string alt_, int ref_cov_normal_fwd_, int ref_cov_normal_rev_, int ref_cov_tumor_fwd_, int ref_cov_tumor_rev_, int alt_cov_normal_fwd_, int alt_cov_normal_rev_, int alt_cov_tumor_fwd_, int alt_cov_tumor_rev_, char prev_bp_ref_, char prev_bp_alt_, Filters * fs, int k, string str_, char code)
 	{ 			
 		kmer = k;
@@ -134,13 +136,14 @@ public:
 		reGenotype();
 	}
 	
-	void printVCF();
+	void printVCF(ostream & out);
 	string genotype(int R, int A);
 	string getGenotypeNormal() { return GT_normal; }
 	string getGenotypeTumor() { return GT_tumor; }
 	void reGenotype();
 	char bestState(int Rn, int An, int Rt, int At);
 	string getSignature();
+	bool sameSignature(const Variant_t & v) const;
 	string getPosition();
 	double compute_FET_score();
 	double compute_SB_score();
@@ -24,28 +24,158 @@
 **
 *************************** /COPYRIGHT **************************************/
 
+// search the bucket for the variant with the given key
+// (collisions are resolved by exact comparison of the variant signature)
+Variant_t * VariantBucket_t::find(VariantKey_t key, const Variant_t & v) {
+	
+	pair< unordered_multimap<VariantKey_t,unsigned int>::iterator, unordered_multimap<VariantKey_t,unsigned int>::iterator > range = index_m.equal_range(key);
+	for (unordered_multimap<VariantKey_t,unsigned int>::iterator it = range.first; it != range.second; ++it) {
+		if (vars_m[it->second].sameSignature(v)) { return &vars_m[it->second]; }
+	}
+	return NULL;
+}
+
+// append variant to the bucket
+void VariantBucket_t::append(VariantKey_t key, const Variant_t & v) {
+	
+	if (!vars_m.empty() && (v.pos < vars_m.back().pos)) { sorted_m = false; }
+	index_m.insert(pair<VariantKey_t,unsigned int>(key, vars_m.size()));
+	vars_m.push_back(v);
+}
+
+// restore position order (only needed if variants were appended out of order)
+void VariantBucket_t::sortByPos() {
+	
+	if (sorted_m) { return; }
+	
+	vector<unsigned int> order(vars_m.size());
+	for (unsigned int i = 0; i < order.size(); ++i) { order[i] = i; }
+	stable_sort(order.begin(), order.end(), byPos(vars_m));
+	
+	vector<Variant_t> sorted;
+	sorted.reserve(vars_m.size());
+	vector<unsigned int> slot(vars_m.size());
+	for (unsigned int i = 0; i < order.size(); ++i) {
+		slot[order[i]] = i;
+		sorted.push_back(vars_m[order[i]]);
+	}
+	vars_m.swap(sorted);
+	
+	// remap slots in the index to the new positions of the variants
+	for (unordered_multimap<VariantKey_t,unsigned int>::iterator it = index_m.begin(); it != index_m.end(); ++it) {
+		it->second = slot[it->second];
+	}
+	sorted_m = true;
+}
+
+VariantDB_t::~VariantDB_t() {
+	
+	for (unsigned int c = 0; c < DB.size(); ++c) { delete DB[c]; }
+	pthread_rwlock_destroy(&lock_m);
+}
+
+// set contig partitions following the order of the BAM header
+void VariantDB_t::setContigs(const RefVector & refs) {
+	
+	pthread_rwlock_wrlock(&lock_m);
+	for (unsigned int i = 0; i < refs.size(); ++i) {
+		if (contigs.find(refs[i].RefName) != contigs.end()) { continue; }
+		contigs.insert(pair<string,ContigId_t>(refs[i].RefName, DB.size()));
+		DB.push_back(new ContigVariants_t(refs[i].RefName));
+		DB.back()->buckets_m.resize(refs[i].RefLength/VARIANT_BUCKET_SIZE + 1, NULL);
+	}
+	pthread_rwlock_unlock(&lock_m);
+}
+
+// return the bucket of the given locus or NULL if not yet allocated
+// (must be called holding the DB lock)
+VariantBucket_t * VariantDB_t::findBucket(const string & chr, int pos, ContigId_t & cid) {
+	
+	unordered_map<string,ContigId_t>::iterator it_c = contigs.find(chr);
+	if (it_c == contigs.end()) { return NULL; }
+	
+	cid = it_c->second;
+	unsigned int b = bucketOf(pos);
+	if (b >= DB[cid]->buckets_m.size()) { return NULL; }
+	
+	return DB[cid]->buckets_m[b];
+}
+
+// return the bucket of the given locus, allocating contig and bucket if needed
+VariantBucket_t * VariantDB_t::getBucket(const string & chr, int pos, ContigId_t & cid) {
+	
+	pthread_rwlock_rdlock(&lock_m);
+	VariantBucket_t * bucket = findBucket(chr, pos, cid);
+	pthread_rwlock_unlock(&lock_m);
+	
+	if (bucket != NULL) { return bucket; }
+	
+	pthread_rwlock_wrlock(&lock_m);
+	bucket = findBucket(chr, pos, cid); // another thread may have created it in the meantime
+	if (bucket == NULL) {
+		unordered_map<string,ContigId_t>::iterator it_c = contigs.find(chr);
+		if (it_c == contigs.end()) { // contig not in the header
+			it_c = contigs.insert(pair<string,ContigId_t>(chr, DB.size())).first;
+			DB.push_back(new ContigVariants_t(chr));
+		}
+		cid = it_c->second;
+		
+		unsigned int b = bucketOf(pos);
+		if (b >= DB[cid]->buckets_m.size()) { DB[cid]->buckets_m.resize(b+1, NULL); }
+		bucket = DB[cid]->buckets_m[b] = new VariantBucket_t();
+	}
+	pthread_rwlock_unlock(&lock_m);
+	
+	return bucket;
+}
+
+// build the 64-bit key of the variant (contig id, position, ref/alt fingerprint)
+VariantKey_t VariantDB_t::makeKey(ContigId_t cid, const Variant_t & v) {
+	
+	// FNV-1a hash of type, length and alleles folded to 8 bits
+	uint32_t h = 2166136261u;
+	h = (h ^ (unsigned char)v.type) * 16777619u;
+	h = (h ^ (v.len & 0xFF)) * 16777619u;
+	h = (h ^ (v.len >> 8)) * 16777619u;
+	for (string::const_iterator it = v.ref.begin(); it != v.ref.end(); ++it) { h = (h ^ (unsigned char)(*it)) * 16777619u; }
+	h = (h ^ (unsigned char)'>') * 16777619u;
+	for (string::const_iterator it = v.alt.begin(); it != v.alt.end(); ++it) { h = (h ^ (unsigned char)(*it)) * 16777619u; }
+	h = (h >> 16) ^ (h & 0xFFFF);
+	h = (h >> 8) ^ (h & 0xFF);
+	
+	return ((VariantKey_t)(cid & 0xFFFFFF) << 40) | ((VariantKey_t)(uint32_t)v.pos << 8) | (VariantKey_t)h;
+}
+
 // add variant to DB and update counts per position
+// (thread-safe: only the bucket of the variant is locked during the update)
 void VariantDB_t::addVar(Variant_t v) {
 	
-	string key = sha256(v.getSignature());	
-    map<string,Variant_t>::iterator it_v = DB.find(key);
+	ContigId_t cid = 0;
+	VariantBucket_t * bucket = getBucket(v.chr, v.pos, cid);
+	VariantKey_t key = makeKey(cid, v);
 	
-	if (it_v != DB.end()) {		
+	pthread_mutex_lock(&bucket->lock_m);
+	
+	Variant_t * it_v = bucket->find(key, v);
+	
+	if (it_v != NULL) {		
 		// keep highest supporting coverage found
-		if (it_v->second.ref_cov_normal_fwd < v.ref_cov_normal_fwd) { it_v->second.ref_cov_normal_fwd = v.ref_cov_normal_fwd; }
-		if (it_v->second.ref_cov_normal_rev < v.ref_cov_normal_rev) { it_v->second.ref_cov_normal_rev = v.ref_cov_normal_rev; }
-		if (it_v->second.ref_cov_tumor_fwd  < v.ref_cov_tumor_fwd ) { it_v->second.ref_cov_tumor_fwd  = v.ref_cov_tumor_fwd;  }
-		if (it_v->second.ref_cov_tumor_rev  < v.ref_cov_tumor_rev ) { it_v->second.ref_cov_tumor_rev  = v.ref_cov_tumor_rev;  }
-		if (it_v->second.alt_cov_normal_fwd < v.alt_cov_normal_fwd) { it_v->second.alt_cov_normal_fwd = v.alt_cov_normal_fwd; }
-		if (it_v->second.alt_cov_normal_rev < v.alt_cov_normal_rev) { it_v->second.alt_cov_normal_rev = v.alt_cov_normal_rev; }		
-		if (it_v->second.alt_cov_tumor_fwd  < v.alt_cov_tumor_fwd ) { it_v->second.alt_cov_tumor_fwd  = v.alt_cov_tumor_fwd;  }
-		if (it_v->second.alt_cov_tumor_rev  < v.alt_cov_tumor_rev ) { it_v->second.alt_cov_tumor_rev  = v.alt_cov_tumor_rev;  }
+		if (it_v->ref_cov_normal_fwd < v.ref_cov_normal_fwd) { it_v->ref_cov_normal_fwd = v.ref_cov_normal_fwd; }
+		if (it_v->ref_cov_normal_rev < v.ref_cov_normal_rev) { it_v->ref_cov_normal_rev = v.ref_cov_normal_rev; }
+		if (it_v->ref_cov_tumor_fwd  < v.ref_cov_tumor_fwd ) { it_v->ref_cov_tumor_fwd  = v.ref_cov_tumor_fwd;  }
+		if (it_v->ref_cov_tumor_rev  < v.ref_cov_tumor_rev ) { it_v->ref_cov_tumor_rev  = v.ref_cov_tumor_rev;  }
+		if (it_v->alt_cov_normal_fwd < v.alt_cov_normal_fwd) { it_v->alt_cov_normal_fwd = v.alt_cov_normal_fwd; }
+		if (it_v->alt_cov_normal_rev < v.alt_cov_normal_rev) { it_v->alt_cov_normal_rev = v.alt_cov_normal_rev; }		
+		if (it_v->alt_cov_tumor_fwd  < v.alt_cov_tumor_fwd ) { it_v->alt_cov_tumor_fwd  = v.alt_cov_tumor_fwd;  }
+		if (it_v->alt_cov_tumor_rev  < v.alt_cov_tumor_rev ) { it_v->alt_cov_tumor_rev  = v.alt_cov_tumor_rev;  }
 		
-		it_v->second.reGenotype(); // recompute genotype
+		it_v->reGenotype(); // recompute genotype
 	}
 	else { 
-		DB.insert(pair<string,Variant_t>(key,v));
+		bucket->append(key,v);
 	}
+	
+	pthread_mutex_unlock(&bucket->lock_m);
 
 	// updated counts of variants per position in the normal
 	/*
@@ -64,9 +194,9 @@ void VariantDB_t::addVar(Variant_t v) {
 	*/
 }
 
-void VariantDB_t::printHeader(const string version, const string reference, char * date, Filters &fs, string &sample_name_N, string &sample_name_T) {
+void VariantDB_t::printHeader(ostream & out, const string version, const string reference, char * date, Filters &fs, string &sample_name_N, string &sample_name_T) {
 	
-	cout << "##fileformat=VCFv4.2\n"
+	out << "##fileformat=VCFv4.2\n"
 			"##fileDate=" << date << ""
 			"##source=lancet " << version << "\n"
 			"##cmdline=" << command_line << "\n"
@@ -101,26 +231,75 @@ void VariantDB_t::printHeader(const string version, const string reference, char
 			"#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\t" << sample_name_N << "\t" << sample_name_T << "\n";
 }
 
+// total number of variants in the DB
+unsigned int VariantDB_t::size() {
+	
+	unsigned int n = 0;
+	pthread_rwlock_rdlock(&lock_m);
+	for (unsigned int c = 0; c < DB.size(); ++c) { 
+		for (unsigned int b = 0; b < DB[c]->buckets_m.size(); ++b) { 
+			VariantBucket_t * bucket = DB[c]->buckets_m[b];
+			if (bucket == NULL) { continue; }
+			pthread_mutex_lock(&bucket->lock_m);
+			n += bucket->vars_m.size(); 
+			pthread_mutex_unlock(&bucket->lock_m);
+		}
+	}
+	pthread_rwlock_unlock(&lock_m);
+	return n;
+}
+
 // print variant in VCF format
+// contigs are streamed in header order, variants in position order
+// (must be called after all the worker threads have completed)
 void VariantDB_t::printToVCF(const string version, const string reference, char * date, Filters &fs, string &sample_name_N, string &sample_name_T) {
 	
 	cerr << "Export variants to VCF file" << endl;
 	
-	printHeader(version,reference,date,fs,sample_name_N,sample_name_T);
+	printHeader(cout,version,reference,date,fs,sample_name_N,sample_name_T);
+	printVariants(cout);
+}
+
+// print the variants in VCF format (position order)
+//////////////////////////////////////////////////////////////
+void VariantDB_t::printVariants(ostream & out) {
 	
-	// dump map content to vector for custom sorting
-	vector< pair<string,Variant_t> > myVec(DB.begin(), DB.end());
-	// sort based on chromosome location
-	sort(myVec.begin(),myVec.end(),byPos());
+	for (unsigned int c = 0; c < DB.size(); ++c) {
+		for (unsigned int b = 0; b < DB[c]->buckets_m.size(); ++b) {
+			VariantBucket_t * bucket = DB[c]->buckets_m[b];
+			if (bucket == NULL) { continue; }
+			
+			bucket->sortByPos();
+		
+			vector<Variant_t>::iterator it;
+			for (it=bucket->vars_m.begin(); it!=bucket->vars_m.end(); ++it) {
+				it->printVCF(out);
+			}
+		}
+	}
+}
 
-	vector< pair<string,Variant_t> >::iterator it;
-	for (it=myVec.begin(); it!=myVec.end(); ++it) {
-		//cerr << it->first << "\t";
+// variants in VCF order (the variants without support are not printed in 
+// the VCF and are left out)
+//////////////////////////////////////////////////////////////
+void VariantDB_t::getVariants(vector<Variant_t> & variants) {
+	
+	for (unsigned int c = 0; c < DB.size(); ++c) {
+		for (unsigned int b = 0; b < DB[c]->buckets_m.size(); ++b) {
+			VariantBucket_t * bucket = DB[c]->buckets_m[b];
+			if (bucket == NULL) { continue; }
+			
+			bucket->sortByPos();
 		
-		//string pos = (it->second).getPosition();
-	    //unordered_map<string,int>::iterator itp = nCNT.find(pos);
-		//if (itp == nCNT.end()) { // print variant if no muations in the normal at locus
-			it->second.printVCF();
-		//}
-	}	
+			vector<Variant_t>::iterator it;
+			for (it=bucket->vars_m.begin(); it!=bucket->vars_m.end(); ++it) {
+				int Rn = it->ref_cov_normal_fwd + it->ref_cov_normal_rev;
+				int An = it->alt_cov_normal_fwd + it->alt_cov_normal_rev;
+				int Rt = it->ref_cov_tumor_fwd + it->ref_cov_tumor_rev;
+				int At = it->alt_cov_tumor_fwd + it->alt_cov_tumor_rev;
+				if (it->bestState(Rn, An, Rt, At) == 'E') { continue; }
+				variants.push_back(*it);
+			}
+		}
+	}
 }
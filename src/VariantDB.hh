@@ -27,45 +27,100 @@
 #include <unordered_map>
 #include <string>
 #include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <pthread.h>
 #include "util.hh"
 #include "Variant.hh"
-#include "sha256.hh"
 
 using namespace std;
 
+// 64-bit variant key: contig id (24 bits) | position (32 bits) | ref/alt fingerprint (8 bits)
+// keys are not unique, variants sharing the same key are resolved by exact comparison
+typedef uint64_t VariantKey_t;
+
+// contig id (header order; draft assemblies can have more than 65535 contigs)
+typedef uint32_t ContigId_t;
+
+// size (in bp) of the genomic buckets used to shard the variant DB
+#define VARIANT_BUCKET_SIZE 100000
+
+// order variants of the same contig by position
 struct byPos
 {
-	bool operator()(pair<string,Variant_t> first, pair<string,Variant_t> second) const {
-		
-		bool ans = true;
-		string chr1 = (first.second).chr; 
-		int pos1 = (first.second).pos; 
-		string chr2 = (second.second).chr; 
-		int pos2 = (second.second).pos; 
+	const vector<Variant_t> & vars;
 	
-		int cmp = chr1.compare(chr2);
-		if (cmp == 0) { ans = (pos1 < pos2); }
-		else if (cmp < 0) { ans = true; }
-		else if (cmp > 0) { ans = false; }
+	byPos(const vector<Variant_t> & v) : vars(v) {}
+	
+	bool operator()(unsigned int first, unsigned int second) const {
+		return vars[first].pos < vars[second].pos;
+	}
+};
+
+// variants of a genomic bucket (shard) of a contig in position order
+class VariantBucket_t
+{
+public:
+
+	pthread_mutex_t lock_m; // protects the content of the bucket
+	vector<Variant_t> vars_m; // variants (appended, kept in position order)
+	unordered_multimap<VariantKey_t,unsigned int> index_m; // key -> slot in vars_m
+	bool sorted_m; // false if a variant was appended out of position order
+
+	VariantBucket_t() : sorted_m(true) { pthread_mutex_init(&lock_m, NULL); }
+	~VariantBucket_t() { pthread_mutex_destroy(&lock_m); }
 	
-		return ans;
+	Variant_t * find(VariantKey_t key, const Variant_t & v);
+	void append(VariantKey_t key, const Variant_t & v);
+	void sortByPos();
+};
+
+// buckets of a single contig
+class ContigVariants_t
+{
+public:
+
+	string name_m; // contig name
+	vector<VariantBucket_t *> buckets_m; // buckets of VARIANT_BUCKET_SIZE bp (allocated on first use)
+
+	ContigVariants_t(const string & name) : name_m(name) {}
+	~ContigVariants_t() { 
+		for (unsigned int b = 0; b < buckets_m.size(); ++b) { delete buckets_m[b]; }
 	}
 };
 
+// variant database shared by all the worker threads:
+// shards are looked up under a read lock and created under a write lock, 
+// variants are inserted under the lock of their bucket only
 class VariantDB_t
 {
 public:
 
-	map<string,Variant_t> DB; // databbase of variants
+	vector<ContigVariants_t *> DB; // databbase of variants partitioned by contig (header order)
+	unordered_map<string,ContigId_t> contigs; // contig name to contig id
+	pthread_rwlock_t lock_m; // protects DB and contigs structure
 	unordered_map<string,int> nCNT; // counts of variants per postion in the normal
 	string command_line; // command line used to run the tool
 
-	VariantDB_t() {}
+	VariantDB_t() { pthread_rwlock_init(&lock_m, NULL); }
+	~VariantDB_t();
 	
 	void setCommandLine(string cl) { command_line = cl; }
+	void setContigs(const RefVector & refs);
+	VariantBucket_t * getBucket(const string & chr, int pos, ContigId_t & cid);
+	VariantKey_t makeKey(ContigId_t cid, const Variant_t & v);
 	void addVar(Variant_t v);
-	void printHeader(const string version, const string reference, char * date, Filters &fs, string &sample_name_N, string &sample_name_T);
+	unsigned int size();
+	void printHeader(ostream & out, const string version, const string reference, char * date, Filters &fs, string &sample_name_N, string &sample_name_T);
 	void printToVCF(const string version, const string reference, char * date, Filters &fs, string &sample_name_N, string &sample_name_T);
+	void printVariants(ostream & out);
+	void getVariants(vector<Variant_t> & variants);
+
+private:
+	VariantDB_t(const VariantDB_t &);
+	VariantDB_t & operator=(const VariantDB_t &);
+	VariantBucket_t * findBucket(const string & chr, int pos, ContigId_t & cid);
+	static unsigned int bucketOf(int pos) { return (pos > 0) ? pos/VARIANT_BUCKET_SIZE : 0; }
 };
 
 #endif
@@ -0,0 +1,151 @@
+#include "WindowStats.hh"
+
+/****************************************************************************
+** WindowStats.cc
+**
+** Per-window statistics of a run (reads, time spent in each phase of the
+** analysis, k-mer sizes tried and graph sizes) written as a TSV file
+**
+*****************************************************************************/
+
+/************************** COPYRIGHT ***************************************
+**
+** New York Genome Center
+**
+** SOFTWARE COPYRIGHT NOTICE AGREEMENT
+** This software and its documentation are copyright (2016) by the New York
+** Genome Center. All rights are reserved. This software is supplied without
+** any warranty or guaranteed support whatsoever. The New York Genome Center
+** cannot be responsible for its use, misuse, or functionality.
+**
+** Version: 1.0.0
+** Author: Giuseppe Narzisi
+**
+*************************** /COPYRIGHT **************************************/
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+// clear
+// reset the statistics for a new window
+//////////////////////////////////////////////////////////////////////////
+void WindowStats_t::clear(const string & window)
+{
+	window_m = window;
+	status_m = "";
+	reads_tumor_m = 0;
+	reads_normal_m = 0;
+	readbp_m = 0;
+	for (int p = 0; p < NUM_PHASES; ++p) { time_m[p] = 0; }
+	kmers_m = "";
+	nodes_m = 0;
+	edges_m = 0;
+	dfs_limit_m = 0;
+	paths_m = 0;
+	variants_m = 0;
+}
+
+// add
+// add the times and the path counters of a component of the window (its
+// variants are counted when they are saved by the window)
+//////////////////////////////////////////////////////////////////////////
+void WindowStats_t::add(const WindowStats_t & s)
+{
+	for (int p = 0; p < NUM_PHASES; ++p) { time_m[p] += s.time_m[p]; }
+	dfs_limit_m += s.dfs_limit_m;
+	paths_m += s.paths_m;
+}
+
+// addK
+// record the outcome of the assembly with k-mer size k
+//////////////////////////////////////////////////////////////////////////
+void WindowStats_t::addK(int k, const char * outcome)
+{
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%s%d:%s", kmers_m.empty() ? "" : ",", k, outcome);
+	kmers_m += buf;
+}
+
+// header
+// column names of the statistics file (times are in milliseconds)
+//////////////////////////////////////////////////////////////////////////
+const char * WindowStats_t::header()
+{
+	return "#window\tthread\tstatus\treads_tumor\treads_normal\tread_bp"
+		"\textract_ms\tactive_ms\tbuild_ms\tcleanup_ms\tpaths_ms\talign_ms\tvariants_ms\ttotal_ms"
+		"\tkmers\tnodes\tedges\tdfs_limit_hits\tpaths\tvariants\n";
+}
+
+// print
+// append the record of the window to buf (total is the wall-clock time
+// of the window in seconds)
+//////////////////////////////////////////////////////////////////////////
+void WindowStats_t::print(string & buf, int thread, double total) const
+{
+	char line[512];
+	snprintf(line, sizeof(line), "%s\t%d\t%s\t%d\t%d\t%ld",
+		window_m.c_str(), thread, status_m.c_str(), reads_tumor_m, reads_normal_m, readbp_m);
+	buf += line;
+
+	for (int p = 0; p < NUM_PHASES; ++p) {
+		snprintf(line, sizeof(line), "\t%.3f", 1000*time_m[p]);
+		buf += line;
+	}
+
+	snprintf(line, sizeof(line), "\t%.3f\t", 1000*total);
+	buf += line;
+	buf += kmers_m.empty() ? "." : kmers_m;
+
+	snprintf(line, sizeof(line), "\t%ld\t%ld\t%d\t%d\t%d\n", nodes_m, edges_m, dfs_limit_m, paths_m, variants_m);
+	buf += line;
+}
+
+// open
+// create the statistics file and write the header
+//////////////////////////////////////////////////////////////////////////
+bool WindowStatsLog_t::open(const string & filename)
+{
+	filename_m = filename;
+	fp_m = fopen(filename_m.c_str(), "w");
+	if (fp_m == NULL) {
+		cerr << "ERROR: could not open window statistics file " << filename_m << ": " << strerror(errno) << endl;
+		return false;
+	}
+	write(WindowStats_t::header());
+	return !failed_m;
+}
+
+// write
+// append the records buffered by a thread; after a failed write the file
+// is closed and the following records are dropped
+//////////////////////////////////////////////////////////////////////////
+void WindowStatsLog_t::write(const string & records)
+{
+	if (records.empty()) { return; }
+
+	pthread_mutex_lock(&lock_m);
+	if ( (fp_m != NULL) && (fwrite(records.data(), 1, records.size(), fp_m) != records.size()) ) {
+		cerr << "ERROR: could not write window statistics file " << filename_m << ": " << strerror(errno) << endl;
+		fclose(fp_m);
+		fp_m = NULL;
+		failed_m = true;
+	}
+	pthread_mutex_unlock(&lock_m);
+}
+
+// close
+// returns false if a write of the file failed
+//////////////////////////////////////////////////////////////////////////
+bool WindowStatsLog_t::close()
+{
+	if (fp_m != NULL) {
+		if (fclose(fp_m) != 0) {
+			cerr << "ERROR: could not write window statistics file " << filename_m << ": " << strerror(errno) << endl;
+			failed_m = true;
+		}
+		fp_m = NULL;
+	}
+	return !failed_m;
+}
@@ -0,0 +1,107 @@
+#ifndef WINDOWSTATS_HH
+#define WINDOWSTATS_HH 1
+
+/****************************************************************************
+** WindowStats.hh
+**
+** Per-window statistics of a run (reads, time spent in each phase of the
+** analysis, k-mer sizes tried and graph sizes) written as a TSV file
+**
+*****************************************************************************/
+
+/************************** COPYRIGHT ***************************************
+**
+** New York Genome Center
+**
+** SOFTWARE COPYRIGHT NOTICE AGREEMENT
+** This software and its documentation are copyright (2016) by the New York
+** Genome Center. All rights are reserved. This software is supplied without
+** any warranty or guaranteed support whatsoever. The New York Genome Center
+** cannot be responsible for its use, misuse, or functionality.
+**
+** Version: 1.0.0
+** Author: Giuseppe Narzisi
+**
+*************************** /COPYRIGHT **************************************/
+
+#include <string>
+#include <cstdio>
+#include <pthread.h>
+#include <time.h>
+
+using namespace std;
+
+// size of the records buffered by a thread before they are written
+#define WINDOW_STATS_BUFFER (64*1024)
+
+// phases of the analysis of a window
+enum WindowPhase_t {
+	PHASE_EXTRACT,  // reads extracted from the BAMs
+	PHASE_ACTIVE,   // active region test
+	PHASE_BUILD,    // graph construction and connected components
+	PHASE_CLEANUP,  // compression, low coverage/tips/short links removal, cycle and repeat checks
+	PHASE_PATHS,    // source-to-sink path search
+	PHASE_ALIGN,    // alignment of the paths to the reference
+	PHASE_VARIANTS, // variant extraction from the alignments
+	NUM_PHASES
+};
+
+// WindowStats_t
+// statistics of a window. A graph accumulates the statistics of the
+// analysis of its window; components assembled in graphs of their own
+// are added to the window when they are done, so the time of a phase is
+// the sum over the components and the k-mer sizes tried.
+//////////////////////////////////////////////////////////////////////////
+
+class WindowStats_t
+{
+public:
+
+	string window_m;
+	string status_m; // outcome of the window
+	int reads_tumor_m;
+	int reads_normal_m;
+	long readbp_m; // bases of the reads
+	double time_m[NUM_PHASES]; // seconds spent in each phase
+	string kmers_m; // k-mer sizes tried and their outcome (k:outcome,...)
+	long nodes_m; // nodes of the last graph built
+	long edges_m; // edges of the last graph built
+	int dfs_limit_m; // path searches stopped by DFS_LIMIT
+	int paths_m; // source-to-sink paths found
+	int variants_m; // candidate variants saved
+
+	WindowStats_t() { clear(""); }
+
+	void clear(const string & window);
+	void add(const WindowStats_t & s);
+	void addK(int k, const char * outcome);
+	void print(string & buf, int thread, double total) const;
+
+	static const char * header();
+	static double now() { struct timespec t; clock_gettime(CLOCK_MONOTONIC, &t); return t.tv_sec + t.tv_nsec / 1000000000.0; }
+};
+
+// WindowStatsLog_t
+// statistics file shared by the threads of a run: each thread buffers its
+// records and appends them with a single write, so the workers only
+// synchronize once every WINDOW_STATS_BUFFER bytes
+//////////////////////////////////////////////////////////////////////////
+
+class WindowStatsLog_t
+{
+public:
+
+	string filename_m;
+	FILE * fp_m; // statistics file (NULL if closed)
+	pthread_mutex_t lock_m; // serializes the writes of the threads
+	bool failed_m; // a write of the file failed (the file is closed)
+
+	WindowStatsLog_t() : fp_m(NULL), failed_m(false) { pthread_mutex_init(&lock_m, NULL); }
+	~WindowStatsLog_t() { close(); pthread_mutex_destroy(&lock_m); }
+
+	bool open(const string & filename);
+	void write(const string & records);
+	bool close();
+};
+
+#endif
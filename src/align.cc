@@ -22,8 +22,13 @@
 **
 *************************** /COPYRIGHT **************************************/
 
+#include "WindowStats.hh"
+
 using namespace std;
 
+// number of columns of the alignment matrix between two checks of the deadline
+#define DEADLINE_CHECK 64
+
 //Original:
 int MATCH = 2;
 int MISMATCH = -4;
@@ -232,9 +237,9 @@ void global_align(const string & S, const string & T,
 
 
 
-void global_align_aff(const string & S, const string & T, 
+bool global_align_aff(const string & S, const string & T, 
 	string & S_aln, string & T_aln,
-	int endfree, int V)
+	int endfree, int V, double deadline)
 {
   S_aln.clear();
   T_aln.clear();
@@ -262,6 +267,8 @@ void global_align_aff(const string & S, const string & T,
 
   for (int j = 1; j <= m; ++j)
   {
+    if ( (deadline > 0) && ((j % DEADLINE_CHECK) == 0) && (WindowStats_t::now() > deadline) ) { return false; }
+
     if (V) { cout << T[j-1]; }
 
     for (int i = 1; i <= n; ++i)
@@ -318,10 +325,10 @@ void global_align_aff(const string & S, const string & T,
 
     if      (t == '*')  { break; }
 
-    else if (forcex)    { a.s = S[i-1]; a.t = '-'; z=x; if (X[i][j].tb == '<') { forcex = false; } --i; }
+    else if (forcex && i > 0) { a.s = S[i-1]; a.t = '-'; z=x; if (X[i][j].tb == '<') { forcex = false; } --i; }
     else if (t == '<')  { a.s = S[i-1]; a.t = '-'; z=x; if (X[i][j].tb == '-') { forcex = true;  } --i; }
 
-    else if (forcey)    { a.s = '-'; a.t = T[j-1]; z=y; if (Y[i][j].tb == '^') { forcey = false; } --j; }
+    else if (forcey && j > 0) { a.s = '-'; a.t = T[j-1]; z=y; if (Y[i][j].tb == '^') { forcey = false; } --j; }
     else if (t == '^')  { a.s = '-'; a.t = T[j-1]; z=y; if (Y[i][j].tb == '|') { forcey = true;  } --j; }
 
     else if (t == '\\') { a.s = S[i-1]; a.t = T[j-1]; --i; --j; }
@@ -361,6 +368,95 @@ void global_align_aff(const string & S, const string & T,
     cout << "T': " << T_aln << endl;
 
   }
+
+  return true;
+}
+
+
+// left_align_gaps
+// shift every gap run of the alignment to its leftmost equivalent 
+// position (never before the first aligned column), which is where the 
+// traceback of global_align_aff places gaps inside repeats
+//////////////////////////////////////////////////////////////////////////
+static void left_align_gaps(string & A_aln, string & B_aln)
+{
+  int len = A_aln.length();
+
+  for (int b = 0; b < len; ++b)
+  {
+    string * gapped = NULL;
+    string * other = NULL;
+    if      (B_aln[b] == '-' && A_aln[b] != '-') { gapped = &B_aln; other = &A_aln; }
+    else if (A_aln[b] == '-' && B_aln[b] != '-') { gapped = &A_aln; other = &B_aln; }
+    else { continue; }
+
+    // gap run [a, e)
+    int a = b;
+    int e = b;
+    while (e < len && (*gapped)[e] == '-' && (*other)[e] != '-') { ++e; }
+
+    while ( (a > 1) && 
+            ((*gapped)[a-1] != '-') && ((*other)[a-1] != '-') &&
+            ((*gapped)[a-1] == (*other)[a-1]) && 
+            ((*other)[a-1] == (*other)[e-1]) )
+    {
+      (*gapped)[e-1] = (*gapped)[a-1];
+      (*gapped)[a-1] = '-';
+      --a; --e;
+    }
+
+    b = e - 1; // continue after the (possibly shifted) run
+  }
+}
+
+// anchored_align_aff
+// strip the longest common suffix and prefix shared by S and T and
+// run the affine global alignment only on the divergent core.
+// One shared base is kept at the start of the core so that the core
+// alignment does not open with a gap, and gaps are then moved to
+// their leftmost equivalent position as done by the traceback of 
+// global_align_aff on the full sequences. Returns false if the
+// alignment was stopped by the deadline.
+//////////////////////////////////////////////////////////////////////////
+bool anchored_align_aff(const string & S, const string & T, 
+	string & S_aln, string & T_aln,
+	int V, double deadline)
+{
+  int n = S.length();
+  int m = T.length();
+  int minlen = (n < m) ? n : m;
+
+  // keep at least the first base out of the suffix anchor so that no event
+  // is reported before the first aligned position
+  int sfx = 0;
+  while ( (sfx < minlen-1) && (S[n-1-sfx] == T[m-1-sfx]) ) { ++sfx; }
+
+  int pfx = 0;
+  while ( (pfx < minlen-sfx) && (S[pfx] == T[pfx]) ) { ++pfx; }
+  if (pfx > 0) { --pfx; }
+
+  if (V) { cerr << "anchors: prefix=" << pfx << " suffix=" << sfx << endl; }
+
+  string core_S_aln;
+  string core_T_aln;
+  S_aln.clear();
+  T_aln.clear();
+  if (!global_align_aff(S.substr(pfx, n-pfx-sfx), T.substr(pfx, m-pfx-sfx), core_S_aln, core_T_aln, 0, V, deadline)) { return false; }
+
+  S_aln.reserve(pfx + core_S_aln.length() + sfx);
+  T_aln.reserve(pfx + core_T_aln.length() + sfx);
+
+  S_aln.append(S, 0, pfx);
+  S_aln.append(core_S_aln);
+  S_aln.append(S, n-sfx, sfx);
+
+  T_aln.append(T, 0, pfx);
+  T_aln.append(core_T_aln);
+  T_aln.append(T, m-sfx, sfx);
+
+  left_align_gaps(S_aln, T_aln);
+
+  return true;
 }
 
 
@@ -34,10 +34,16 @@ void global_align(const std::string & S, const std::string & T,
                   std::string & S_aln, std::string & T_aln,
                   int endfree, int verbose);
 
-void global_align_aff(const std::string & S, const std::string & T,
+// the affine alignments stop (and return false with empty alignments) 
+// once WindowStats_t::now() passes deadline (0 = no deadline)
+bool global_align_aff(const std::string & S, const std::string & T,
                       std::string & S_aln, std::string & T_aln,
-                      int endfree, int verbose);
+                      int endfree, int verbose, double deadline = 0);
  
+bool anchored_align_aff(const std::string & S, const std::string & T,
+                        std::string & S_aln, std::string & T_aln,
+                        int verbose, double deadline = 0);
+
 void global_cov_align_aff(const std::string & S, const std::string & T, const std::vector<int> & CT,
 	                  std::string & S_aln, std::string & T_aln, std::vector<int> & CT_aln,
 					  int endfree, int verbose);
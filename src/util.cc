@@ -1,6 +1,8 @@
 #include "util.hh"
+#include <algorithm>
 #include <iostream>
 #include <cstdio>
+#include <cstring>
 
 /****************************************************************************
 ** Util.cc
@@ -517,7 +519,100 @@ float extract_sam_tag(const string &TAG, BamAlignment &al) {
 }
 
 
-// Fasta_Read
+// read numeric value of the aux field at p (integer or float types)
+static float aux_number(char type, const char * p) {
+	switch (type) {
+		case Constants::BAM_TAG_TYPE_INT8   : { int8_t v;   memcpy(&v, p, 1); return v; }
+		case Constants::BAM_TAG_TYPE_UINT8  : { uint8_t v;  memcpy(&v, p, 1); return v; }
+		case Constants::BAM_TAG_TYPE_INT16  : { int16_t v;  memcpy(&v, p, 2); return v; }
+		case Constants::BAM_TAG_TYPE_UINT16 : { uint16_t v; memcpy(&v, p, 2); return v; }
+		case Constants::BAM_TAG_TYPE_INT32  : { int32_t v;  memcpy(&v, p, 4); return v; }
+		case Constants::BAM_TAG_TYPE_UINT32 : { uint32_t v; memcpy(&v, p, 4); return v; }
+		case Constants::BAM_TAG_TYPE_FLOAT  : { float v;    memcpy(&v, p, 4); return v; }
+	}
+	return -1.0;
+}
+
+// size in bytes of a fixed size aux type (0 for variable size types)
+static int aux_type_size(char type) {
+	switch (type) {
+		case Constants::BAM_TAG_TYPE_ASCII  :
+		case Constants::BAM_TAG_TYPE_INT8   :
+		case Constants::BAM_TAG_TYPE_UINT8  : return 1;
+		case Constants::BAM_TAG_TYPE_INT16  :
+		case Constants::BAM_TAG_TYPE_UINT16 : return 2;
+		case Constants::BAM_TAG_TYPE_INT32  :
+		case Constants::BAM_TAG_TYPE_UINT32 :
+		case Constants::BAM_TAG_TYPE_FLOAT  : return 4;
+	}
+	return 0;
+}
+
+// parse the raw aux data (BamAlignment::TagData) in a single pass and 
+// extract all the tags used by the read filters
+void parseReadTags(const string & aux, ReadTags_t & tags, bool parse_md) {
+	
+	tags.as = -1; tags.xs = -1; 
+	tags.xm = 0; tags.xt = 0; 
+	tags.xa = false; tags.md = false;
+	tags.rg = NULL; tags.rg_len = 0;
+	
+	const char * p = aux.data();
+	const char * end = p + aux.size();
+	
+	while (p + 3 <= end) {
+		char t0 = p[0]; 
+		char t1 = p[1]; 
+		char type = p[2];
+		p += 3;
+		
+		const char * value = p;
+		int size = aux_type_size(type);
+		
+		if (size > 0) { // fixed size value
+			if (p + size > end) { break; }
+			p += size;
+		}
+		else if (type == Constants::BAM_TAG_TYPE_STRING || type == Constants::BAM_TAG_TYPE_HEX) { // null terminated value
+			while (p < end && *p != '\0') { ++p; }
+			if (p == end) { break; }
+			++p;
+		}
+		else if (type == Constants::BAM_TAG_TYPE_ARRAY) { // array: subtype, count, values
+			if (p + 5 > end) { break; }
+			int32_t count; 
+			memcpy(&count, p+1, 4);
+			int esize = aux_type_size(p[0]);
+			if (esize == 0 || count < 0) { break; }
+			p += 5 + (size_t)esize * count;
+			if (p > end) { break; }
+			continue;
+		}
+		else { break; } // unknown type: stop parsing
+		
+		if (t0 == 'A' && t1 == 'S') { if (type != Constants::BAM_TAG_TYPE_ASCII) { tags.as = aux_number(type, value); } }
+		else if (t0 == 'X' && t1 == 'S') { if (type != Constants::BAM_TAG_TYPE_ASCII) { tags.xs = aux_number(type, value); } }
+		else if (t0 == 'X' && t1 == 'M') { if (type != Constants::BAM_TAG_TYPE_ASCII && type != Constants::BAM_TAG_TYPE_FLOAT) { tags.xm = (int)aux_number(type, value); } }
+		else if (t0 == 'X' && t1 == 'T') { 
+			// same match as GetTag<string>("XT") == "R"/"M": the value is read as a 
+			// C string, so an XT:A value only counts when a null byte follows it 
+			// (XT is the last tag) and a Z value only when it is one character long
+			bool single = (value + 1 == end) || (value[1] == '\0');
+			tags.xt = single ? value[0] : 0; 
+		}
+		else if (t0 == 'X' && t1 == 'A') { tags.xa = (size > 0) || (*value != '\0'); }
+		else if (t0 == 'R' && t1 == 'G') { if (size == 0 && *value != '\0') { tags.rg = value; tags.rg_len = p - value - 1; } }
+		else if (t0 == 'M' && t1 == 'D') { 
+			if (size > 0) { continue; }
+			tags.md = true; 
+			if (parse_md) { tags.md_str.assign(value, p - value - 1); } 
+		}
+	}
+}
+
+
+// StrTrack_t::build
+// scan seq once and store all of its tandems (adapted from Fasta_Read).
 // By default, it finds all microsatellites that are at least 8bp long (total length), 
 // where the repeat sequence is between 1bp and 4bp, and is repeated at least 3 times.
 
@@ -528,9 +623,11 @@ float extract_sam_tag(const string &TAG, BamAlignment &al) {
 // 2 24 23 A 22+1 cAAAAAAAAAAAAAAAAAAAAAAAt 0
 // finished in 8.9e-05s
 //////////////////////////////////////////////////////////////////////////
-bool findTandems(const string & seq, const string & tag, int max_unit_len, int min_report_units, int min_report_len, int dist_from_str, int pos, int & len, std::string & motif)
+void StrTrack_t::build(const string & seq, int max_unit_len, int min_report_units, int min_report_len)
 {
-	bool ans = false;
+	clear();
+	built_m = true;
+
 	//FILE * MUTATE_fp = NULL;
 	const int OFFSET_TABLE_SIZE = 100;
 
@@ -539,9 +636,8 @@ bool findTandems(const string & seq, const string & tag, int max_unit_len, int m
 	//unsigned int MIN_UNIT_LEN = 1;
 	unsigned int MAX_UNIT_LEN = max_unit_len;
 	unsigned int FLANK = 10;
-	int delta = dist_from_str;
 	
-	//cerr << ">" << tag << " len=" << seq.length() << endl;
+	//cerr << ">" << " len=" << seq.length() << endl;
 
 	//if (MUTATE_fp != NULL)
 	//{
@@ -627,14 +723,7 @@ bool findTandems(const string & seq, const string & tag, int max_unit_len, int m
 							int end = i+j;
 							int L = i+j-offset;
 							
-							if ( (pos >= (start-delta)) && (pos <= (end+delta)) ) { 
-								ans = true; 
-								// store STR motif and size
-								len = L; 
-								for (unsigned int z = 0; z < merlen; ++z) { 
-									motif += seq[offset+z];
-								}
-							}
+							tandems_m.push_back(Tandem_t(start, end, L, seq.substr(offset, merlen)));
 
 							// tandem seq
 							/*
@@ -711,5 +800,70 @@ bool findTandems(const string & seq, const string & tag, int max_unit_len, int m
 			}
 		}
 	}
-	return ans;
+
+	// index the tandems by start position
+	bystart_m.resize(tandems_m.size());
+	for (unsigned int t = 0; t < tandems_m.size(); ++t) { bystart_m[t] = t; }
+	sort(bystart_m.begin(), bystart_m.end(), StartLess(tandems_m));
+
+	maxend_m.resize(bystart_m.size());
+	for (unsigned int t = 0; t < bystart_m.size(); ++t) 
+	{
+		int end = tandems_m[bystart_m[t]].end;
+		maxend_m[t] = (t > 0 && maxend_m[t-1] > end) ? maxend_m[t-1] : end;
+	}
+}
+
+// StrTrack_t::lookup
+// find the tandems within dist bp of position pos: len is set to the length 
+// of the last tandem found by the scan and the motifs of all of them are 
+// appended to motif. Returns true if there is at least one.
+//////////////////////////////////////////////////////////////////////////
+bool StrTrack_t::lookup(int pos, int dist, int & len, std::string & motif) const
+{
+	// tandems starting after pos+dist are too far
+	int hi = 0;
+	int lo = bystart_m.size();
+	while (hi < lo) 
+	{
+		int mid = (hi + lo) / 2;
+		if (tandems_m[bystart_m[mid]].start - dist <= pos) { hi = mid + 1; }
+		else { lo = mid; }
+	}
+
+	vector<int> found;
+	for (int t = hi-1; t >= 0 && maxend_m[t] + dist >= pos; --t)
+	{
+		if (tandems_m[bystart_m[t]].end + dist >= pos) { found.push_back(bystart_m[t]); }
+	}
+
+	if (found.empty()) { return false; }
+
+	// report in scan order
+	sort(found.begin(), found.end());
+	for (unsigned int f = 0; f < found.size(); ++f) { motif += tandems_m[found[f]].motif; }
+	len = tandems_m[found.back()].len;
+
+	return true;
+}
+
+// StrTrack_t::clear
+//////////////////////////////////////////////////////////////////////////
+void StrTrack_t::clear()
+{
+	tandems_m.clear();
+	bystart_m.clear();
+	maxend_m.clear();
+	built_m = false;
+}
+
+// findTandems
+// return true if there is a tandem within dist_from_str bp of position pos 
+// in seq (see StrTrack_t::lookup for len and motif)
+//////////////////////////////////////////////////////////////////////////
+bool findTandems(const string & seq, const string & tag, int max_unit_len, int min_report_units, int min_report_len, int dist_from_str, int pos, int & len, std::string & motif)
+{
+	StrTrack_t track;
+	track.build(seq, max_unit_len, min_report_units, min_report_len);
+	return track.lookup(pos, dist_from_str, len, motif);
 }
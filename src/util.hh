@@ -28,6 +28,7 @@
 #include <sstream>
 #include <assert.h>
 #include <map>
+#include <vector>
 
 #include "api/BamReader.h"
 
@@ -64,6 +65,57 @@ using namespace BamTools;
   #define HASHMAP std
 #endif
 
+// alignment tags used by the read filters (extracted with a single scan of the aux data)
+struct ReadTags_t
+{
+	float as;       // AS: alignment score (-1 if missing)
+	float xs;       // XS: suboptimal alignment score (-1 if missing)
+	int xm;         // XM: number of mismatches (0 if missing)
+	char xt;        // XT: type of the mapping, as matched by the baseline filter (0 if missing)
+	bool xa;        // XA: alternative hits are present
+	bool md;        // MD: mismatching positions are present (stored in md_str)
+	const char * rg; // RG: read group, points into the aux data (NULL if missing)
+	unsigned int rg_len;
+	std::string md_str;
+};
+
+// tandem repeat (STR) found in a sequence
+struct Tandem_t
+{
+	int start; // first base of the tandem
+	int end;   // one past the last base of the tandem
+	int len;   // length of the tandem
+	std::string motif; // repeated unit
+
+	Tandem_t(int s, int e, int l, const std::string & m) : start(s), end(e), len(l), motif(m) { }
+};
+
+// StrTrack_t
+// tandem repeats of a sequence, found with a single scan and then looked up 
+// by position
+class StrTrack_t
+{
+public:
+	std::vector<Tandem_t> tandems_m; // in the order they are found by the scan
+	std::vector<int> bystart_m; // index of the tandems sorted by start
+	std::vector<int> maxend_m;  // maxend_m[i]: max end of the tandems in bystart_m[0..i]
+	bool built_m;
+
+	// order tandem indexes by start (then by scan order)
+	struct StartLess
+	{
+		const std::vector<Tandem_t> & t_m;
+		StartLess(const std::vector<Tandem_t> & t) : t_m(t) { }
+		bool operator()(int a, int b) const { return (t_m[a].start != t_m[b].start) ? (t_m[a].start < t_m[b].start) : (a < b); }
+	};
+
+	StrTrack_t() : built_m(false) { }
+
+	void build(const std::string & seq, int max_unit_len, int min_report_units, int min_report_len);
+	bool lookup(int pos, int dist, int & len, std::string & motif) const;
+	void clear();
+};
+
 std::string buildCommandLine(int argc, char** argv);
 StringType GetBaseFilename(const char *filename);
 FILE * xfopen(const std::string & filename, const std::string & mode);
@@ -85,6 +137,7 @@ bool seqAboveQual(std::string qv, int Q);
 bool checkPresenceOfMDtag(BamReader &reader);
 void parseMD(std::string & md, std::map<int,int> & map, int start, std::string & qual, int min_qv);
 float extract_sam_tag(const std::string &TAG, BamAlignment &al);
+void parseReadTags(const std::string & aux, ReadTags_t & tags, bool parse_md);
 bool findTandems(const std::string & seq, const std::string & tag, int max_unit_len, int min_report_units, int min_report_len, int dist_from_str, int pos, int & len, std::string & motif);
 
 #endif